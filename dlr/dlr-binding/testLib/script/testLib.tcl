@@ -40,11 +40,18 @@ declareCallToNative  cmd  testLib  {byVal long asInt}  strtolTest  {
 # ############ mulByValue and its types ######################################
 
 # extract type metadata from C.
-declareStructType  convert  testLib  quadT  {
-    {int  a  asInt}
-    {int  b  asInt}
-    {int  c  asInt}
-    {int  d  asInt}
+# struct types declared together have their layouts detected together, with one compile.
+declareStructTypes  convert  testLib  {
+    quadT {
+        {int  a  asInt}
+        {int  b  asInt}
+        {int  c  asInt}
+        {int  d  asInt}
+    }
+    taggedT {
+        {u8      tag    asInt}
+        {double  value  asDouble}
+    }
 }
 
 declareCallToNative  cmd  testLib  {byVal quadT asList}  mulByValue  {
@@ -77,6 +84,72 @@ declareCallToNative  cmd  testLib  {byVal float asDouble}  floatSquare  {
     {in     byVal   longDouble  longStuff   asDouble}
 }
 
+declareCallToNative  cmd  testLib  {byVal double asDouble}  mixedArgs  {
+    {in     byVal   int         i   asInt}
+    {in     byVal   double      d   asDouble}
+    {in     byPtr   ascii       s   asString}
+    {in     byVal   double      e   asDouble}
+}
+
+declareCallbackType  testLib  {byVal int asInt}  callbackTestT  {
+    {in     byVal   int         a       asInt}
+    {in     byVal   double      b       asDouble}
+    {in     byPtr   ascii       name    asString}
+    {in     byPtr   quadT       q       asList}
+}
+
+declareCallToNative  cmd  testLib  {byVal int asInt}  callbackTest  {
+    {in     byVal   callbackTestT   cb  asInt}
+    {in     byVal   int             a   asInt}
+}
+
+declareCallToNative  cmd  testLib  {byVal double asDouble}  sumDoubles  {
+    {in     byPtr   double  values  asList}
+    {in     byVal   int     n       asInt}
+}
+
+# the squares array has n elements, as given by the n parm.
+declareCallToNative  cmd  testLib  {void}  fillSquares  {
+    {out    byPtr   int     squares asList  ignore  n}
+    {in     byVal   int     n       asInt}
+}
+
+# returns a malloc'ed array of n structs, as a pointer, for unpackArray.
+declareCallToNative  cmd  testLib  {byVal ptr asInt}  quadArray  {
+    {in     byVal   int     n       asInt}
+}
+
+declareCallToNative  cmd  testLib  {byVal ptr asInt}  passPtr  {
+    {in     byVal   ptr     p       asInt}
+}
+
+declareCallToNative  cmd  testLib  {byVal int asInt}  checkedErrno  {
+    {in     byVal   int     x   asInt}
+} {negative errno}
+
+declareCallToNative  cmd  testLib  {byVal ptr asInt}  checkedNull  {
+    {in     byVal   int     x   asInt}
+} {null msgFn checkedMessage}
+
+declareCallToNative  cmd  testLib  {byVal int asInt}  countChar  {
+    {in     byPtr   ascii   s   asString    borrow}
+    {in     byVal   int     c   asInt}
+}
+
+declareCallToNative  cmd  testLib  {byVal int asInt}  quadSum  {
+    {in     byPtr   quadT   q   asNative    borrow}
+}
+
+declareCallToNative  cmd  testLib  {byVal int asInt}  fillText  {
+    {inOut  byPtr   ascii   buf     asString    ignore  return}
+    {in     byVal   int     size    asInt}
+}
+
+declareCallToNative  cmd  testLib  {void}  makeText  {
+    {out    byPtrPtr    ascii   text    asString    free    len}
+    {out    byPtr       int     len     asInt       ignore}
+}
+
 declareCallToNative  cmd  testLib  {void}  floatSquarePtr  {
     {inOut     byPtr   double    stuff     asDouble     ignore }
 }
@@ -146,3 +219,7 @@ declareCallToNative  cmd  testLib  {byVal directions asInt}  dirRotate  {
 declareCallToNative  cmd  testLib  {void}  dirRotatePtr  {
     {inOut     byPtr   directions     d  asInt  ignore}
 }
+
+# ############ thread safety ######################################
+# these may be split across worker threads by callBatch.
+declareThreadSafe  testLib  {strtolTest  mixedArgs  dirRotate}
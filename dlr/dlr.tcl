@@ -46,15 +46,16 @@ proc ::dlr::initDlr {} {
     ::dlr::refreshMeta              0
 #todo: verify every built-in type has categories initialized.
     set ::dlr::categories           [list integral signedInt unsignedInt specificInt nonspecificInt \
-                                        enum float string struct union pointer \
+                                        enum float string struct union pointer callback \
                                         hasMetaBlob requiresMemAction]
 
     set ::dlr::directions           [list in out inOut] ;# the user-specified directions of data flow.  these are for parms only; does not include "return" direction for function return values.
     set ::dlr::dlrFlags             [dict create dir_in 1 dir_out 2 dir_inOut 3 array 8]
 
     # aliases to pass through to native implementations of certain dlr system commands.
-    foreach cmd {prepStructType prepMetaBlob callToNative
-        createBufferVar copyToBufferVar addrOf allocHeap freeHeap} {
+    foreach cmd {prepStructType prepMetaBlob callToNative bindCallToNative bindPlannedCall
+        createBufferVar copyToBufferVar addrOf allocHeap freeHeap
+        newBuffer wrapBuffer sliceBuffer bufferAddr newPointer pointerType} {
         alias  ::dlr::$cmd  ::dlr::native::$cmd
     }
 
@@ -137,14 +138,15 @@ proc ::dlr::initDlr {} {
     # are not exposed in their API, so the app can't know how to convert them.
     #
     # most simple types are integer scalars, so blanket all types with asInt.
+    # asList is an array of the type, passed byPtr, as a list of values in script.
     foreach v [info vars ::dlr::simple::*::ffiTypeCode] {
-        set [namespace parent $v]::scriptForms  [list asInt]
+        set [namespace parent $v]::scriptForms  [list asInt asList]
     }
     # overwrite that with a few special cases such as floating point and struct.
     set ::dlr::struct::scriptForms              [list asList asDict asNative]
     set ::dlr::union::scriptForms               [list asNative]
     foreach typ {float double longDouble} {
-        set ::dlr::simple::${typ}::scriptForms  [list asDouble]
+        set ::dlr::simple::${typ}::scriptForms  [list asDouble asList]
         set ::dlr::simple::${typ}::categories   [list float]
     }
     set ::dlr::simple::ascii::scriptForms       [list asString]
@@ -159,6 +161,47 @@ proc ::dlr::initDlr {} {
     # 'ignore' means do nothing; leave the memory block as-is after unpacking its
     # content.  the application script will be responsible for managing it.
     set ::dlr::memActions   [list  free  ignore]
+    # an 'in' parm passed byPtr may instead give memAction 'borrow', if its type is ascii,
+    # or its scriptForm is asNative.  that passes a pointer straight to the script value's
+    # own bytes for the duration of the call, instead of to a copy.  Jim strings are already
+    # null-terminated.  the native function must only read them, and must not keep the
+    # pointer after it returns, like most functions taking a 'const char*'.
+
+    # marshaling plans.  when this is true, each declareCallToNative compiles a marshaling
+    # plan if it can, and binds a planned call command in place of the generated call wrapper.
+    # set it false before declaring, to always use the generated call wrappers instead.
+    set ::dlr::planCalls    1
+
+    # trampolines.  when this is true, prepMetaBlob bypasses libffi for functions whose
+    # arguments and return value are all integers, pointers, or doubles, calling them through
+    # a precompiled trampoline instead.  set it false before declaring, to always use libffi.
+    set ::dlr::trampolines  1
+
+    # lazy binding.  when this is true, declaring a function with scriptAction wrap or cmd only
+    # puts a stub in place of its call command.  the first call through that resolves the
+    # function's symbol, prepares its metaBlob, loads its wrapper, and then carries on with the
+    # real call command, which replaces the stub.  big bindings then pay startup time and memory
+    # only for the functions actually called.  see resolveCall.
+    set ::dlr::lazyBinding  0
+
+    # async calls.  this many worker threads are started at the first callAsync.
+    # changing it after that has no effect.
+    set ::dlr::asyncWorkers 4
+
+    # struct converters are normally the struct codec in dlrNative, which converts a whole
+    # struct in one command.  set this to 0 before declaring struct types, to use the
+    # generated converter procs instead.  those are easier to customize.
+    set ::dlr::structCodec  1
+
+    # each callback type preallocates this many closures in its pool.
+    # the pool grows beyond that as needed.
+    set ::dlr::callbackPrealloc 4
+
+    # serial number of the most recent pack cursor.
+    set ::dlr::packer::nextId 0
+
+    # serial number of the most recent block pool.
+    set ::dlr::pool::nextId 0
 
     # aliases for converters written in C and provided by dlrNative by default.
     # aliases add speed by avoiding a dispatch step in script.
@@ -172,19 +215,36 @@ proc ::dlr::initDlr {} {
         alias  ::dlr::simple::double::${conversion}-byVal-asDouble      ::dlr::native::double-${conversion}-byVal-asDouble
         alias  ::dlr::simple::longDouble::${conversion}-byVal-asDouble  ::dlr::native::longDouble-${conversion}-byVal-asDouble
         alias  ::dlr::simple::ascii::${conversion}-byVal-asString       ::dlr::native::ascii-${conversion}-byVal-asString
+        # array converters.
+        foreach size {8 16 32 64} {
+            foreach sign {u i} {
+                alias  ::dlr::simple::${sign}${size}::${conversion}-byVal-asList  ::dlr::native::${sign}${size}-${conversion}-byVal-asList
+            }
+        }
+        foreach typ {float double longDouble} {
+            alias  ::dlr::simple::${typ}::${conversion}-byVal-asList  ::dlr::native::${typ}-${conversion}-byVal-asList
+        }
     }
     alias  ::dlr::simple::ascii::unpack-scriptPtr-asString       ::dlr::native::ascii-unpack-scriptPtr-asString
+    alias  ::dlr::simple::ascii::unpack-scriptPtr-asStringLen    ::dlr::native::ascii-unpack-scriptPtr-asStringLen
+    alias  ::dlr::simple::ascii::unpack-scriptPtr-asStringMax    ::dlr::native::ascii-unpack-scriptPtr-asStringMax
 
     # converter aliases for certain types.
     # types with length unspecified in C use converters for fixed-size types.
     # the fixed size is selected according to the actual host at compile time.
     foreach conversion {pack unpack} {
-        foreach type {int short long longLong sSizeT} {
-            alias  ::dlr::simple::${type}::${conversion}-byVal-asInt        ::dlr::simple::i[get ::dlr::simple::${type}::bits]::${conversion}-byVal-asInt
-        }
-        foreach type {uInt uShort uLong uLongLong sizeT ptr} {
-            alias  ::dlr::simple::${type}::${conversion}-byVal-asInt        ::dlr::simple::u[get ::dlr::simple::${type}::bits]::${conversion}-byVal-asInt
+        foreach form {asInt asList} {
+            foreach type {int short long longLong sSizeT} {
+                alias  ::dlr::simple::${type}::${conversion}-byVal-$form    ::dlr::simple::i[get ::dlr::simple::${type}::bits]::${conversion}-byVal-$form
+            }
+            foreach type {uInt uShort uLong uLongLong sizeT} {
+                alias  ::dlr::simple::${type}::${conversion}-byVal-$form    ::dlr::simple::u[get ::dlr::simple::${type}::bits]::${conversion}-byVal-$form
+            }
         }
+        # a single pointer has its own converters, which pass pointer objects.  an array of them is
+        # converted like unsigned integers.
+        alias  ::dlr::simple::ptr::${conversion}-byVal-asInt     ::dlr::native::ptr-${conversion}-byVal-asInt
+        alias  ::dlr::simple::ptr::${conversion}-byVal-asList    ::dlr::simple::u[get ::dlr::simple::ptr::bits]::${conversion}-byVal-asList
     }
 
     # pointer support.
@@ -204,7 +264,9 @@ proc ::dlr::initDlr {} {
     # any asString data might contain this flag string, to represent a null pointer in the native data.
     # the same for asNative.
     # other scriptForms generally represent null pointer as an empty string / list / dict.
-    set ::dlr::nullPtrFlag          _#_nullPtrFlag_#_
+    # this is a pointer object, so dlrNative recognizes it by a tag test instead of a string compare.
+    # its string value is still the flag string.
+    set ::dlr::nullPtrFlag          [::dlr::native::nullPtrFlag]
 
     # string support.
     set ::dlr::simple::ascii::categories        [list string requiresMemAction]
@@ -220,11 +282,37 @@ proc ::dlr::initDlr {} {
 
     # compiler support.
     # in the current version, all features work with either gcc or clang.
+    # the compiler script is evaluated where $cFn, $binFn, and $flags are available.
+    # flags lists any additional options needed for the job, such as for building a shared library.
     set ::dlr::defaultCompiler {
-        exec  gcc  --std=c11  -O0  -I.  -o $binFn  $cFn
+        exec  gcc  --std=c11  -O0  -I.  {*}$flags  -o $binFn  $cFn
     }
     set ::dlr::compiler $::dlr::defaultCompiler
 
+    # struct layout source.  with compile, layouts are detected by compiling a C program
+    # against the lib's headers.  with dwarf, they're read from the lib's DWARF debug info
+    # instead, so no compiler or headers are needed on the host.  that reads the file given
+    # to loadLib, or the separate debug file in ::dlr::lib::${libAlias}::debugFile, if the
+    # binding or app sets one.  either way the layouts are cached in the same .struct files.
+    set ::dlr::structLayoutSource  compile
+
+    # every generated artifact depends on the script package that generated it.  see autoMeta.
+    set f [open $::dlr::scriptPkg r]
+    set ::dlr::scriptHash [::dlr::native::hash [read $f]]
+    close $f
+
+    # call stubs support.  stubs are compiled as a Jim extension, so they require jim.h.
+    # by default that's searched for in the directory of the running jimsh (typically its build directory).
+    # an app can set this list to other directories instead, before calling loadLib.
+    set exe [info nameofexecutable]
+    if {[file type $exe] eq {link}} {
+        set exe [file join [file dirname $exe] [file readlink $exe]]
+    }
+    set ::dlr::jimIncludeDirs [list [file dirname $exe]]
+    # C types used in call stubs, by ffi type code.
+    set ::dlr::stubCTypes [dict create  2 float  3 double  4 {long double}  \
+        5 uint8_t  6 int8_t  7 uint16_t  8 int16_t  9 uint32_t  10 int32_t  11 uint64_t  12 int64_t  14 void*]
+
     # GObject Introspection support.
     set ::dlr::giEnabled           [exists -command ::dlr::native::giCallToNative]
 }
@@ -239,21 +327,76 @@ proc ::dlr::initDlr {} {
 # typically you should pass refreshMeta (rather than keepMeta) to loadLib if you
 # suspect the native library's source or binary have changed since the last time.
 # using it on every run of the script app would cost additional startup time.
+#
+# metaAction compileStubs works like refreshMeta, and then also generates a C call stub
+# for each declared function that can have one, compiles them all into one Jim extension
+# in the lib's auto directory, and loads that.  each stub calls the native function
+# directly, with no libffi involved, and takes the place of the function's call wrapper.
+# use it only for bindings that are already known to work well.  after that, keepMeta
+# loads the compiled stubs again (if present), before sourcing the binding script.
+# refreshMeta never loads them, since they might be stale.
+#
+# metaAction autoMeta regenerates only the generated artifacts whose own inputs changed since
+# they were generated, such as a function's declaration, or a struct's declaration, includes.h,
+# the compiler command, or the lib's build-id.  each artifact's inputs are hashed, and compared
+# with the hash recorded in the lib's auto directory.  unlike refreshMeta, that costs little
+# when nothing changed, so it can run on every start.  it reads the lib's bundle like keepMeta,
+# but never loads compiled call stubs.
+#
+# refreshMeta also writes the lib's bundle:  one file holding the metadata and generated
+# scripts of every function and struct type its binding script declared.  keepMeta reads
+# that one file instead of each declaration's own generated files.  see writeBundle.
 proc ::dlr::loadLib {metaAction  libAlias  fileNamePath} {
     if {[exists ::dlr::libHandle::$libAlias]} {
         error "Library is already loaded: $libAlias"
     }
 
-    if {$metaAction ni {refreshMeta keepMeta}} {
+    if {$metaAction ni {refreshMeta keepMeta compileStubs autoMeta}} {
         error "Invalid meta action: $metaAction"
     }
-    refreshMeta $( $metaAction eq {refreshMeta} )
+    refreshMeta $( $metaAction in {refreshMeta compileStubs} )
     file mkdir [file dirname [callWrapperPath $libAlias junk]]
 
     set handle [native::loadLib $fileNamePath]
     set ::dlr::libHandle::$libAlias $handle
+    set ::dlr::lib::${libAlias}::fileNamePath $fileNamePath
+    set ::dlr::lib::${libAlias}::metaAction $metaAction
+
+    set ::dlr::lib::${libAlias}::stubbedFns [list]
+    if {$metaAction eq {keepMeta} && [file readable [callStubsPath $libAlias so]]} {
+        load [callStubsPath $libAlias so]
+    }
+
+    set ::dlr::bundle::${libAlias}::fns [list]
+    set ::dlr::bundle::${libAlias}::structs [list]
+    set ::dlr::bundle::${libAlias}::dirty 0
+    if {$metaAction in {keepMeta autoMeta} && [file readable [bundlePath $libAlias]]} {
+        loadBundle $libAlias
+    }
+    set ::dlr::lib::${libAlias}::artifactHashes [dict create]
+    set ::dlr::lib::${libAlias}::artifactsChanged 0
+    if { ! [refreshMeta] && [file readable [artifactHashesPath $libAlias]]} {
+        set f [open [artifactHashesPath $libAlias] r]
+        set ::dlr::lib::${libAlias}::artifactHashes [read $f]
+        close $f
+    }
 
     source [file join $::dlr::bindingDir $libAlias script $libAlias.tcl]
+
+    if {[refreshMeta] || [get ::dlr::lib::${libAlias}::artifactsChanged] || [get ::dlr::bundle::${libAlias}::dirty]
+        || ! [file readable [bundlePath $libAlias]]} {
+        writeBundle $libAlias
+    }
+    if {[get ::dlr::lib::${libAlias}::artifactsChanged]} {
+        set f [open [artifactHashesPath $libAlias] w]
+        puts $f [get ::dlr::lib::${libAlias}::artifactHashes]
+        close $f
+    }
+
+    if {$metaAction eq {compileStubs}} {
+        compileCallStubs $libAlias
+        load [callStubsPath $libAlias so]
+    }
     return {}
 }
 
@@ -334,6 +477,10 @@ proc ::dlr::qualifyTypeName {type  libAlias  {notFoundAction error}} {
     if {[exists ${eType}::baseType]} {
         return $eType
     }
+    set cType ::dlr::lib::${libAlias}::callback::${type}
+    if {[exists -command ${cType}::pool]} {
+        return $cType
+    }
     if {[exists ::dlr::simple::${type}::ffiTypeCode]} {
         return ::dlr::simple::$type
     }
@@ -435,7 +582,7 @@ proc ::dlr::enumValues {qualifiedEnumName} {
     return [dict keys ${qualifiedEnumName}::toName]
 }
 
-proc ::dlr::parseParmDescrip {libAlias  pQal  dir  passMethod  type  name  scriptForm  memAction} {
+proc ::dlr::parseParmDescrip {libAlias  pQal  dir  passMethod  type  name  scriptForm  memAction  {count {}}} {
 
     set ${pQal}dir  $dir
 
@@ -469,6 +616,29 @@ proc ::dlr::parseParmDescrip {libAlias  pQal  dir  passMethod  type  name  scrip
     validateScriptForm $fullType $scriptForm
     set ${pQal}scriptForm  $scriptForm
 
+    # an array of a simple type is always passed byPtr.  it holds as many elements as the
+    # script's list, or count if that's more.  count is an integer, or another parm's name,
+    # for an "out" array whose size is given by that parm.
+    set ${pQal}isArray $( $scriptForm eq {asList} && [exists ${fullType}::ffiTypeCode] )
+    if {[get ${pQal}isArray] && $passMethod ne {byPtr}} {
+        error "Array (asList) of simple type must be passed byPtr: $name"
+    }
+    if {[get ${pQal}isArray] && $dir eq {return}} {
+        error "Function return value can't be an array."
+    }
+    # an ascii string given out by the native function may have a length bound instead.
+    # that's an integer maximum length, or the name of another parm, or 'return' for the
+    # function's return value, giving the exact length.  that way the string isn't
+    # scanned for its terminator, or isn't scanned beyond the maximum.
+    set isString $( $fullType eq {::dlr::simple::ascii} && $dir in {out inOut} && $passMethod in {byPtr byPtrPtr} )
+    if {$fullType eq {::dlr::simple::ascii} && $dir eq {return} && $passMethod eq {byPtr} && [string is integer -strict $count]} {
+        set isString 1
+    }
+    if {$count ne {} && ! [get ${pQal}isArray] && ! $isString} {
+        error "Element count or length bound is given for a parm that isn't an array or an output string: $name"
+    }
+    set ${pQal}count  $count
+
     if {$passMethod eq {byPtrPtr} || ($passMethod eq {byPtr} && $dir in {out inOut return}) } {
         # memAction must be explicitly specified.
         if { $memAction ni $::dlr::memActions } {
@@ -477,6 +647,10 @@ proc ::dlr::parseParmDescrip {libAlias  pQal  dir  passMethod  type  name  scrip
         if {$memAction eq {ignore}} {
             set memAction {}
         }
+    } elseif {$memAction eq {borrow}} {
+        if {$dir ne {in} || $passMethod ne {byPtr} || ($fullType ne {::dlr::simple::ascii} && $scriptForm ne {asNative})} {
+            error "memAction 'borrow' requires an 'in' parm passed byPtr, of type ascii or scriptForm asNative: $name"
+        }
     } else {
         # memAction must be ignore, or empty string, or unspecified (which is represented by empty string).
         if {$memAction ni {ignore {} }} {
@@ -512,15 +686,40 @@ proc ::dlr::parseParmDescrip {libAlias  pQal  dir  passMethod  type  name  scrip
 # per the app's needs, it could instead define its own support procs ('noScript').
 # or it could source the generated ones, and then modify or further wrap certain ones.
 #todo: more documentation
-proc ::dlr::declareCallToNative {scriptAction  libAlias  returnDescrip  fnName  parmsDescrip} {
+# the optional errorPolicy has dlrNative check the return value right after every call,
+# and raise an error if it indicates failure.  it's a list of:  condition  messageSource  ?errorFnName?
+# condition is one of:
+#   negative    an integer return value less than zero means failure.
+#   nonzero     an integer return value other than zero means failure.
+#   zero        an integer return value of zero means failure.
+#   null        a null pointer return value means failure.
+# messageSource is one of:
+#   errno       the message for errno, captured immediately after the call.
+#   code        the return value itself.
+#   msgFn       the message returned by errorFnName from the same lib, which takes no args, like dlerror().
+#   codeMsgFn   the message returned by errorFnName from the same lib, which takes the return value
+#               as an int, like sqlite3_errstr().
+# for example:  {negative errno}  or  {null msgFn dlerror}
+proc ::dlr::declareCallToNative {scriptAction  libAlias  returnDescrip  fnName  parmsDescrip  {errorPolicy {}}} {
     set fQal ::dlr::lib::${libAlias}::${fnName}::
+    lappend ::dlr::bundle::${libAlias}::fns $fnName
+    set declaration [list $scriptAction $returnDescrip $parmsDescrip $errorPolicy]
+    if {[bundled $libAlias ${fQal}declaration $declaration]
+        && ! [inputsChanged $libAlias call $fnName [callInputs $libAlias $fnName $declaration]]} {
+        # all the metadata was loaded from the lib's bundle.  only the native parts remain.
+        prepCallToNative  $scriptAction  $libAlias  $fnName  $errorPolicy  1
+        return
+    }
+    dropBundled  $libAlias  $fQal
+    set ${fQal}declaration $declaration
+    set ${fQal}scriptAction $scriptAction
 
     # memorize metadata for parms.
     set order [list]
     set orderNative [list]
     set typesMeta [list]
     foreach parmDesc $parmsDescrip {
-        lassign $parmDesc  dir  passMethod  type  name  scriptForm  memAction
+        lassign $parmDesc  dir  passMethod  type  name  scriptForm  memAction  count
         lappend order $name
         set pQal ${fQal}parm::${name}::
 
@@ -529,13 +728,19 @@ proc ::dlr::declareCallToNative {scriptAction  libAlias  returnDescrip  fnName
         }
 
         ::dlr::parseParmDescrip  $libAlias  $pQal  $dir  \
-            $passMethod  $type  $name  $scriptForm  $memAction
+            $passMethod  $type  $name  $scriptForm  $memAction  $count
 
         lappend typesMeta [selectTypeMeta [get ${pQal}passType]]
 
         lappend orderNative [get ${pQal}nativeVarName]
     }
     set ${fQal}parmOrder        $order
+    foreach name $order {
+        set count [get ${fQal}parm::${name}::count]
+        if {$count ne {} && ! [string is integer $count] && $count ne {return} && $count ni $order} {
+            error "Element count or length bound refers to an unknown parm: $count"
+        }
+    }
     # keep alive orderNative so it's not garbage collected, for later use in callToNative.
     set ${fQal}orderNative      $orderNative
 
@@ -547,19 +752,23 @@ proc ::dlr::declareCallToNative {scriptAction  libAlias  returnDescrip  fnName
     if {$returnDescrip eq {}} {
         error "You must describe the function's return value, even if it is 'void'."
     }
+    set ${rQal}unpackedByCall 0
     if {$returnDescrip eq {void}} {
         set ${rQal}type  ::dlr::simple::void
         set rMeta        ::dlr::simple::void::ffiTypeCode
     } else {
-        lassign $returnDescrip  passMethod  type  scriptForm  memAction
+        lassign $returnDescrip  passMethod  type  scriptForm  memAction  count
         if {$passMethod ni {byVal byPtr}} {
             error "Function return value supports only passMethods byVal, byPtr."
         }
         ::dlr::parseParmDescrip  $libAlias  $rQal  return  \
-            $passMethod  $type  "function return value"  $scriptForm  $memAction
+            $passMethod  $type  "function return value"  $scriptForm  $memAction  $count
+        # a scalar return value (integer, float, or pointer) is unpacked by callToNative,
+        # including any de-padding.  the wrapper receives it as a script integer or double.
+        # only other types (structs) are passed back packed, to be unpacked by script converters.
+        set ${rQal}unpackedByCall $( {struct} ni [get [get ${rQal}passType]::categories] )
         # FFI requires padding the return buffer up to sizeof(ffi_arg).
         # on a big endian machine, that means unpacking from a higher address.
-        #todo: move de-padding implementation into callToNative.  no reason for it to be in script (slow).  store the padding amount in the metaBlob.
         set ${rQal}padding 0
         set sz [get [get ${rQal}passType]::size]
         if {$sz < $::dlr::simple::ffiArg::size && $::dlr::endian eq {be}} {
@@ -567,35 +776,431 @@ proc ::dlr::declareCallToNative {scriptAction  libAlias  returnDescrip  fnName
         }
         set rMeta [selectTypeMeta [get ${rQal}passType]]
     }
+    set ${fQal}typesMeta   $typesMeta
+    set ${fQal}returnMeta  $rMeta
 
     # generate call wrapper script.
-    if {[refreshMeta] || ! [file readable [callWrapperPath $libAlias $fnName]]} {
-        generateCallProc  $libAlias  $fnName  ::dlr::callToNative
+    if {[refreshMeta] || [inputsChanged $libAlias call $fnName [callInputs $libAlias $fnName $declaration]]
+        || ! [file readable [callWrapperPath $libAlias $fnName]]} {
+        generateCallProc  $libAlias  $fnName  bound
+        recordInputs  $libAlias  call  $fnName  [callInputs $libAlias $fnName $declaration]
     }
 
+    # compile a marshaling plan if possible.  when there is one, a planned call command
+    # takes the place of the generated call wrapper.  callBatch also requires the plan.
+    # a compiled call stub, when already loaded, takes the place of both.
+    set ${fQal}plan [compileCallPlan  $libAlias  $fnName]
+
+    prepCallToNative  $scriptAction  $libAlias  $fnName  $errorPolicy  0
+}
+
+# dlr internal command.  the last part of declareCallToNative, once the function's metadata is
+# in place, either parsed from its declaration or loaded from the lib's bundle (fromBundle).
+# that sets up its call commands, and prepares its native parts, which can't be cached.
+proc ::dlr::prepCallToNative {scriptAction  libAlias  fnName  errorPolicy  fromBundle} {
+    set fQal ::dlr::lib::${libAlias}::${fnName}::
+
+    # compile the error policy.  it's kept alive in ${fQal}errorPolicy, for later use by dlrNative.
+    set ${fQal}errorPolicy [compileErrorPolicy  $libAlias  $fnName  $errorPolicy]
+
     #todo: enhance all error messages throughout the project.
     if {$scriptAction ni {noScript wrap cmd}} {
         error "Invalid script action: $scriptAction"
     }
-    if {$scriptAction in {wrap cmd}} {
-        source [callWrapperPath  $libAlias  $fnName]
+
+    set stubbed $( $fnName in [get ::dlr::lib::${libAlias}::stubbedFns] )
+    set planned $( $::dlr::planCalls && $scriptAction in {wrap cmd} && ! $stubbed && [get ${fQal}plan] ne {} )
+    set wrapped $( $scriptAction in {wrap cmd} && ! $planned && ! $stubbed )
+
+    if {$::dlr::lazyBinding && $scriptAction in {wrap cmd} && ! $stubbed} {
+        # the stub resolves the function, and then calls again in the caller's frame, where
+        # any "out" parms' variables are.  by then the real call command has replaced it.
+        set ${fQal}lazy [list $planned $wrapped $fromBundle]
+        proc ${fQal}call {args} "
+            ::dlr::resolveCall  [list $libAlias]  [list $fnName]
+            tailcall  [list ${fQal}call]  {*}\$args
+        "
+    } else {
+        bindCall  $libAlias  $fnName  $planned  $wrapped  $fromBundle
     }
     if {$scriptAction eq {cmd}} {
         alias  ::${libAlias}::$fnName  ::dlr::lib::${libAlias}::${fnName}::call
     }
+}
+
+# resolves a function declared while lazyBinding was on, if that's not done yet.  that happens
+# by itself at its first call through its call command.  but an app must do it first, before
+# using the function's metaBlob or bound call command (callNative) directly.
+proc ::dlr::resolveCall {libAlias  fnName} {
+    set fQal ::dlr::lib::${libAlias}::${fnName}::
+    if {[exists ${fQal}lazy]} {
+        lassign [get ${fQal}lazy]  planned  wrapped  fromBundle
+        bindCall  $libAlias  $fnName  $planned  $wrapped  $fromBundle
+        unset ${fQal}lazy
+    }
+}
+
+# dlr internal command.  returns the declared target type of the pointer a function returns,
+# or an empty string if it doesn't return a pointer, or the pointer's target type is unknown.
+proc ::dlr::returnTargetType {libAlias  fnName} {
+    set rQal ::dlr::lib::${libAlias}::${fnName}::return::
+    if {[exists ${rQal}passType] && [get ${rQal}passType] eq {::dlr::simple::ptr} && [get ${rQal}type] ne {::dlr::simple::ptr}} {
+        return [get ${rQal}type]
+    }
+    return {}
+}
+
+# dlr internal command.  the native steps of declaring a function:  loads its call wrapper if
+# it has one, resolves its symbol, prepares its metaBlob, and binds its call commands.
+proc ::dlr::bindCall {libAlias  fnName  planned  wrapped  fromBundle} {
+    set fQal ::dlr::lib::${libAlias}::${fnName}::
+    set rQal ${fQal}return::
+
+    if {$wrapped} {
+        if {$fromBundle} {
+            eval [dict get [get ::dlr::bundle::${libAlias}::wrappers] $fnName]
+        } else {
+            source [callWrapperPath  $libAlias  $fnName]
+        }
+    }
 
     # prepare a metaBlob to hold dlrNative and FFI data structures.
     # do this last, to prevent an ill-advised callToNative using half-baked metadata
     # after an error preparing the metadata.  callToNative can't happen without this metaBlob.
+    # the plan list is kept alive in ${fQal}plan, for later use in the planned call command.
+    # a pointer returned by the call is tagged with its declared target type, if any.
     prepMetaBlob  ${fQal}meta  [::dlr::fnAddr  $fnName  $libAlias]  \
-        $rMeta  $orderNative  $typesMeta  {}
+        [get ${fQal}returnMeta]  [get ${fQal}orderNative]  [get ${fQal}typesMeta]  {}  \
+        [get ${rQal}unpackedByCall]  [get ${fQal}plan]  \
+        $::dlr::trampolines  [get ${fQal}errorPolicy]  [returnTargetType $libAlias $fnName]
+
+    # create the function's bound call command, which the wrapper uses for the native call.
+    # it holds the metaBlob just prepared, so it must be re-bound after any later prepMetaBlob.
+    # the same goes for the planned call command.
+    bindCallToNative  ${fQal}callNative  ${fQal}meta
+    if {$planned} {
+        bindPlannedCall  ${fQal}call  ${fQal}meta
+    }
+}
+
+# dlr internal command.  validates the given errorPolicy from declareCallToNative,
+# and returns it in the form prepMetaBlob requires, or an empty list if there is none.
+proc ::dlr::compileErrorPolicy {libAlias  fnName  errorPolicy} {
+    if {[llength $errorPolicy] == 0} {
+        return {}
+    }
+    set rQal ::dlr::lib::${libAlias}::${fnName}::return::
+    lassign $errorPolicy  condition  message  errorFnName
+    if {$condition ni {negative nonzero zero null}} {
+        error "Invalid error condition: $condition"
+    }
+    if {$message ni {errno code msgFn codeMsgFn}} {
+        error "Invalid error message source: $message"
+    }
+    set type [get ${rQal}type]
+    if {$type eq {::dlr::simple::void} || ! [get ${rQal}unpackedByCall] || {float} in [get [get ${rQal}passType]::categories]} {
+        error "Error policy requires an integer or pointer return value: $fnName"
+    }
+    set isPointer $( [get ${rQal}passType] eq {::dlr::simple::ptr} || {pointer} in [get ${type}::categories] )
+    if {($condition eq {null}) != $isPointer} {
+        error "Error condition '$condition' doesn't suit the return type of: $fnName"
+    }
+    set errorFn 0
+    if {$message in {msgFn codeMsgFn}} {
+        if {$errorFnName eq {}} {
+            error "Error message source '$message' requires an error function name."
+        }
+        set errorFn [::dlr::fnAddr  $errorFnName  $libAlias]
+    }
+    return [list  $condition  $message  $errorFn  $fnName]
+}
+
+# declares that the given native functions are thread-safe, so callBatch may split their calls
+# across worker threads.  they must already be declared.  that's true of most pure functions
+# (those that depend only on their arguments).  it's not true of many others.
+proc ::dlr::declareThreadSafe {libAlias  fnNames} {
+    foreach fnName $fnNames {
+        set fQal ::dlr::lib::${libAlias}::${fnName}::
+        if { ! [exists ${fQal}meta] && ! [exists ${fQal}lazy]} {
+            error "Function isn't declared: $fnName"
+        }
+        set ${fQal}threadSafe 1
+    }
+}
+
+# dlr internal command.  returns true if any of the function's parms is a callback type.
+proc ::dlr::hasCallbackParms {libAlias  fnName} {
+    set fQal ::dlr::lib::${libAlias}::${fnName}::
+    set parmCategories [concat {*}[lmap p [get ${fQal}parmOrder] {get [get ${fQal}parm::${p}::type]::categories}]]
+    return $( {callback} in $parmCategories )
+}
+
+# calls the given declared native function once for each tuple of arguments in argTupleList,
+# all in C, and returns a list of the results.  that avoids the dispatch cost of a separate
+# call command for each one.  each tuple gives a value for every parm, in the order of the
+# function's declaration, including "out" and "inOut" parms.  each result is the function's
+# return value, or if it has any "out" or "inOut" parms, a list of the return value followed
+# by the values of those parms.
+# with -threads N, the calls are split across N threads, at most one per online CPU.
+# that requires declareThreadSafe.
+# an error policy is applied to every call.  the first failed call raises an error, after all
+# calls are done.  error policies taking the message from msgFn aren't supported here.
+# callbacks can only run on the interpreter's thread, so a function with callback parms
+# can't be split across threads.  an error raised by a callback is raised after all calls are done.
+# this supports only functions whose marshaling plan has no script converters (no structs).
+proc ::dlr::callBatch {libAlias  fnName  argTupleList  args} {
+    set fQal ::dlr::lib::${libAlias}::${fnName}::
+    set threads 1
+    foreach {option value} $args {
+        if {$option ne {-threads}} {
+            error "Invalid option: $option"
+        }
+        set threads $value
+    }
+    if {$threads > 1 && ! [exists ${fQal}threadSafe]} {
+        error "Function isn't declared thread-safe: $fnName"
+    }
+    if {$threads > 1 && [hasCallbackParms $libAlias $fnName]} {
+        error "Function with callback parms can't be split across threads: $fnName"
+    }
+    resolveCall  $libAlias  $fnName
+    return [native::callBatch  ${fQal}meta  $argTupleList  $threads]
+}
+
+# queues a call to the given declared native function, to run on a worker thread, and returns
+# immediately.  argList gives a value for every parm, the same as one tuple for callBatch.
+# when the call finishes, Jim's event loop evaluates the callback command prefix at global level,
+# with the result appended as one more argument.  the result is the same as for callBatch.
+# so the app must enter the event loop (e.g. vwait) for callbacks to happen.
+# that requires declareThreadSafe, and supports the same functions as callBatch, except those
+# with callback parms, since callbacks can only run on the interpreter's thread.
+# if the function's error policy says the call failed, the error is reported through bgerror
+# instead of evaluating the callback.
+proc ::dlr::callAsync {libAlias  fnName  argList  callback} {
+    set fQal ::dlr::lib::${libAlias}::${fnName}::
+    if { ! [exists ${fQal}threadSafe]} {
+        error "Function isn't declared thread-safe: $fnName"
+    }
+    if {[hasCallbackParms $libAlias $fnName]} {
+        error "Function with callback parms can't be called asynchronously: $fnName"
+    }
+    resolveCall  $libAlias  $fnName
+    native::callAsync  ${fQal}meta  $argList  $callback  $::dlr::asyncWorkers
+    return {}
+}
+
+# declares a callback type.  that's the signature of a native function pointer, which native
+# code calls, and which is implemented by a script command.  afterwards the type may be used
+# for parms and members like ptr, with scriptForm asInt.  create its function pointers
+# with ::dlr::callback::create.
+# returnDescrip is void, or {byVal type scriptForm} for a scalar type.
+# parmsDescrip has the same format as for declareCallToNative, except the only direction is "in".
+# native code's arguments are converted for the script the same way as return values:
+# scalars in C, byVal structs by their unpack-byVal converter, and byPtr structs and
+# strings by their scriptPtr unpackers.  the memory they point to always belongs to the native code.
+# callbacks work only while native code is running on the interpreter's thread, during a call from dlr.
+proc ::dlr::declareCallbackType {libAlias  returnDescrip  typeName  parmsDescrip} {
+    set tQal ::dlr::lib::${libAlias}::callback::${typeName}::
+
+    set order [list]
+    set typesMeta [list]
+    set plan [list]
+    foreach parmDesc $parmsDescrip {
+        lassign $parmDesc  dir  passMethod  type  name  scriptForm  memAction
+        lappend order $name
+        set pQal ${tQal}parm::${name}::
+
+        if {$dir ne {in}} {
+            error "Callback parms support only 'in' direction: $name"
+        }
+        if {$passMethod ni {byVal byPtr}} {
+            error "Callback parms support only passMethods byVal, byPtr: $name"
+        }
+        ::dlr::parseParmDescrip  $libAlias  $pQal  $dir  \
+            $passMethod  $type  $name  $scriptForm  $memAction
+
+        lappend typesMeta [selectTypeMeta [get ${pQal}passType]]
+        lappend plan {*}[compileCallbackStep $pQal]
+    }
+    set ${tQal}parmOrder $order
+    # keep alive the plan, for the unpacker names the pool holds.
+    set ${tQal}plan $plan
+
+    set rQal ${tQal}return::
+    if {$returnDescrip eq {void}} {
+        set ${rQal}type  ::dlr::simple::void
+        set rMeta        ::dlr::simple::void::ffiTypeCode
+    } else {
+        lassign $returnDescrip  passMethod  type  scriptForm
+        set fullType [qualifyTypeName $type $libAlias]
+        validateTypeName $fullType
+        validateScriptForm $fullType $scriptForm
+        if {$passMethod ne {byVal} || $scriptForm ni {asInt asDouble} || ! [exists ${fullType}::ffiTypeCode]} {
+            error "Callback return value supports only byVal scalar types."
+        }
+        set ${rQal}type  $fullType
+        set rMeta        ${fullType}::ffiTypeCode
+    }
+
+    # the type passes to and from native code just like ptr.
+    set ${tQal}categories   [list pointer callback]
+    set ${tQal}scriptForms  [list asInt]
+    foreach v {ffiTypeCode size bits} {
+        set ${tQal}$v  [get ::dlr::simple::ptr::$v]
+    }
+    foreach conversion {pack unpack} {
+        alias  ${tQal}${conversion}-byVal-asInt  ::dlr::simple::ptr::${conversion}-byVal-asInt
+    }
+
+    # create the pool command last, so qualifyTypeName finds only complete types.
+    native::prepCallbackType  ${tQal}pool  $rMeta  $typesMeta  [get ${tQal}plan]  $::dlr::callbackPrealloc
+}
+
+# dlr internal command.  returns the step for one callback parm, for prepCallbackType.
+# the fields of each step are:  kind, ffiTypeCode, unpacker.
+proc ::dlr::compileCallbackStep {pQal} {
+    foreach v {passMethod type scriptForm} {
+        set $v [get ${pQal}$v]
+    }
+    set categories [get ${type}::categories]
+    if {{struct} in $categories} {
+        if {$passMethod eq {byVal}} {
+            return [list  bytes  0  [converterName  unpack  $type  byVal  $scriptForm  {}]]
+        }
+        return [list  pointer  0  [converterName  unpack  $type  scriptPtr  $scriptForm  {}]]
+    }
+    if {$type eq {::dlr::simple::ascii} && $passMethod eq {byPtr}} {
+        return [list  pointer  0  [converterName  unpack  $type  scriptPtr  $scriptForm  {}]]
+    }
+    if {$passMethod eq {byVal} && $scriptForm in {asInt asDouble} && [exists ${type}::ffiTypeCode]} {
+        return [list  scalar  [get ${type}::ffiTypeCode]  {}]
+    }
+    error "Callback parm type isn't supported: $passMethod $type $scriptForm"
+}
+
+# binds a closure of the given callback type to the command prefix, and returns its
+# native function pointer, as an integer.  native code calling that pointer evaluates the
+# command prefix with the converted arguments appended.  the command's result is the
+# return value.  an error in the command is raised by the dlr call that led to it, once
+# the native code returns.  until then, the native code receives a return value of 0.
+# closures are pooled per callback type, so this is fast enough to do for each call.
+proc ::dlr::callback::create {libAlias  typeName  cmdPrefix} {
+    return [::dlr::lib::${libAlias}::callback::${typeName}::pool  acquire  $cmdPrefix]
+}
+
+# returns the closure to its pool.  native code must not call the pointer after this.
+proc ::dlr::callback::release {libAlias  typeName  fnPointer} {
+    ::dlr::lib::${libAlias}::callback::${typeName}::pool  release  $fnPointer
+}
+
+# creates a callback, and evaluates script in the caller's scope with its function
+# pointer in variable fnPointerVarName.  the callback is released afterwards, even after an error.
+proc ::dlr::callback::with {libAlias  typeName  cmdPrefix  fnPointerVarName  script} {
+    upvar 1 $fnPointerVarName fnPointer
+    set fnPointer [create  $libAlias  $typeName  $cmdPrefix]
+    try {
+        return [uplevel 1 $script]
+    } finally {
+        release  $libAlias  $typeName  $fnPointer
+    }
+}
+
+# compile a marshaling plan for the given declared function, from its parm and return metadata.
+# the plan lets a planned call command do all the work of the generated call wrapper in one
+# C command, with no script at all for scalars and strings.  structs are still converted by
+# their script converters, called from C.
+# returns a flat list of steps, one per parm plus one for the return value, for prepMetaBlob.
+# or, returns an empty list if any parm needs something only a call wrapper can do, such as asNative.
+proc ::dlr::compileCallPlan {libAlias  fnName} {
+    set fQal ::dlr::lib::${libAlias}::${fnName}::
+    set plan [list]
+    foreach parmBare [get ${fQal}parmOrder] {
+        set step [compilePlanStep ${fQal}parm::${parmBare}::]
+        if {$step eq {}} {
+            return {}
+        }
+        lappend plan {*}$step
+    }
+    set step [compilePlanStep ${fQal}return::]
+    if {$step eq {}} {
+        return {}
+    }
+    lappend plan {*}$step
+    return $plan
+}
+
+# dlr internal command.  returns one step of a marshaling plan, or an empty list if the
+# given parm (or return value) is unsupported.  the fields of each step are:
+#   dir flags, passMethod, kind, ffiTypeCode, memAction, packer, unpacker, bufVarName.
+proc ::dlr::compilePlanStep {pQal} {
+    if {[get ${pQal}type] eq {::dlr::simple::void}} {
+        return [list  0  byVal  void  0  {}  {}  {}  {}]
+    }
+    foreach v {dir passMethod type scriptForm memAction} {
+        set $v [get ${pQal}$v]
+    }
+    set flags $( $dir eq {return}  ?  0  :  [dict get $::dlr::dlrFlags dir_$dir] )
+    set categories [get ${type}::categories]
+
+    if {$scriptForm eq {asNative}} {
+        # only a borrowed blob can be passed without a call wrapper.
+        if {$memAction eq {borrow}} {
+            return [list  $flags  $passMethod  bytes  0  borrow  {}  {}  {}]
+        }
+        return {}
+    }
+    if {$passMethod eq {byVal} && $dir ni {in return}} {
+        return {}
+    }
+
+    if {{struct} in $categories} {
+        # converted by calling the struct's script converters.
+        set packer   [converterName  pack    $type  byVal  $scriptForm  {}]
+        set unpacker [converterName  unpack  $type  byVal  $scriptForm  {}]
+        if {$passMethod eq {byPtrPtr} || ($passMethod eq {byPtr} && $dir eq {return})} {
+            # the native function gives out the pointer.  scriptPtr unpacker implements the memAction.
+            set unpacker [converterName  unpack  $type  scriptPtr  $scriptForm  $memAction]
+        } elseif {$memAction ne {}} {
+            return {}
+        }
+        if { ! [exists -command $packer] || ! [exists -command $unpacker]} {
+            return {}
+        }
+        return [list  $flags  $passMethod  script  0  $memAction  $packer  $unpacker  ${pQal}targetNative]
+    }
+
+    if {$type eq {::dlr::simple::ascii}} {
+        # length-bounded strings are unpacked by the call wrapper.
+        if {[get ${pQal}count] ne {}} {
+            return {}
+        }
+        if {$passMethod eq {byPtr} && $dir in {in return}} {
+        } elseif {$passMethod eq {byPtr} && $dir eq {inOut} && $memAction eq {}} {
+        } elseif {$passMethod eq {byPtrPtr} && $dir eq {out}} {
+        } else {
+            return {}
+        }
+        return [list  $flags  $passMethod  ascii  0  $memAction  {}  {}  {}]
+    }
+
+    # all other types must be simple scalars, or enums.
+    if {$scriptForm ni {asInt asDouble} || ! [exists ${type}::ffiTypeCode]} {
+        return {}
+    }
+    if {$passMethod eq {byPtrPtr} || ($passMethod eq {byPtr} && ($dir eq {return} || $memAction ne {}))} {
+        return {}
+    }
+    return [list  $flags  $passMethod  scalar  [get ${type}::ffiTypeCode]  {}  {}  {}  {}]
 }
 
 # returns a boolean expression that can check for the null pointer flag at run time.
 # some scriptForm's have code here to try and avoid shimmering, for more speed.
 proc ::dlr::nullTestExpression {parmBare scriptForm} {
-    if {$scriptForm in {asString asNative}} {
+    if {$scriptForm eq {asString}} {
         return " \$$parmBare eq {$::dlr::nullPtrFlag} "
+    } elseif {$scriptForm eq {asNative}} {
+        # this doesn't generate a string rep of a native buffer, just to compare it.
+        return " \[ ::dlr::native::isNullFlag \$$parmBare \] "
     } elseif {$scriptForm eq {asList}} {
         return " \[ llength \$$parmBare \] == 0 "
     } elseif {$scriptForm eq {asDict}} {
@@ -642,6 +1247,12 @@ proc ::dlr::nullFlagValue {scriptForm} {
 # if needed, the script app can also supply its own call wrapper proc, or use none at all,
 # instead of using generateCallProc.  look to the generated wrapper procs for examples.
 # sometimes more speed can be found with handwritten code.
+#
+# callCommand is either a generic call command such as ::dlr::callToNative, which will be
+# given the name of the metaBlob variable at run time, or the word 'bound'.  'bound' calls
+# the function's own bound call command instead:
+#   ::dlr::lib::${libAlias}::${fnName}::callNative
+# that's faster, because it finds the metaBlob and argument variables without any lookups.
 proc ::dlr::generateCallProc {libAlias  fnName  callCommand} {
     set fQal ::dlr::lib::${libAlias}::${fnName}::
 
@@ -673,8 +1284,9 @@ proc ::dlr::generateCallProc {libAlias  fnName  callCommand} {
         set targetNative ${pQal}targetNative
         set    ptrNative ${pQal}ptrNative
         set ptrPtrNative ${pQal}ptrPtrNative
-        if {$scriptForm eq {asNative}} {
+        if {$scriptForm eq {asNative} || $memAction eq {borrow}} {
             # use the given variable instead of the usual ${pQal}targetNative.
+            # for a borrowed string, addrOf then points straight at the script value's bytes.
             set targetNative $parmBare
         }
 
@@ -683,9 +1295,19 @@ proc ::dlr::generateCallProc {libAlias  fnName  callCommand} {
         # before the call.  that makes sense because ordinary C code always does that.
         set packer [converterName pack $type byVal $scriptForm {}]
         set packerCall "$packer  $targetNative  \$$parmBare"
-        if {$scriptForm eq {asNative}} {
+        if {$scriptForm eq {asNative} || $memAction eq {borrow}} {
             set packerCall {}
         }
+        # an array with a count is never null.  the count comes from a literal, or another parm.
+        set nullTest [nullTestExpression $parmBare $scriptForm]
+        if {$isArray && $count ne {}} {
+            if {[string is integer $count]} {
+                append packerCall "  $count"
+            } else {
+                append packerCall "  \$$count"
+            }
+            set nullTest 0
+        }
         if {$passMethod eq {byVal}} {
             append body "\n    $packerCall \n"
         } else {
@@ -698,7 +1320,7 @@ proc ::dlr::generateCallProc {libAlias  fnName  callCommand} {
 
             # check for the null pointer flag at run time.
             append body "
-    if { [nullTestExpression $parmBare $scriptForm] } {
+    if { $nullTest } {
         ::dlr::pack-null  $ptrNative \n
     } else {
         $packerCall
@@ -717,18 +1339,29 @@ proc ::dlr::generateCallProc {libAlias  fnName  callCommand} {
     # call native function.
     #todo: see how much time is saved by specifying native callCommand's instead of aliases.  change at the 2 calls to generateCallProc.
     set rQal ${fQal}return::
+    set callScript $( $callCommand eq {bound}  ?  "${fQal}callNative"  :  "$callCommand  ${fQal}meta" )
     if {[get ${rQal}type] eq {::dlr::simple::void}} {
-        append body "\n    $callCommand  ${fQal}meta \n"
+        append body "\n    $callScript \n"
     } else {
         # return value will be placed in one of 3 vars depending on passMethod.
-        append body "\n    set  [get ${rQal}nativeVarName]  \[ $callCommand  ${fQal}meta \] \n"
+        append body "\n    set  [get ${rQal}nativeVarName]  \[ $callScript \] \n"
     }
 
-    # unpack "out" parms.
+    # unpack "out" parms.  a string whose length is given by another parm is unpacked
+    # after the others, so that parm has its unpacked value by then.
+    set deferred [list]
     foreach  parmBare  [get ${fQal}parmOrder]   {
         set pQal ${fQal}parm::${parmBare}::
+        if {[get ${pQal}type] eq {::dlr::simple::ascii} && [get ${pQal}count] ni {{} return}
+            && ! [string is integer [get ${pQal}count]]} {
+            lappend deferred $parmBare
+            continue
+        }
         append body [generateUnpackParm  $pQal  $parmBare  \$addrOf$parmBare ]
     }
+    foreach  parmBare  $deferred   {
+        append body [generateUnpackParm  ${fQal}parm::${parmBare}::  $parmBare  \$addrOf$parmBare ]
+    }
 
     # unpack return value.
     if {[get ${rQal}type] ne {::dlr::simple::void}} {
@@ -736,12 +1369,10 @@ proc ::dlr::generateCallProc {libAlias  fnName  callCommand} {
         # the address is not needed for most passMethods.
         set targetNativeAddrScript 0
         # ... but it is needed for byPtr.  here the address is simply fetched from nativeVarName
-        # (typically 'ptrNative' in $rQal namespace), since that is the variable libffi
-        # wrote to during the native function call.  however the fetched address is in
-        # binary, and will have to be unpacked asInt for use as a scriptPtr.
+        # (typically 'ptrNative' in $rQal namespace), since that is the variable the native
+        # call's result was stored in.  callToNative already unpacked it asInt, for use as a scriptPtr.
         if {[get ${rQal}passMethod] eq {byPtr}} {
-            set targetNativeAddrScript  \
-                " \[ ::dlr::simple::ptr::unpack-byVal-asInt  \$[get ${rQal}nativeVarName]  \$${rQal}padding \] "
+            set targetNativeAddrScript  " \$[get ${rQal}nativeVarName] "
         }
         # use that to generateUnpackParm.
         append body [generateUnpackParm  $rQal  junk  $targetNativeAddrScript ]
@@ -771,7 +1402,7 @@ proc ::dlr::generateUnpackParm {pQal  parmBare  targetNativeAddrScript} {
         # pointer given out by the native function must be unpacked first.
         append body "\n    set  $ptr  \[ ::dlr::simple::ptr::unpack-byVal-asInt  \$$ptrNative  $paddingScript\] \n"
         set unpacker [converterName unpack $type scriptPtr $scriptForm $memAction]
-        append body "\n    $setScript  \[ $unpacker  \$$ptr \] \n"
+        append body [generatePtrUnpack  $pQal  $unpacker  \$$ptr  $setScript]
         #todo: asNative requires a memcpy here, to bring the data under Jim's management.
     }}
     local proc strat-byPtrMemOther {} { uplevel 1 {
@@ -781,19 +1412,21 @@ proc ::dlr::generateUnpackParm {pQal  parmBare  targetNativeAddrScript} {
         # more importantly, a byPtr unpacker can access a buffer that's not in any
         # Jim variable, such as a buffer provided by the native function.
         set unpacker [converterName unpack $type scriptPtr $scriptForm $memAction]
-        append body "\n    $setScript  \[ $unpacker  $targetNativeAddrScript \] \n"
+        append body [generatePtrUnpack  $pQal  $unpacker  $targetNativeAddrScript  $setScript]
     }}
 # for out parms: asNative requires a doNothing instead, since the data is already under Jim's management.
 #todo: move that comment to the new comments area under the table.
     local proc strat-byPtrMemAsNativeRtn {} { uplevel 1 {
         # for return value: asNative requires a memcpy here, to bring the data under Jim's management.
         set sz [get [get ${pQal}type]::size]
-        # pointer given out by the native function must be unpacked first.
-        append body "\n    set  $ptr  \[ ::dlr::simple::ptr::unpack-byVal-asInt  \$$ptrNative  $paddingScript\] \n"
-        append body "\n    ::dlr::copyToBufferVar  $alwaysTargetNative  $sz  \$$ptr \n"
+        # pointer given out by the native function was already unpacked by callToNative.
+        append body "\n    set  $ptr  \$$ptrNative \n"
 #todo: support extensible memActions here (and elsewhere?).  pull the cleanup command name from a dict of memactions.
         if {$memAction eq {free}} {
-            append body "\n    ::dlr::freeHeap \$$ptr \n"
+            # a native buffer takes ownership of the block instead, and frees it later.  no copy.
+            append body "\n    set  $alwaysTargetNative  \[ ::dlr::wrapBuffer  \$$ptr  $sz  1 \] \n"
+        } else {
+            append body "\n    ::dlr::copyToBufferVar  $alwaysTargetNative  $sz  \$$ptr \n"
         }
         append body "\n    return \$$alwaysTargetNative \n"
     }}
@@ -806,8 +1439,13 @@ proc ::dlr::generateUnpackParm {pQal  parmBare  targetNativeAddrScript} {
         # asNative requires a no-op here, since the native function wrote directly to parmBare var.
     }}
     local proc strat-byValOther {} { uplevel 1 {
-        set unpacker [converterName unpack $type byVal $scriptForm {}]
-        append body "\n    $setScript  \[ $unpacker  \$$targetNative  $paddingScript \] \n"
+        if {$unpackedByCall} {
+            # callToNative already unpacked the return value, and de-padded it.
+            append body "\n    $setScript  \$$targetNative \n"
+        } else {
+            set unpacker [converterName unpack $type byVal $scriptForm {}]
+            append body "\n    $setScript  \[ $unpacker  \$$targetNative  $paddingScript \] \n"
+        }
     }}
 
     # set up local names to access all the metadata for this parm.
@@ -895,6 +1533,9 @@ puts "$dir  $passMethod  $scriptForm  $managedType"
         set targetNative $parmBare
     }
     set paddingScript $( $dir eq {return} && $padding > 0  ?  $padding  :  {} )
+    if {$dir ne {return}} {
+        set unpackedByCall 0
+    }
     set setScript $( $dir eq {return}  ?  {return} : "set  $parmBare" )
 
     #todo: support nulls at run time.
@@ -903,22 +1544,110 @@ puts "$dir  $passMethod  $scriptForm  $managedType"
     return $body
 }
 
+# dlr internal command.  returns script to unpack the target of a pointer with the given
+# scriptPtr unpacker, and assign the result per setScript.  an ascii parm with a length bound
+# uses a bounded unpacker instead, and then implements its memAction itself.
+proc ::dlr::generatePtrUnpack {pQal  unpacker  ptrScript  setScript} {
+    set bound [get ${pQal}count]
+    if {[get ${pQal}type] ne {::dlr::simple::ascii} || $bound eq {}} {
+        return "\n    $setScript  \[ $unpacker  $ptrScript \] \n"
+    }
+    set bounded ::dlr::simple::ascii::unpack-scriptPtr-asStringLen
+    if {[string is integer $bound]} {
+        set bounded ::dlr::simple::ascii::unpack-scriptPtr-asStringMax
+        set lenScript $bound
+    } elseif {$bound eq {return}} {
+        # callToNative already unpacked the integer return value into its native var.
+        regsub {parm::[^:]+::$} $pQal {} fQal
+        set lenScript \$[get ${fQal}return::nativeVarName]
+    } else {
+        set lenScript \$$bound
+    }
+    if {[get ${pQal}memAction] ne {free}} {
+        return "\n    $setScript  \[ $bounded  $ptrScript  $lenScript \] \n"
+    }
+    set p ${pQal}ptr
+    set unpacked ${pQal}unpacked
+    return "
+    set  $p  $ptrScript
+    set  $unpacked  \[ $bounded  \$$p  $lenScript \]
+    ::dlr::freeHeap  \$$p
+    $setScript  \$$unpacked
+    "
+}
+
 # this is the required first step before using a struct type.
 #todo: documentation
 proc ::dlr::declareStructType {scriptAction  libAlias  structTypeName  membersDescrip} {
-    configureStructType  $libAlias  $structTypeName  $membersDescrip
-    if {[refreshMeta] || ! [file readable [structConverterPath $libAlias $structTypeName]]} {
-        detectStructLayout  $libAlias  $structTypeName
-        validateStructType  $libAlias  $structTypeName
-        generateStructConverters  $libAlias  $structTypeName
-    } else {
-        validateStructType  $libAlias  $structTypeName
-    }
+    declareStructTypes  $scriptAction  $libAlias  [list $structTypeName $membersDescrip]
+}
+
+# declares many struct types of one lib at once.  declarations is a flat list of
+# structTypeName membersDescrip pairs, each the same as for declareStructType.
+# the layouts of all of them that need detecting are detected together, with one compile
+# of one C program, instead of one per struct.  for a big lib that saves most of the
+# time spent by refreshMeta.
+proc ::dlr::declareStructTypes {scriptAction  libAlias  declarations} {
     if {$scriptAction ni {noScript convert}} {
         error "Invalid script action: $scriptAction"
     }
-    if {$scriptAction eq {convert}} {
-        source [structConverterPath  $libAlias  $structTypeName]
+    set detect [list]
+    set fromBundle [list]
+    foreach {structTypeName membersDescrip} $declarations {
+        set sQal ::dlr::lib::${libAlias}::struct::${structTypeName}::
+        lappend ::dlr::bundle::${libAlias}::structs $structTypeName
+        if {[bundled $libAlias ${sQal}declaration $membersDescrip]
+            && ! [inputsChanged $libAlias struct $structTypeName $membersDescrip]} {
+            # all the metadata was loaded from the lib's bundle, already validated.
+            lappend fromBundle $structTypeName
+            continue
+        }
+        dropBundled  $libAlias  $sQal
+        set ${sQal}declaration $membersDescrip
+        configureStructType  $libAlias  $structTypeName  $membersDescrip
+        if {[refreshMeta] || [inputsChanged $libAlias struct $structTypeName $membersDescrip]
+            || ! [file readable [structConverterPath $libAlias $structTypeName]]} {
+            lappend detect $structTypeName
+        }
+    }
+    if {[llength $detect] > 0} {
+        detectStructLayouts  $libAlias  $detect
+    }
+    foreach {structTypeName membersDescrip} $declarations {
+        set sQal ::dlr::lib::${libAlias}::struct::${structTypeName}::
+        if {$structTypeName in $fromBundle} {
+            # the same FFI type record as validateStructType prepares.
+            set typeMeta [lmap mName [get ${sQal}memberOrder] {selectTypeMeta [get ${sQal}member::${mName}::type]}]
+            ::dlr::prepStructType  ${sQal}meta  $typeMeta  [get ${sQal}memberTable]  [get ${sQal}size]
+        } else {
+            validateStructType  $libAlias  $structTypeName
+        }
+        if {$structTypeName in $detect} {
+            generateStructConverters  $libAlias  $structTypeName
+            recordInputs  $libAlias  struct  $structTypeName  $membersDescrip
+        }
+        if {$scriptAction eq {convert}} {
+            if {$::dlr::structCodec} {
+                aliasStructCodec  $libAlias  $structTypeName
+            } elseif {$structTypeName in $fromBundle} {
+                eval [dict get [get ::dlr::bundle::${libAlias}::converters] $structTypeName]
+            } else {
+                source [structConverterPath  $libAlias  $structTypeName]
+            }
+        }
+    }
+}
+
+# dlr internal command.  sets up the struct's converters to use the struct codec in dlrNative,
+# instead of the generated converter procs.  those are the same converters, with the same args,
+# but each one is a single C command.
+proc ::dlr::aliasStructCodec {libAlias  structTypeName} {
+    set sQal ::dlr::lib::${libAlias}::struct::${structTypeName}::
+    foreach scriptForm {asList asDict} {
+        alias  ${sQal}pack-byVal-${scriptForm}    ::dlr::native::structPack    ${sQal}meta  $scriptForm
+        alias  ${sQal}unpack-byVal-${scriptForm}  ::dlr::native::structUnpack  ${sQal}meta  $scriptForm
+        alias  ${sQal}unpack-scriptPtr-${scriptForm}       ::dlr::struct::unpack-scriptPtr  $scriptForm  [string trimright $sQal :]
+        alias  ${sQal}unpack-scriptPtr-${scriptForm}-free  ::dlr::struct::unpack-scriptPtr-free  $scriptForm  [string trimright $sQal :]
     }
 }
 
@@ -943,6 +1672,9 @@ proc ::dlr::configureStructType {libAlias  structTypeName  membersDescrip} {
         set ${mQal}type $mFullType
 
         validateScriptForm $mFullType $mScriptForm
+        if {$mScriptForm eq {asList}} {
+            error "Library '$libAlias' struct '$structTypeName' member '$mName' can't be an array."
+        }
         set ${mQal}scriptForm $mScriptForm
     }
 }
@@ -964,6 +1696,7 @@ proc ::dlr::validateStructType {libAlias  structTypeName} {
     set ${sQal}size $sDic(size)
     set membersRemain [dict keys $sDic(members)]
     set typeMeta [list]
+    set memberTable [list]
     foreach mName [get ${sQal}memberOrder] {
         set mQal ${sQal}member::${mName}::
         set mFullType [get ${mQal}type]
@@ -977,6 +1710,7 @@ proc ::dlr::validateStructType {libAlias  structTypeName} {
 
         set mDic [dict get $sDic members $mName]
         set ${mQal}offset $mDic(offset)
+        lappend memberTable  $mName  [get ${mFullType}::ffiTypeCode]  $mDic(offset)
 
         if {$mDic(size) != [get ${mFullType}::size]} {
             error "Library '$libAlias' struct '$typ' member '$mName' declared type does not match its size in the detected metadata."
@@ -986,9 +1720,12 @@ proc ::dlr::validateStructType {libAlias  structTypeName} {
         # this could happen e.g. if the cached metadata was generated with an earlier version of the declaration.
         error "Library '$libAlias' struct '$typ' member '[lindex $membersRemain 0]' is mentioned in the detected metadata but not in the given declaration."
     }
+    # member table for the struct codec and unpackArray.
+    set ${sQal}memberTable $memberTable
 
     # prep FFI type record for this structure.  do this last of all.
-    ::dlr::prepStructType  ${sQal}meta  $typeMeta
+    # the struct codec holds its own reference to the member table, so it survives any reset of ${sQal}memberTable.
+    ::dlr::prepStructType  ${sQal}meta  $typeMeta  [get ${sQal}memberTable]  [get ${sQal}size]
 }
 
 #todo: documentation similar to generateCallProc
@@ -1014,7 +1751,7 @@ proc ::dlr::generateStructConverters {libAlias  structTypeName} {
     # generate pack-byVal-asList.
     set body "
     lassign \$unpackedData  [join $memberTemps {  }]
-    ::dlr::createBufferVar  \$packVarName  [get ${sQal}size]
+    ::dlr::createBufferVar  \$packVarName  \$( \$offsetBytes + [get ${sQal}size] )
     "
     foreach  mName [get ${sQal}memberOrder]  mTemp $memberTemps  {
         set mQal ${sQal}member::${mName}::
@@ -1030,7 +1767,7 @@ proc ::dlr::generateStructConverters {libAlias  structTypeName} {
     lappend procs "proc  ${sQal}pack-byVal-asList  { $packerParms }  { \n$body \n}"
 
     # generate pack-byVal-asDict
-    set body "\n    ::dlr::createBufferVar  \$packVarName  [get ${sQal}size] \n"
+    set body "\n    ::dlr::createBufferVar  \$packVarName  \$( \$offsetBytes + [get ${sQal}size] ) \n"
     foreach  mName [get ${sQal}memberOrder]  {
         set mQal ${sQal}member::${mName}::
         set packer [converterName   pack  [get ${mQal}type]  byVal  [get ${mQal}scriptForm]  {}]
@@ -1084,27 +1821,46 @@ proc ::dlr::generateStructConverters {libAlias  structTypeName} {
 # works with either gcc or clang.
 # struct layout metadata is returned, and also cached in the binding dir.
 proc ::dlr::detectStructLayout {libAlias  typeName} {
-    set sQal ::dlr::lib::${libAlias}::struct::${typeName}::
+    return [dict get [detectStructLayouts $libAlias [list $typeName]] $typeName]
+}
+
+# detects the layouts of the given struct types, all with one compile of one C program.
+# returns a dictionary of layout metadata by type name.  each type's layout is also cached
+# in its own .struct file in the binding dir, the same as for a single type.
+# in includes.h, $sQal refers to the first of the types.
+proc ::dlr::detectStructLayouts {libAlias  typeNames} {
+    if {$::dlr::structLayoutSource eq {dwarf}} {
+        return [readStructLayouts $libAlias $typeNames]
+    }
+    set sQal ::dlr::lib::${libAlias}::struct::[lindex $typeNames 0]::
 
     # determine paths.
     set cFn      [file join $::dlr::bindingDir $libAlias auto detectStructLayout.c]
     set binFn    [file join $::dlr::bindingDir $libAlias auto detectStructLayout]
-    set layoutFn [file join $::dlr::bindingDir $libAlias auto $typeName.struct]
     set headerFn [file join $::dlr::bindingDir $libAlias script includes.h]
     file mkdir [file dirname $cFn]
     file mkdir [file dirname $binFn]
-    file mkdir [file dirname $layoutFn]
 
     # read header file of #include's.
     set hdr [open $headerFn r]
     set includes [subst -nobackslashes [read $hdr]]
     close $hdr
 
-    # generate C source code to extract metadata.
-    foreach mName [get ${sQal}memberOrder] {
-        append membCode "
+    # generate C source code to extract metadata.  the output is a dictionary with one
+    # element per type.  each element's value is the same text as a .struct file.
+    set typeCode {}
+    foreach typeName $typeNames {
+        set membCode {}
+        foreach mName [get ::dlr::lib::${libAlias}::struct::${typeName}::memberOrder] {
+            append membCode "
             printf(\"    {$mName} {size %zu offset %zu }\\n\",
-                sizeof( a.$mName ), offsetof($typeName, $mName) );
+                sizeof( ((${typeName}*)0)->$mName ), offsetof($typeName, $mName) );
+            "
+        }
+        append typeCode "
+            printf(\"{$typeName} {name {$typeName} size %zu members {\\n\", sizeof($typeName));
+            $membCode
+            puts(\"}\\n}\");
         "
     }
     set src [open $cFn w]
@@ -1115,24 +1871,47 @@ proc ::dlr::detectStructLayout {libAlias  typeName} {
         $includes
 
         int main (int argc, char **argv) {
-            $typeName a;
-            printf(\"name {$typeName} size %zu members {\\n\", sizeof($typeName));
-            $membCode
-            puts(\"}\\n\");
+            $typeCode
         }
     "
     close $src
 
     # compile and execute C code.
+    set flags [list]
     eval $::dlr::compiler
-    set dic [exec $binFn]
+    set layouts [exec $binFn]
+
+    cacheStructLayouts  $libAlias  $layouts
+    return $layouts
+}
+
+# reads the layouts of the given struct types from the lib's DWARF debug info, with no compile.
+# returns the same dictionary as detectStructLayouts, and caches it the same way.
+# only types that the lib's own code uses are found there.
+proc ::dlr::readStructLayouts {libAlias  typeNames} {
+    set fn [get ::dlr::lib::${libAlias}::fileNamePath]
+    if {[exists ::dlr::lib::${libAlias}::debugFile]} {
+        set fn [get ::dlr::lib::${libAlias}::debugFile]
+    }
+    set request [list]
+    foreach typeName $typeNames {
+        lappend request  $typeName  [get ::dlr::lib::${libAlias}::struct::${typeName}::memberOrder]
+    }
+    set layouts [native::dwarfStructLayouts $fn $request]
 
-    # cache metadata in binding dir.
-    set lay [open $layoutFn w]
-    puts $lay $dic
-    close $lay
+    cacheStructLayouts  $libAlias  $layouts
+    return $layouts
+}
 
-    return $dic
+# caches each type's layout metadata in its own .struct file in the binding dir.
+proc ::dlr::cacheStructLayouts {libAlias  layouts} {
+    dict for {typeName layout} $layouts {
+        set layoutFn [file join $::dlr::bindingDir $libAlias auto $typeName.struct]
+        file mkdir [file dirname $layoutFn]
+        set lay [open $layoutFn w]
+        puts $lay [string trim $layout]
+        close $lay
+    }
 }
 
 
@@ -1144,24 +1923,515 @@ proc ::dlr::structConverterPath {libAlias  structTypeName} {
     return [file join $::dlr::bindingDir $libAlias auto $structTypeName.convert.tcl]
 }
 
-# does a copyToBufferVar followed by unpack-byVal.
+# the lib's call stubs are all in one Jim extension.  its filename determines its init function's name.
+# ext is c for the source, or so for the binary.
+proc ::dlr::callStubsPath {libAlias  ext} {
+    return [file join $::dlr::bindingDir $libAlias auto ${libAlias}Stubs.$ext]
+}
+
+proc ::dlr::bundlePath {libAlias} {
+    return [file join $::dlr::bindingDir $libAlias auto $libAlias.bundle.tcl]
+}
+
+proc ::dlr::artifactHashesPath {libAlias} {
+    return [file join $::dlr::bindingDir $libAlias auto $libAlias.hashes]
+}
+
+# dlr internal command.  returns the hash of everything a lib's generated artifacts of the given
+# kind depend on, besides their own declarations.  kind is call (call wrappers), or struct
+# (struct layouts and converters).  computed once per lib.
+proc ::dlr::libInputsHash {libAlias  kind} {
+    set lQal ::dlr::lib::${libAlias}::
+    if {[exists ${lQal}${kind}InputsHash]} {
+        return [get ${lQal}${kind}InputsHash]
+    }
+    set inputs [list $::dlr::scriptHash]
+    if {$kind eq {struct}} {
+        # the lib's identity is its build-id, or else its modification time and size.
+        # that's the separate debug file's identity too, if there is one.
+        set files [list [get ${lQal}fileNamePath]]
+        if {[exists ${lQal}debugFile]} {
+            lappend files [get ${lQal}debugFile]
+        }
+        foreach fn $files {
+            if {[catch {native::buildId $fn} id] || $id eq {}} {
+                set id $fn
+                if {[file exists $fn]} {
+                    set id [list [file mtime $fn] [file size $fn]]
+                }
+            }
+            lappend inputs $id
+        }
+        # headers count by their expansion, so a change in any header they include is seen.
+        # layouts read from DWARF don't use the headers.
+        if {$::dlr::structLayoutSource eq {compile}} {
+            lappend inputs [expandIncludes $libAlias]
+        }
+        lappend inputs $::dlr::compiler $::dlr::structLayoutSource
+    }
+    return [set ${lQal}${kind}InputsHash [native::hash $inputs]]
+}
+
+# dlr internal command.  returns the lib's includes.h after substitution, preprocessed by
+# ::dlr::compiler, or an empty string if there is no includes.h.  in includes.h, $sQal is
+# empty here, since no particular struct type is being examined.
+proc ::dlr::expandIncludes {libAlias} {
+    set sQal {}
+    set cFn      [file join $::dlr::bindingDir $libAlias auto expandIncludes.c]
+    set binFn    [file join $::dlr::bindingDir $libAlias auto expandIncludes.i]
+    set headerFn [file join $::dlr::bindingDir $libAlias script includes.h]
+    if { ! [file readable $headerFn]} {
+        return {}
+    }
+    file mkdir [file dirname $cFn]
+
+    set hdr [open $headerFn r]
+    set includes [subst -nobackslashes [read $hdr]]
+    close $hdr
+    set src [open $cFn w]
+    puts $src $includes
+    close $src
+
+    # -E writes the preprocessor's output to binFn, instead of compiling.
+    set flags [list -E]
+    eval $::dlr::compiler
+    set f [open $binFn r]
+    set expanded [read $f]
+    close $f
+    return $expanded
+}
+
+# dlr internal command.  returns what a function's generated call wrapper depends on, besides
+# the lib-wide inputs:  its declaration, and the size of each struct type its parms and return
+# value use.  the wrapper has those sizes built in, and a rebuild of the lib can change them.
+proc ::dlr::callInputs {libAlias  fnName  declaration} {
+    set fQal ::dlr::lib::${libAlias}::${fnName}::
+    set sizes [list]
+    set qals [lmap p [get ${fQal}parmOrder] {expr {"${fQal}parm::${p}::"}}]
+    lappend qals ${fQal}return::
+    foreach q $qals {
+        if { ! [exists ${q}type]} continue
+        set type [get ${q}type]
+        if {[exists ${type}::categories] && {struct} in [get ${type}::categories]} {
+            lappend sizes $type [get ${type}::size]
+        }
+    }
+    return [list $declaration $sizes]
+}
+
+# dlr internal command.  returns true if autoMeta is in effect, and the inputs of the given
+# generated artifact changed since it was generated.  refreshMeta regenerates everything anyway,
+# and keepMeta assumes nothing changed.
+proc ::dlr::inputsChanged {libAlias  kind  name  declaration} {
+    if {[get ::dlr::lib::${libAlias}::metaAction] ne {autoMeta}} {
+        return 0
+    }
+    set hashes [get ::dlr::lib::${libAlias}::artifactHashes]
+    if { ! [dict exists $hashes $kind:$name]} {
+        return 1
+    }
+    return $( [dict get $hashes $kind:$name] ne [native::hash [list [libInputsHash $libAlias $kind] $declaration]] )
+}
+
+# dlr internal command.  records the hash of a generated artifact's inputs, just after generating it.
+proc ::dlr::recordInputs {libAlias  kind  name  declaration} {
+    dict set ::dlr::lib::${libAlias}::artifactHashes  $kind:$name  \
+        [native::hash [list [libInputsHash $libAlias $kind] $declaration]]
+    set ::dlr::lib::${libAlias}::artifactsChanged 1
+}
+
+# writes the lib's bundle.  that's one script holding a flat table of the metadata variables
+# of every function and struct type declared so far, along with the generated call wrapper
+# and struct converter scripts.  it leaves out variables whose values can't be kept across
+# runs, such as metaBlobs, and the native data of a call in progress.
+# with keepMeta, loadLib reads the bundle, and sets all those variables at once.  after that,
+# each declaration that exactly matches its bundled one skips parsing, validation, and its
+# own generated files.  only its native parts are prepared again, such as its metaBlob.
+# any other declaration is processed the usual way.
+proc ::dlr::writeBundle {libAlias} {
+    set lQal ::dlr::lib::${libAlias}::
+    set table [list]
+    set wrappers [dict create]
+    set converters [dict create]
+    foreach fnName [get ::dlr::bundle::${libAlias}::fns] {
+        lappend table {*}[bundleVars ${lQal}${fnName}::]
+        if {[file readable [callWrapperPath $libAlias $fnName]]} {
+            set f [open [callWrapperPath $libAlias $fnName] r]
+            dict set wrappers $fnName [read $f]
+            close $f
+        }
+    }
+    foreach structTypeName [get ::dlr::bundle::${libAlias}::structs] {
+        lappend table {*}[bundleVars ${lQal}struct::${structTypeName}::]
+        if {[file readable [structConverterPath $libAlias $structTypeName]]} {
+            set f [open [structConverterPath $libAlias $structTypeName] r]
+            dict set converters $structTypeName [read $f]
+            close $f
+        }
+    }
+
+    set f [open [bundlePath $libAlias] w]
+    puts $f "# metadata bundle for library '$libAlias', generated by dlr.  regenerated by refreshMeta."
+    puts $f [list set ::dlr::bundle::${libAlias}::table $table]
+    puts $f [list set ::dlr::bundle::${libAlias}::wrappers $wrappers]
+    puts $f [list set ::dlr::bundle::${libAlias}::converters $converters]
+    close $f
+}
+
+# dlr internal command.  returns a flat list of the globally qualified names and values of
+# the metadata variables under the given namespace qualifier, for the bundle.
+proc ::dlr::bundleVars {qal} {
+    set pairs [list]
+    foreach v [info vars ${qal}*] {
+        if {[namespace tail $v] ni {meta errorPolicy lazy targetNative ptrNative ptrPtrNative}} {
+            lappend pairs  ::[string trimleft $v :]  [get $v]
+        }
+    }
+    return $pairs
+}
+
+# dlr internal command.  reads the lib's bundle, and sets all the metadata variables it holds.
+proc ::dlr::loadBundle {libAlias} {
+    source [bundlePath $libAlias]
+    foreach {varName value} [get ::dlr::bundle::${libAlias}::table] {
+        set $varName $value
+    }
+    unset ::dlr::bundle::${libAlias}::table
+    set ::dlr::bundle::${libAlias}::loaded 1
+}
+
+# dlr internal command.  called when a declaration can't use the lib's bundle, so it's parsed again.
+# unsets any variables the bundle set under the given namespace qualifier, so none of them go stale,
+# and marks the bundle for rewriting at the end of loadLib.
+proc ::dlr::dropBundled {libAlias  qal} {
+    if { ! [exists ::dlr::bundle::${libAlias}::loaded]} {
+        return
+    }
+    set ::dlr::bundle::${libAlias}::dirty 1
+    foreach {varName value} [bundleVars $qal] {
+        unset $varName
+    }
+}
+
+# dlr internal command.  returns true if the lib's bundle was loaded, and it holds the given
+# declaration, unchanged since the bundle was written.
+proc ::dlr::bundled {libAlias  declarationVarName  declaration} {
+    if { ! [exists ::dlr::bundle::${libAlias}::loaded] || ! [exists $declarationVarName]} {
+        return 0
+    }
+    return $( [get $declarationVarName] eq $declaration )
+}
+
+# generate C call stubs for all the functions declared so far in the given lib,
+# and compile them into a Jim extension at [callStubsPath].  this does not load it.
+# each stub is a C command registered as the function's "call" command, in place of the call wrapper.
+# it calls the native function through its real prototype, from the lib's includes.h,
+# with typed locals instead of libffi.  only functions whose marshaling plan has no
+# script converters get a stub.  others keep using their planned call command or call wrapper.
+proc ::dlr::compileCallStubs {libAlias} {
+    set lQal ::dlr::lib::${libAlias}::
+    set cFn      [callStubsPath $libAlias c]
+    set binFn    [callStubsPath $libAlias so]
+    set headerFn [file join $::dlr::bindingDir $libAlias script includes.h]
+    file mkdir [file dirname $cFn]
+
+    # read header file of #include's.
+    set hdr [open $headerFn r]
+    set includes [subst -nobackslashes [read $hdr]]
+    close $hdr
+
+    # generate a stub for each eligible function.
+    set stubs {}
+    set inits {}
+    set stubbedFns [list]
+    foreach v [lsort [info vars ${lQal}*::parmOrder]] {
+        set fQal [namespace parent $v]::
+        set fnName [namespace tail [namespace parent $v]]
+        if { ! [exists ${fQal}scriptAction] || [get ${fQal}scriptAction] eq {noScript}} continue
+        # errors raised by callbacks are reported only by dlr's own call commands.
+        if {[hasCallbackParms $libAlias $fnName]} continue
+        # error policies are implemented only by dlr's own call commands too.
+        if {[get ${fQal}errorPolicy] ne {}} continue
+        set plan [compileCallPlan  $libAlias  $fnName]
+        if {$plan eq {} || {script} in [lmap {f p kind t m pk uk b} $plan {set kind}]} continue
+
+        append stubs [generateCallStub  $libAlias  $fnName  $plan]
+        append inits "
+            stubFn_$fnName = (__typeof__(stubFn_$fnName))stubFnAddr(itp, \"$fnName\");
+            if (stubFn_$fnName == NULL) return JIM_ERR;
+            Jim_CreateCommand(itp, \"${fQal}call\", stub_$fnName, NULL, NULL);
+            stubRtnType_$fnName = dlrApi->internPointerType(itp, \"[returnTargetType $libAlias $fnName]\");
+        "
+        lappend stubbedFns $fnName
+    }
+
+    set src [open $cFn w]
+    puts $src "
+        $includes
+
+        #include <stdint.h>
+        #include <stdlib.h>
+        #include <string.h>
+        #include <jim.h>
+
+        // dlrNative's pointer functions.  this must match stubApiT in dlrNative.h.
+        typedef struct {
+            int (*getPointer)(Jim_Interp* itp, Jim_Obj* v, void** pP);
+            Jim_Obj* (*newPointerObj)(Jim_Interp* itp, void* p, int typeID);
+            int (*internPointerType)(Jim_Interp* itp, const char* name);
+        } stubApiT;
+        static stubApiT* dlrApi;
+
+        static void* stubFnAddr(Jim_Interp* itp, const char* fnName) {
+            Jim_Obj* cmd\[\] = {
+                Jim_NewStringObj(itp, \"::dlr::fnAddr\", -1),
+                Jim_NewStringObj(itp, fnName, -1),
+                Jim_NewStringObj(itp, \"$libAlias\", -1) };
+            jim_wide addr = 0;
+            if (Jim_EvalObjVector(itp, 3, cmd) != JIM_OK) return NULL;
+            if (Jim_GetWide(itp, Jim_GetResult(itp), &addr) != JIM_OK) return NULL;
+            return (void*)(intptr_t)addr;
+        }
+
+        $stubs
+
+        int Jim_${libAlias}StubsInit(Jim_Interp* itp) {
+            if (Jim_PackageProvide(itp, \"${libAlias}Stubs\", \"1.0\", JIM_ERRMSG) != JIM_OK) return JIM_ERR;
+            dlrApi = (stubApiT*)Jim_GetAssocData(itp, \"dlrStubApi\");
+            if (dlrApi == NULL) {
+                Jim_SetResultString(itp, \"dlrNative isn't loaded in this interpreter.\", -1);
+                return JIM_ERR;
+            }
+            $inits
+            return Jim_EvalGlobal(itp, \"set ${lQal}stubbedFns {$stubbedFns}\");
+        }
+    "
+    close $src
+
+    # compile C code.
+    set flags [list  -O2  -fPIC  -shared  {*}[lmap d $::dlr::jimIncludeDirs {expr {"-I$d"}}]]
+    eval $::dlr::compiler
+    return $stubbedFns
+}
+
+# dlr internal command.  returns the C source code of one call stub, from the function's marshaling plan.
+proc ::dlr::generateCallStub {libAlias  fnName  plan} {
+    set fQal ::dlr::lib::${libAlias}::${fnName}::
+    set nullFlag $::dlr::nullPtrFlag
+    set decls {}
+    set packs {}
+    set args [list]
+    set unpacks {}
+    set frees {}
+    set usage [list]
+
+    set n 0
+    foreach parmBare [get ${fQal}parmOrder] {
+        incr n
+        lassign [lrange $plan $(($n - 1) * 8) end]  flags  passMethod  kind  typeCode  memAction
+        set out $( $flags & [dict get $::dlr::dlrFlags dir_out] )
+        lappend usage $( $out ? "&$parmBare" : $parmBare )
+
+        # "out" and "inOut" parms are given as the name of a variable in the caller's frame.
+        set src objv\[$n\]
+        if {$out} {
+            set src v$n
+            append decls "Jim_Obj* v$n = NULL; "
+            append packs "v$n = Jim_GetVariable(itp, objv\[$n\], JIM_ERRMSG); if (v$n == NULL) goto done;\n"
+        }
+
+        if {$kind eq {scalar}} {
+            set cType [dict get $::dlr::stubCTypes $typeCode]
+            append decls "$cType t$n = 0; "
+            if {$passMethod eq {byVal}} {
+                append packs "[stubScalarIn $typeCode $src t$n]\n"
+                lappend args t$n
+                continue
+            }
+            append decls "void* a$n = NULL; "
+            append packs "if (Jim_Length($src) > 0) { [stubScalarIn $typeCode $src t$n] a$n = &t$n; }\n"
+            lappend args a$n
+            if {$out} {
+                append unpacks "if (a$n != NULL && Jim_SetVariable(itp, objv\[$n\], [stubScalarOut $typeCode t$n]) != JIM_OK) goto done;\n"
+            }
+        } elseif {$passMethod eq {byPtrPtr}} {
+            # ascii given out by the native function.
+            append decls "char* a$n = NULL; "
+            lappend args (void*)&a$n
+            append unpacks "if (Jim_SetVariable(itp, objv\[$n\], [stubAsciiOut a$n $nullFlag]) != JIM_OK) goto done;\n"
+            if {$memAction eq {free}} {
+                append frees "if (a$n != NULL) free(a$n);\n"
+            }
+        } elseif {$kind eq {bytes}} {
+            # blob borrowed from the script value.
+            append decls "void* a$n = NULL; "
+            append packs "if (Jim_Length($src) > 0) a$n = (void*)Jim_String($src);\n"
+            lappend args a$n
+        } elseif {$memAction eq {borrow}} {
+            # ascii borrowed from the script value.
+            append decls "const char* a$n = NULL; "
+            append packs "if ( ! Jim_CompareStringImmediate(itp, $src, \"$nullFlag\")) a$n = Jim_String($src);\n"
+            lappend args a$n
+        } else {
+            # ascii copied in, and maybe back out.
+            append decls "char* a$n = NULL; "
+            append packs "if ( ! Jim_CompareStringImmediate(itp, $src, \"$nullFlag\")) a$n = Jim_StrDup(Jim_String($src));\n"
+            lappend args a$n
+            if {$out} {
+                append unpacks "if (Jim_SetVariable(itp, objv\[$n\], [stubAsciiOut a$n $nullFlag]) != JIM_OK) goto done;\n"
+            }
+            append frees "if (a$n != NULL) Jim_Free(a$n);\n"
+        }
+    }
+
+    # call, and unpack return value.
+    lassign [lrange $plan $($n * 8) end]  flags  passMethod  kind  typeCode  memAction
+    set call "stubFn_$fnName\([join $args {, }]\)"
+    if {$kind eq {void}} {
+        set callCode "$call;\n"
+        set rtnCode "Jim_SetEmptyResult(itp);\n"
+    } elseif {$kind eq {scalar}} {
+        set cType [dict get $::dlr::stubCTypes $typeCode]
+        set callCode "$cType r = ($cType)$call;\n"
+        set rtnCode "Jim_SetResult(itp, [stubScalarOut $typeCode r stubRtnType_$fnName]);\n"
+    } else {
+        set callCode "char* r = (char*)$call;\n"
+        set rtnCode "Jim_SetResult(itp, [stubAsciiOut r $nullFlag]);\n"
+        if {$memAction eq {free}} {
+            append rtnCode "if (r != NULL) free(r);\n"
+        }
+    }
+
+    return "
+        // ${fQal}call
+        static __typeof__(&$fnName) stubFn_$fnName;
+        static int stubRtnType_$fnName; // interned target type of the returned pointer, or 0.
+
+        static int stub_$fnName\(Jim_Interp* itp, int objc, Jim_Obj * const objv\[\]) {
+            if (objc != [incr n]) {
+                Jim_WrongNumArgs(itp, 1, objv, \"$usage\");
+                return JIM_ERR;
+            }
+            int status = JIM_ERR;
+            $decls
+            $packs
+            $callCode
+            $unpacks
+            $rtnCode
+            status = JIM_OK;
+        done:
+            $frees
+            return status;
+        }
+    "
+}
+
+# dlr internal command.  returns a C statement converting a script value to a scalar.
+# pointers are fetched by dlrNative, so pointer objects and the null pointer flag are accepted.
+proc ::dlr::stubScalarIn {typeCode  srcObj  dest} {
+    set cType [dict get $::dlr::stubCTypes $typeCode]
+    if {$typeCode in {2 3 4}} {
+        return "{ double d; if (Jim_GetDouble(itp, $srcObj, &d) != JIM_OK) goto done; $dest = ($cType)d; }"
+    }
+    if {$typeCode == 14} {
+        return "if (dlrApi->getPointer(itp, $srcObj, &$dest) != JIM_OK) goto done;"
+    }
+    return "{ jim_wide w; if (Jim_GetWide(itp, $srcObj, &w) != JIM_OK) goto done; $dest = ($cType)w; }"
+}
+
+# dlr internal command.  returns a C expression converting a scalar to a new script value.
+# a pointer becomes a pointer object, tagged with the target type ID in the C expression ptrType.
+proc ::dlr::stubScalarOut {typeCode  src  {ptrType 0}} {
+    if {$typeCode in {2 3 4}} {
+        return "Jim_NewDoubleObj(itp, (double)$src)"
+    }
+    if {$typeCode == 14} {
+        return "dlrApi->newPointerObj(itp, (void*)$src, $ptrType)"
+    }
+    return "Jim_NewIntObj(itp, (jim_wide)$src)"
+}
+
+# dlr internal command.  returns a C expression converting an ascii pointer to a new script value.
+proc ::dlr::stubAsciiOut {src  nullFlag} {
+    return "($src == NULL  ?  Jim_NewStringObj(itp, \"$nullFlag\", -1)  :  Jim_NewStringObj(itp, $src, -1))"
+}
+
+# does unpack-byVal directly from the struct at the given pointer.  that's through a native
+# buffer viewing it, so the struct isn't copied first.
 # useful when a native function returns a pointer to a struct as the function return value,
 # or it takes a parm that is pointer-to-pointer-to-struct, and sets the pointer e.g. by malloc'ing a struct.
 # this command helps to simplify memory management wrappers for those, in library binding scripts.
 # parameters are in this order for easy aliasing.
 proc ::dlr::struct::unpack-scriptPtr {scriptForm  structTypeName  pointerIntValue} {
-    ::dlr::copyToBufferVar  native  [::dlr::get ${structTypeName}::size]  $pointerIntValue
+    set native [::dlr::wrapBuffer  $pointerIntValue  [::dlr::get ${structTypeName}::size]]
     return [${structTypeName}::unpack-byVal-$scriptForm  $native]
 }
 
 # equivalent to unpack-scriptPtr followed by freeHeap.
 proc ::dlr::struct::unpack-scriptPtr-free {scriptForm  structTypeName  pointerIntValue} {
-    ::dlr::copyToBufferVar  native  [::dlr::get ${structTypeName}::size]  $pointerIntValue
+    set native [::dlr::wrapBuffer  $pointerIntValue  [::dlr::get ${structTypeName}::size]]
     set unpackedData [${structTypeName}::unpack-byVal-$scriptForm  $native]
     ::dlr::freeHeap $pointerIntValue
     return $unpackedData
 }
 
+# unpacks count structs from a native array at pointerIntValue, all in one C command.
+# that's much faster than unpacking each struct from script.
+# scriptForm asList or asDict gives a list with one element per struct, the same as the
+# struct's own unpackers give.  scriptForm asColumns instead gives one dict of per-member
+# lists, in member order.  stride is the distance between structs in bytes.
+# by default that's the struct's size, for an ordinary C array.
+# parameters are in this order for easy aliasing, like unpack-scriptPtr.
+proc ::dlr::struct::unpackArray {scriptForm  structTypeName  pointerIntValue  count  {stride {}}} {
+    if {$stride eq {}} {
+        set stride [::dlr::get ${structTypeName}::size]
+    }
+    return [::dlr::native::unpackStructArray  $pointerIntValue  $count  $stride  \
+        [::dlr::get ${structTypeName}::memberTable]  $scriptForm]
+}
+
+# pack cursors build a record field by field, in one growable buffer.  usage:
+#   set cur [::dlr::packer new]
+#   $cur put ::dlr::simple::int::pack-byVal-asInt 7
+#   $cur align 8
+#   $cur put ::dlr::simple::double::pack-byVal-asDouble 2.5
+#   set record [$cur bytes]    ;# or [$cur heap] for a heap pointer; release that with freeHeap.
+#   rename $cur {}
+# put accepts any packer, and returns the position where it packed the field.  the buffer
+# grows by doubling, so building a long record costs O(n).  finalizing hands off the
+# buffer without copying it, and leaves the cursor empty for reuse.
+# see packCursorCmd in dlrNative for the other subcommands.
+proc ::dlr::packer {subcommand} {
+    if {$subcommand ne {new}} {
+        error "Unknown packer subcommand: $subcommand"
+    }
+    set id [incr ::dlr::packer::nextId]
+    return [::dlr::native::createPackCursor  ::dlr::packer::cursor$id  ::dlr::packer::scratch$id]
+}
+
+# creates a block pool, for fast reuse of same-sized native memory blocks, and returns its command name.
+#   ::dlr::pool create size ?count?
+# size is a byte count, or the fully qualified name of a declared struct type, such as
+# ::dlr::lib::testLib::struct::quadT.  for a struct type, the pool's blocks fit that struct,
+# and the pointers it hands out are tagged with that type.  count blocks are allocated at a time.
+# the pool command's subcommands are alloc, free pointer, blockSize, and stats.
+# delete the pool by renaming its command to {}.  that frees all its blocks.
+proc ::dlr::pool {subcommand  size  {count 16}} {
+    if {$subcommand ne {create}} {
+        error "Unknown pool subcommand: $subcommand"
+    }
+    set typeArgs [list]
+    if { ! [string is integer -strict $size]} {
+        if { ! [exists ${size}::size]} {
+            error "Pool size must be an integer or a declared struct type: $size"
+        }
+        set typeArgs [list $size]
+        set size [get ${size}::size]
+    }
+    set id [incr ::dlr::pool::nextId]
+    return [::dlr::native::createBlockPool  ::dlr::pool::pool$id  $size  $count  {*}$typeArgs]
+}
+
 # equivalent to ascii::unpack-scriptPtr-asString followed by freeHeap.
 proc ::dlr::simple::ascii::unpack-scriptPtr-asString-free {pointerIntValue} {
     set unpackedData [::dlr::simple::ascii::unpack-scriptPtr-asString $pointerIntValue]
@@ -24,11 +24,18 @@ along with dlr.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #include <unistd.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <dlfcn.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <elf.h>
+#include <sys/mman.h>
 
 #include <jim.h>
+#include <jim-eventloop.h>
 
 #include "dlrNative.h"
 
@@ -82,28 +89,214 @@ typedef enum {
     DF_ARRAY = (1 << 3)
 } dlrFlagsT;
 
+// the ways a native function's return value can be passed back to script by callToNative.
+typedef enum {
+    RC_NATIVE = 0,  // packed native buffer, for a script converter to unpack.  used for structs.
+    RC_SIGNED,      // script integer, unpacked in C.
+    RC_UNSIGNED,    // script integer, unpacked in C.  also used for pointers.
+    RC_FLOAT,       // script double, unpacked in C.
+} returnClassT;
+
+// space for any scalar value.  when used for a return value, this includes libffi's
+// required padding up to sizeof(ffi_arg).
+typedef union {
+    ffi_arg arg;
+    float f;
+    double d;
+    long double ld;
+    void* p;
+} scalarT;
+
+// a trampoline calls a native function directly, bypassing libffi's general-purpose argument
+// classification.  prepMetaBlob selects one for any signature whose arguments are all
+// integers, pointers, or doubles, and whose return value is one of those, or void.
+// each trampoline suits one count of integer-class and double arguments, and one return class.
+// that relies on the ABI assigning integer and floating point arguments to separate register
+// files, each in order, regardless of how the two classes interleave in the parm list.
+// it's true of the amd64 System V ABI and the AArch64 procedure call standard, so far as
+// all the arguments fit in registers.  on other machines, libffi serves all calls.
+typedef void (*trampolineT)(ffiFnP fn, const u64* ints, const double* doubles, scalarT* rtn);
+
+#if (defined(__x86_64__) && ! defined(_WIN64)) || defined(__aarch64__)
+    #define DLR_TRAMPOLINES
+
+    #define TRAMP_MAX_INTS      6
+    #define TRAMP_MAX_DOUBLES   2
+
+    // one row per combination:  int count, double count, parm types, argument expressions.
+    #define TRAMPOLINE_TABLE(X) \
+        X(0, 0, (void),                                     ()) \
+        X(1, 0, (u64),                                      (i[0])) \
+        X(2, 0, (u64, u64),                                 (i[0], i[1])) \
+        X(3, 0, (u64, u64, u64),                            (i[0], i[1], i[2])) \
+        X(4, 0, (u64, u64, u64, u64),                       (i[0], i[1], i[2], i[3])) \
+        X(5, 0, (u64, u64, u64, u64, u64),                  (i[0], i[1], i[2], i[3], i[4])) \
+        X(6, 0, (u64, u64, u64, u64, u64, u64),             (i[0], i[1], i[2], i[3], i[4], i[5])) \
+        X(0, 1, (double),                                   (d[0])) \
+        X(1, 1, (u64, double),                              (i[0], d[0])) \
+        X(2, 1, (u64, u64, double),                         (i[0], i[1], d[0])) \
+        X(3, 1, (u64, u64, u64, double),                    (i[0], i[1], i[2], d[0])) \
+        X(4, 1, (u64, u64, u64, u64, double),               (i[0], i[1], i[2], i[3], d[0])) \
+        X(5, 1, (u64, u64, u64, u64, u64, double),          (i[0], i[1], i[2], i[3], i[4], d[0])) \
+        X(6, 1, (u64, u64, u64, u64, u64, u64, double),     (i[0], i[1], i[2], i[3], i[4], i[5], d[0])) \
+        X(0, 2, (double, double),                           (d[0], d[1])) \
+        X(1, 2, (u64, double, double),                      (i[0], d[0], d[1])) \
+        X(2, 2, (u64, u64, double, double),                 (i[0], i[1], d[0], d[1])) \
+        X(3, 2, (u64, u64, u64, double, double),            (i[0], i[1], i[2], d[0], d[1])) \
+        X(4, 2, (u64, u64, u64, u64, double, double),       (i[0], i[1], i[2], i[3], d[0], d[1])) \
+        X(5, 2, (u64, u64, u64, u64, u64, double, double),  (i[0], i[1], i[2], i[3], i[4], d[0], d[1])) \
+        X(6, 2, (u64, u64, u64, u64, u64, u64, double, double), (i[0], i[1], i[2], i[3], i[4], i[5], d[0], d[1]))
+
+    // each combination has one trampoline returning an integer class (or void), and one returning double.
+    #define TRAMPOLINE_DEFINE(ni, nd, parms, args) \
+        static void trampInt_##ni##_##nd(ffiFnP fn, const u64* i, const double* d, scalarT* rtn) { \
+            (void)i; (void)d; \
+            rtn->arg = (ffi_arg)((u64 (*)parms)fn)args; \
+        } \
+        static void trampDouble_##ni##_##nd(ffiFnP fn, const u64* i, const double* d, scalarT* rtn) { \
+            (void)i; (void)d; \
+            rtn->d = ((double (*)parms)fn)args; \
+        }
+    TRAMPOLINE_TABLE(TRAMPOLINE_DEFINE)
+
+    #define TRAMPOLINE_ENTRY(ni, nd, parms, args) \
+        [nd][ni] = {trampInt_##ni##_##nd, trampDouble_##ni##_##nd},
+    static const trampolineT trampolines[TRAMP_MAX_DOUBLES + 1][TRAMP_MAX_INTS + 1][2] = {
+        TRAMPOLINE_TABLE(TRAMPOLINE_ENTRY)
+    };
+#endif
+
+// a marshaling plan lets one C command do all the work of a generated call wrapper:
+// convert the script's argument values, pack any pointers to them, call the native function,
+// and unpack "out" parms and the return value back to script.
+// dlr script package compiles the plan, and passes it to prepMetaBlob as a flat list of
+// PLAN_STRIDE elements per step:  one step per native parm, plus one for the return value.
+// prepMetaBlob stores the steps in binary form at the end of the metaBlob.
+// data the plan can't convert in C (such as structs) is converted by calling the
+// same script converters the generated call wrapper would call.  their names stay in the list.
+enum {
+    PL_dirIX = 0,
+    PL_passMethodIX,
+    PL_kindIX,
+    PL_typeCodeIX,
+    PL_memActionIX,
+    PL_packerIX,
+    PL_unpackerIX,
+    PL_bufVarNameIX,
+    PLAN_STRIDE
+};
+
+typedef enum {
+    PM_BYVAL = 0,
+    PM_BYPTR,
+    PM_BYPTRPTR
+} passMethodT;
+static const char * const passMethodNames[] = {"byVal", "byPtr", "byPtrPtr", NULL};
+
+typedef enum {
+    PK_VOID = 0,    // return value only.
+    PK_SCALAR,      // integer, float, or pointer, asInt or asDouble.
+    PK_ASCII,       // ascii asString.
+    PK_SCRIPT,      // converted by script converters.
+    PK_BYTES        // asNative blob, borrowed.  "in" byPtr only.
+} planKindT;
+static const char * const planKindNames[] = {"void", "scalar", "ascii", "script", "bytes", NULL};
+
+typedef struct {
+    u8 dir; // dlrFlagsT direction bits.  zero for the return value.
+    u8 passMethod;
+    u8 kind;
+    u8 typeCode; // FFI_TYPE_* of the target data, for PK_SCALAR.
+    u8 memFree; // free the native memory block after unpacking it.
+    u8 borrow; // pass a pointer to the script value's own bytes, instead of to a copy.
+} planStepT;
+
+// an error policy checks a function's return value in C, right after the call, and raises
+// a script error when it indicates failure.  that saves a script comparison after every
+// call, and often a second native call to fetch errno or the lib's error message.
+// dlr script package passes it to prepMetaBlob as a list of EP_COUNT elements.
+typedef enum {
+    EC_NONE = 0,
+    EC_NEGATIVE,    // failed if the integer return value is negative.
+    EC_NONZERO,     // failed if the integer return value isn't zero.
+    EC_ZERO,        // failed if the integer return value is zero.
+    EC_NULL         // failed if the pointer return value is null.
+} errorConditionT;
+static const char * const errorConditionNames[] = {"none", "negative", "nonzero", "zero", "null", NULL};
+
+typedef enum {
+    EM_ERRNO = 0,   // the message for errno, captured immediately after the call.
+    EM_CODE,        // the return value itself.
+    EM_MSGFN,       // the message returned by the lib's function taking no args, such as dlerror().
+    EM_CODEMSGFN    // the message returned by the lib's function taking the return value as an int, such as sqlite3_errstr().
+} errorMessageT;
+static const char * const errorMessageNames[] = {"errno", "code", "msgFn", "codeMsgFn", NULL};
+
+enum {
+    EP_conditionIX = 0,
+    EP_messageIX,
+    EP_fnPIX,       // pointer to the lib's error message function, or 0.
+    EP_labelIX,     // the native function's name, for error messages.
+    EP_COUNT
+};
+
 typedef struct {
     // this signature serves 2 purposes:
     // it allows C code to verify the metablob is intact, meaning the script hasn't stepped on it.
     // and it provides a sane appearance if script prints the metablob.
     char signature[5];
-    ffi_cif cif;
+    ffi_cif* cif; // the shared signature's CIF, or the private one beyond this structure.
     #ifdef BUILD_GIZMO
         GIFunctionInfo* giInfo;
         int nInArgs;
         int nOutArgs;
-        dlrFlagsT* aFlags; // points directly beyond the atypes array.
+        dlrFlagsT* aFlags; // points directly beyond the private signature, if any.
     #endif
     ffiFnP fn;
     size_t returnSizePadded;
+    returnClassT returnClass;
+    size_t returnPadding; // offset of the value within its ffi_arg-sized return space.
+    u8 returnIsPtr; // return value is unpacked to a pointer object.
+    int returnPtrType; // interned target type of that pointer, or 0 if it's unknown.
     Jim_Obj* nativeParmsList;
-    ffi_type* atypes; // placeholder for first element of the array of type pointers located directly at the end of the structure.
+    Jim_Obj* planList; // flat list from script, or NULL if there is no marshaling plan.
+    planStepT* plan; // points directly beyond the aFlags array, or NULL if there is no marshaling plan.
+    trampolineT trampoline; // or NULL to call through libffi.
+    u8 errorCondition; // errorConditionT.
+    u8 errorMessage; // errorMessageT.
+    void* errorFn; // the lib's error message function, for EM_MSGFN and EM_CODEMSGFN.
+    Jim_Obj* errorPolicyList; // list from script, or NULL if there is no error policy.
 } metaBlobT;
 static const char METABLOB_SIGNATURE[] = "meta";
 
+// a struct's member table, from script, has MT_STRIDE elements per member.
+enum {
+    MT_nameIX = 0,
+    MT_typeCodeIX,
+    MT_offsetIX,
+    MT_STRIDE
+};
+
+typedef struct {
+    u32 offset;
+    u8 typeCode;
+} structMemberT;
+
+// the struct codec's data lies at the end of a struct's type blob, when prepStructType is
+// given a member table.  the interpreter's codec tables hold a reference to the member table,
+// until the type blob is rebuilt, or the interpreter is deleted.
+typedef struct {
+    char signature[5];
+    int nMembers;
+    int size; // the struct's detected size in bytes.
+    Jim_Obj* memberTable; // for the member names.
+    structMemberT members[];
+} structCodecT;
+static const char CODEC_SIGNATURE[] = "strc";
+
 #define  DLR_NULL_PTR_FLAG  "_#_nullPtrFlag_#_"
 #define  DLR_NULL_PTR_FLAG_STRLEN  (17)
-#define  setResultNullPtrFlag(itp)  Jim_SetResultString(itp, DLR_NULL_PTR_FLAG, DLR_NULL_PTR_FLAG_STRLEN);
+#define  setResultNullPtrFlag(itp)  Jim_SetResult(itp, newNullPtrFlagObj(itp));
 
 /* **********************  EXECUTABLE CODE BELOW  ***************************** */
 
@@ -165,7 +358,7 @@ int fnAddr(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
         Jim_SetResultFormatted(itp, "No %s symbol found in library.", fnName);
         return JIM_ERR;
     }
-    Jim_SetResultInt(itp, (jim_wide)fn);
+    Jim_SetResult(itp, newPointerObj(itp, (void*)fn, 0));
     return JIM_OK;
 }
 
@@ -202,480 +395,4003 @@ int sizeOfTypes(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
     return JIM_OK;
 }
 
-/*
-addrOf() returns (to the script) an integer which is the memory address of the
-content bytes of the given variable name.  this always refers to the
-string representation, and none of Jim's internal representations.
-if the variable object's string representation is outdated due to
-previous script actions, then this command automatically updates it
-from the object's internal reps before extracting the address.
-(that's normal behavior for any Tcl command that requires a string.)
-thus addrOf() always returns a pointer to a string buffer.
-in C, that is a "char*".  the buffer contains a string of ASCII or
-UTF8, or if it was prepared by packing, it contains a binary blob.
-note: if the string rep is already up to date, then it won't be touched,
-and will yield the same address as the last call to addrOf().  that's
-the case if the script hasn't assigned to that variable at all since
-the last call to addrOf().
-*/
-int addrOf(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
-    enum {
-        cmdIX = 0,
-        varNameIX,
-        argCount
-    };
+// struct layouts can also be read from a library's DWARF debug info, instead of compiling
+// a C program against its headers.  that serves hosts with no compiler or no headers, such
+// as a deployed embedded system.  the lib must be built with -g, or come with a separate
+// debug file (as from objcopy --only-keep-debug).  this reads uncompressed DWARF 2 through 5,
+// from an ELF file of the host's own class and byte order.  it records only the few kinds of
+// entries needed to find a struct's members and measure their types.
+#if UINTPTR_MAX == UINT64_MAX
+    #define DWARF_ELF_CLASS ELFCLASS64
+    typedef Elf64_Ehdr dwarfEhdrT;
+    typedef Elf64_Shdr dwarfShdrT;
+#else
+    #define DWARF_ELF_CLASS ELFCLASS32
+    typedef Elf32_Ehdr dwarfEhdrT;
+    typedef Elf32_Shdr dwarfShdrT;
+#endif
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    #define DWARF_ELF_DATA ELFDATA2LSB
+#else
+    #define DWARF_ELF_DATA ELFDATA2MSB
+#endif
 
-    if (objc != argCount) {
-        Jim_SetResultString(itp, "Wrong # args.", -1);
-        return JIM_ERR;
+// the few DWARF codes needed here, from the DWARF 5 standard.
+enum {
+    DW_TAG_array_type = 0x01, DW_TAG_enumeration_type = 0x04, DW_TAG_member = 0x0d,
+    DW_TAG_pointer_type = 0x0f, DW_TAG_compile_unit = 0x11, DW_TAG_structure_type = 0x13,
+    DW_TAG_typedef = 0x16, DW_TAG_union_type = 0x17, DW_TAG_subrange_type = 0x21,
+    DW_TAG_base_type = 0x24, DW_TAG_const_type = 0x26, DW_TAG_volatile_type = 0x35,
+    DW_TAG_restrict_type = 0x37, DW_TAG_atomic_type = 0x47,
+
+    DW_AT_name = 0x03, DW_AT_byte_size = 0x0b, DW_AT_upper_bound = 0x2f, DW_AT_count = 0x37,
+    DW_AT_data_member_location = 0x38, DW_AT_declaration = 0x3c, DW_AT_type = 0x49,
+    DW_AT_str_offsets_base = 0x72,
+
+    DW_FORM_addr = 0x01, DW_FORM_block2 = 0x03, DW_FORM_block4 = 0x04, DW_FORM_data2 = 0x05,
+    DW_FORM_data4 = 0x06, DW_FORM_data8 = 0x07, DW_FORM_string = 0x08, DW_FORM_block = 0x09,
+    DW_FORM_block1 = 0x0a, DW_FORM_data1 = 0x0b, DW_FORM_flag = 0x0c, DW_FORM_sdata = 0x0d,
+    DW_FORM_strp = 0x0e, DW_FORM_udata = 0x0f, DW_FORM_ref_addr = 0x10, DW_FORM_ref1 = 0x11,
+    DW_FORM_ref2 = 0x12, DW_FORM_ref4 = 0x13, DW_FORM_ref8 = 0x14, DW_FORM_ref_udata = 0x15,
+    DW_FORM_indirect = 0x16, DW_FORM_sec_offset = 0x17, DW_FORM_exprloc = 0x18,
+    DW_FORM_flag_present = 0x19, DW_FORM_strx = 0x1a, DW_FORM_addrx = 0x1b,
+    DW_FORM_ref_sup4 = 0x1c, DW_FORM_strp_sup = 0x1d, DW_FORM_data16 = 0x1e,
+    DW_FORM_line_strp = 0x1f, DW_FORM_ref_sig8 = 0x20, DW_FORM_implicit_const = 0x21,
+    DW_FORM_loclistx = 0x22, DW_FORM_rnglistx = 0x23, DW_FORM_ref_sup8 = 0x24,
+    DW_FORM_strx1 = 0x25, DW_FORM_strx2 = 0x26, DW_FORM_strx3 = 0x27, DW_FORM_strx4 = 0x28,
+    DW_FORM_addrx1 = 0x29, DW_FORM_addrx2 = 0x2a, DW_FORM_addrx3 = 0x2b, DW_FORM_addrx4 = 0x2c,
+    DW_FORM_GNU_addr_index = 0x1f01, DW_FORM_GNU_str_index = 0x1f02,
+    DW_FORM_GNU_ref_alt = 0x1f20, DW_FORM_GNU_strp_alt = 0x1f21,
+
+    DW_OP_plus_uconst = 0x23,
+};
+
+typedef struct {
+    const u8* p;
+    size_t len;
+} dwarfSectionT;
+
+typedef struct {
+    dwarfSectionT info, abbrev, str, lineStr, strOffsets;
+} dwarfFileT;
+
+// a read position within a section.  bad is set on any attempt to read past end.
+typedef struct {
+    const u8* p;
+    const u8* end;
+    int bad;
+} dwarfCursorT;
+
+typedef struct {
+    u64 off;            // start of this unit in .debug_info.
+    int version;
+    int offsetSize;     // 4 for 32-bit DWARF, 8 for 64-bit DWARF.
+    int addrSize;
+    u64 strOffsetsBase;
+} dwarfUnitT;
+
+typedef struct {
+    u32 name;
+    u32 form;
+    i64 implicitConst;
+} dwarfAttrSpecT;
+
+typedef struct {
+    u64 code;
+    u32 tag;
+    u8 hasChildren;
+    int firstAttr;      // index into the table's attrs.
+    int nAttrs;
+} dwarfAbbrevT;
+
+typedef struct {
+    dwarfAbbrevT* abbrevs;
+    int nAbbrevs, capAbbrevs;
+    dwarfAttrSpecT* attrs;
+    int nAttrs, capAttrs;
+} dwarfAbbrevTableT;
+
+// one attribute value.  num holds a constant, or an offset in .debug_info for a reference.
+typedef struct {
+    u64 num;
+    const char* str;
+    const u8* block;
+    u64 blockLen;
+    u8 isRef;
+} dwarfValueT;
+
+// one recorded debug info entry.
+typedef struct {
+    u64 off;            // offset in .debug_info.
+    u64 typeOff;        // target of DW_AT_type, or 0.
+    const char* name;   // or NULL.
+    i64 byteSize;       // or -1.
+    i64 memberOffset;   // for members; or -1.
+    i64 count;          // element count, for subranges; or -1.
+    int parent;         // index of the enclosing recorded entry, or -1.
+    int end;            // index after the last recorded descendant.
+    u16 tag;
+    u8 declaration;
+    u8 addrSize;
+} dwarfDieT;
+
+typedef struct {
+    dwarfDieT* dies;
+    int nDies, capDies;
+} dwarfDieListT;
+
+u64 dwarfFixed(dwarfCursorT* c, int n) {
+    if (c->bad || c->end - c->p < n) {
+        c->bad = 1;
+        c->p = c->end;
+        return 0;
     }
+    u64 v = 0;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for (int i = n - 1; i >= 0; i--) v = (v << 8) | c->p[i];
+#else
+    for (int i = 0; i < n; i++) v = (v << 8) | c->p[i];
+#endif
+    c->p += n;
+    return v;
+}
 
-    Jim_Obj* v = Jim_GetVariable(itp, objv[varNameIX], JIM_NONE);
-    if (v == NULL) {
-        Jim_SetResultString(itp, "Variable not found.", -1);
-        return JIM_ERR;
+u64 dwarfUleb(dwarfCursorT* c) {
+    u64 v = 0;
+    int shift = 0;
+    while (c->p < c->end) {
+        u8 b = *c->p++;
+        if (shift < 64) v |= (u64)(b & 0x7f) << shift;
+        shift += 7;
+        if ((b & 0x80) == 0) return v;
     }
-    Jim_SetResultInt(itp, (jim_wide)Jim_GetString(v, NULL));
-    return JIM_OK;
+    c->bad = 1;
+    return v;
 }
 
-// provides direct use of the system heap through Jim_Alloc(), for scripts.
-// size is expected to be a script integer, not binary packed.
-// heap pointer is returned as a script integer, not binary packed.
-// throws a script error if the alloc fails.
-// this command creates easy opportunities for memory leaks and other bugs,
-// and blatant tests of such leaks have somehow eluded valgrind!
-// therefore createBufferVar is recommended instead.  that way the interpreter
-// tracks the memory block and can collect it automatically.
-// Jim's pack command works easily with that.
-// Jim references should work well with that too.
-int allocHeap(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
-    enum {
-        cmdIX = 0,
-        sizeIX,
-        argCount
-    };
+i64 dwarfSleb(dwarfCursorT* c) {
+    u64 v = 0;
+    int shift = 0;
+    while (c->p < c->end) {
+        u8 b = *c->p++;
+        if (shift < 64) v |= (u64)(b & 0x7f) << shift;
+        shift += 7;
+        if ((b & 0x80) == 0) {
+            if (shift < 64 && (b & 0x40)) v |= ~(u64)0 << shift;
+            return (i64)v;
+        }
+    }
+    c->bad = 1;
+    return (i64)v;
+}
 
-    if (objc != argCount) {
-        Jim_SetResultString(itp, "Wrong # args.", -1);
-        return JIM_ERR;
+void dwarfSkip(dwarfCursorT* c, u64 n) {
+    if (c->bad || (u64)(c->end - c->p) < n) {
+        c->bad = 1;
+        c->p = c->end;
+        return;
     }
+    c->p += n;
+}
 
-    jim_wide size;
-    if (Jim_GetWide(itp, objv[sizeIX], &size) != JIM_OK) {
-        Jim_SetResultString(itp, "Expected size integer but got other data.", -1);
+// returns the NUL-terminated string at offset in the section, or NULL if it's out of bounds.
+const char* dwarfString(dwarfSectionT* sec, u64 offset) {
+    if (sec->p == NULL || offset >= sec->len) return NULL;
+    const char* s = (const char*)sec->p + offset;
+    return memchr(s, 0, sec->len - offset) == NULL  ?  NULL  :  s;
+}
+
+// returns the string at index in the unit's contribution to .debug_str_offsets, or NULL.
+const char* dwarfIndexedString(dwarfFileT* f, dwarfUnitT* u, u64 index) {
+    u64 at = u->strOffsetsBase + index * u->offsetSize;
+    if (f->strOffsets.p == NULL || at + u->offsetSize > f->strOffsets.len) return NULL;
+    dwarfCursorT c = {f->strOffsets.p + at, f->strOffsets.p + f->strOffsets.len, 0};
+    return dwarfString(&f->str, dwarfFixed(&c, u->offsetSize));
+}
+
+void dwarfFreeAbbrevs(dwarfAbbrevTableT* t) {
+    Jim_Free(t->abbrevs);
+    Jim_Free(t->attrs);
+    memset(t, 0, sizeof(dwarfAbbrevTableT));
+}
+
+// parses the abbreviation table at the given offset in .debug_abbrev.
+int dwarfReadAbbrevs(dwarfFileT* f, u64 offset, dwarfAbbrevTableT* t) {
+    dwarfFreeAbbrevs(t);
+    if (offset >= f->abbrev.len) return JIM_ERR;
+    dwarfCursorT c = {f->abbrev.p + offset, f->abbrev.p + f->abbrev.len, 0};
+    while ( ! c.bad) {
+        u64 code = dwarfUleb(&c);
+        if (code == 0) return JIM_OK;
+        if (t->nAbbrevs == t->capAbbrevs) {
+            t->capAbbrevs = t->capAbbrevs * 2 + 64;
+            t->abbrevs = Jim_Realloc(t->abbrevs, t->capAbbrevs * sizeof(dwarfAbbrevT));
+        }
+        dwarfAbbrevT* a = &t->abbrevs[t->nAbbrevs++];
+        a->code = code;
+        a->tag = (u32)dwarfUleb(&c);
+        a->hasChildren = (u8)dwarfFixed(&c, 1);
+        a->firstAttr = t->nAttrs;
+        a->nAttrs = 0;
+        while ( ! c.bad) {
+            u32 name = (u32)dwarfUleb(&c);
+            u32 form = (u32)dwarfUleb(&c);
+            if (name == 0 && form == 0) break;
+            if (t->nAttrs == t->capAttrs) {
+                t->capAttrs = t->capAttrs * 2 + 256;
+                t->attrs = Jim_Realloc(t->attrs, t->capAttrs * sizeof(dwarfAttrSpecT));
+            }
+            dwarfAttrSpecT* s = &t->attrs[t->nAttrs++];
+            s->name = name;
+            s->form = form;
+            s->implicitConst = form == DW_FORM_implicit_const  ?  dwarfSleb(&c)  :  0;
+            a->nAttrs++;
+        }
+    }
+    return JIM_ERR;
+}
+
+dwarfAbbrevT* dwarfFindAbbrev(dwarfAbbrevTableT* t, u64 code) {
+    // codes are almost always assigned in sequence from 1.
+    if (code >= 1 && code <= (u64)t->nAbbrevs && t->abbrevs[code - 1].code == code)
+        return &t->abbrevs[code - 1];
+    for (int i = 0; i < t->nAbbrevs; i++)
+        if (t->abbrevs[i].code == code) return &t->abbrevs[i];
+    return NULL;
+}
+
+// reads one attribute value of the given form.  forms that refer to other files, such as
+// a supplementary file, read as zero.
+int dwarfReadValue(dwarfFileT* f, dwarfUnitT* u, dwarfCursorT* c, u64 form, i64 implicitConst, dwarfValueT* v) {
+    memset(v, 0, sizeof(dwarfValueT));
+    switch (form) {
+    case DW_FORM_addr:          v->num = dwarfFixed(c, u->addrSize); break;
+    case DW_FORM_data1:
+    case DW_FORM_flag:
+    case DW_FORM_addrx1:
+    case DW_FORM_strx1:         v->num = dwarfFixed(c, 1); break;
+    case DW_FORM_data2:
+    case DW_FORM_addrx2:
+    case DW_FORM_strx2:         v->num = dwarfFixed(c, 2); break;
+    case DW_FORM_addrx3:
+    case DW_FORM_strx3:         v->num = dwarfFixed(c, 3); break;
+    case DW_FORM_data4:
+    case DW_FORM_addrx4:
+    case DW_FORM_strx4:
+    case DW_FORM_ref_sup4:      v->num = dwarfFixed(c, 4); break;
+    case DW_FORM_data8:
+    case DW_FORM_ref_sig8:
+    case DW_FORM_ref_sup8:      v->num = dwarfFixed(c, 8); break;
+    case DW_FORM_data16:        dwarfSkip(c, 16); break;
+    case DW_FORM_sdata:         v->num = (u64)dwarfSleb(c); break;
+    case DW_FORM_udata:
+    case DW_FORM_strx:
+    case DW_FORM_addrx:
+    case DW_FORM_loclistx:
+    case DW_FORM_rnglistx:
+    case DW_FORM_GNU_addr_index:
+    case DW_FORM_GNU_str_index: v->num = dwarfUleb(c); break;
+    case DW_FORM_flag_present:  v->num = 1; break;
+    case DW_FORM_implicit_const: v->num = (u64)implicitConst; break;
+    case DW_FORM_sec_offset:
+    case DW_FORM_strp_sup:
+    case DW_FORM_GNU_ref_alt:
+    case DW_FORM_GNU_strp_alt:  v->num = dwarfFixed(c, u->offsetSize); break;
+    case DW_FORM_string:
+        v->str = (const char*)c->p;
+        while (c->p < c->end && *c->p != 0) c->p++;
+        if (c->p == c->end) c->bad = 1; else c->p++;
+        break;
+    case DW_FORM_strp:          v->str = dwarfString(&f->str, dwarfFixed(c, u->offsetSize)); break;
+    case DW_FORM_line_strp:     v->str = dwarfString(&f->lineStr, dwarfFixed(c, u->offsetSize)); break;
+    case DW_FORM_block1:        v->blockLen = dwarfFixed(c, 1); goto block;
+    case DW_FORM_block2:        v->blockLen = dwarfFixed(c, 2); goto block;
+    case DW_FORM_block4:        v->blockLen = dwarfFixed(c, 4); goto block;
+    case DW_FORM_block:
+    case DW_FORM_exprloc:       v->blockLen = dwarfUleb(c);
+    block:
+        v->block = c->p;
+        dwarfSkip(c, v->blockLen);
+        break;
+    case DW_FORM_ref1:          v->num = u->off + dwarfFixed(c, 1); v->isRef = 1; break;
+    case DW_FORM_ref2:          v->num = u->off + dwarfFixed(c, 2); v->isRef = 1; break;
+    case DW_FORM_ref4:          v->num = u->off + dwarfFixed(c, 4); v->isRef = 1; break;
+    case DW_FORM_ref8:          v->num = u->off + dwarfFixed(c, 8); v->isRef = 1; break;
+    case DW_FORM_ref_udata:     v->num = u->off + dwarfUleb(c); v->isRef = 1; break;
+    case DW_FORM_ref_addr:
+        v->num = dwarfFixed(c, u->version <= 2  ?  u->addrSize  :  u->offsetSize);
+        v->isRef = 1;
+        break;
+    case DW_FORM_indirect:
+        return dwarfReadValue(f, u, c, dwarfUleb(c), 0, v);
+    default:
         return JIM_ERR;
     }
-    void* ptr = NULL;
-    if (size > 0) {
-        ptr = Jim_Alloc((int)size);
-        if (ptr == NULL) {
-            Jim_SetResultString(itp, "Alloc failed! Maybe out of heap memory.", -1);
-            return JIM_ERR;
+    // indexed strings resolve through the unit's string offsets.
+    if (form == DW_FORM_strx || (form >= DW_FORM_strx1 && form <= DW_FORM_strx4))
+        v->str = dwarfIndexedString(f, u, v->num);
+    return c->bad  ?  JIM_ERR  :  JIM_OK;
+}
+
+// reads a member offset.  that's a constant, or in older DWARF a location expression
+// consisting of DW_OP_plus_uconst.
+i64 dwarfMemberOffset(dwarfValueT* v) {
+    if (v->block == NULL) return (i64)v->num;
+    dwarfCursorT c = {v->block, v->block + v->blockLen, 0};
+    if (v->blockLen < 2 || dwarfFixed(&c, 1) != DW_OP_plus_uconst) return -1;
+    u64 n = dwarfUleb(&c);
+    return c.bad  ?  -1  :  (i64)n;
+}
+
+int dwarfIsRecorded(u32 tag) {
+    switch (tag) {
+    case DW_TAG_array_type: case DW_TAG_enumeration_type: case DW_TAG_member:
+    case DW_TAG_pointer_type: case DW_TAG_structure_type: case DW_TAG_typedef:
+    case DW_TAG_union_type: case DW_TAG_subrange_type: case DW_TAG_base_type:
+    case DW_TAG_const_type: case DW_TAG_volatile_type: case DW_TAG_restrict_type:
+    case DW_TAG_atomic_type:
+        return 1;
+    }
+    return 0;
+}
+
+// walks every compile unit in .debug_info, recording the entries needed for struct layouts.
+// members are recorded only within structs and unions, and subranges within arrays.
+int dwarfReadDies(Jim_Interp* itp, dwarfFileT* f, dwarfDieListT* list) {
+    dwarfAbbrevTableT abbrevs;
+    memset(&abbrevs, 0, sizeof(abbrevs));
+    int* parents = NULL; // recorded entry that opened each nesting level, or -1.
+    int capParents = 0;
+    dwarfCursorT c = {f->info.p, f->info.p + f->info.len, 0};
+
+    while (c.p < c.end) {
+        dwarfUnitT u;
+        memset(&u, 0, sizeof(u));
+        u.off = c.p - f->info.p;
+        u.offsetSize = 4;
+        u64 unitLen = dwarfFixed(&c, 4);
+        if (unitLen == 0xffffffff) {
+            u.offsetSize = 8;
+            unitLen = dwarfFixed(&c, 8);
+        }
+        if (c.bad || unitLen > (u64)(c.end - c.p)) goto corrupt;
+        const u8* unitEnd = c.p + unitLen;
+        dwarfCursorT uc = {c.p, unitEnd, 0};
+        c.p = unitEnd;
+
+        u.version = (int)dwarfFixed(&uc, 2);
+        if (u.version < 2 || u.version > 5) continue; // unknown unit format; skip it.
+        u64 abbrevOffset;
+        if (u.version >= 5) {
+            u8 unitType = (u8)dwarfFixed(&uc, 1);
+            u.addrSize = (int)dwarfFixed(&uc, 1);
+            abbrevOffset = dwarfFixed(&uc, u.offsetSize);
+            if (unitType == 2 || unitType == 6) dwarfSkip(&uc, 8 + u.offsetSize); // type units.
+            else if (unitType == 4 || unitType == 5) dwarfSkip(&uc, 8); // skeleton and split units.
+        } else {
+            abbrevOffset = dwarfFixed(&uc, u.offsetSize);
+            u.addrSize = (int)dwarfFixed(&uc, 1);
+        }
+        u.strOffsetsBase = u.offsetSize * 2; // past the contribution's header.
+        if (uc.bad || dwarfReadAbbrevs(f, abbrevOffset, &abbrevs) != JIM_OK) goto corrupt;
+
+        int depth = 0;
+        while (uc.p < uc.end) {
+            u64 dieOff = uc.p - f->info.p;
+            u64 code = dwarfUleb(&uc);
+            if (code == 0) {
+                // end of a list of children.
+                if (depth > 0 && parents[--depth] >= 0)
+                    list->dies[parents[depth]].end = list->nDies;
+                continue;
+            }
+            dwarfAbbrevT* a = dwarfFindAbbrev(&abbrevs, code);
+            if (a == NULL) goto corrupt;
+            int parent = depth > 0  ?  parents[depth - 1]  :  -1;
+            u16 parentTag = parent >= 0  ?  list->dies[parent].tag  :  0;
+            int record = dwarfIsRecorded(a->tag);
+            if (a->tag == DW_TAG_member)
+                record = parentTag == DW_TAG_structure_type || parentTag == DW_TAG_union_type;
+            if (a->tag == DW_TAG_subrange_type)
+                record = parentTag == DW_TAG_array_type;
+
+            dwarfDieT d;
+            memset(&d, 0, sizeof(d));
+            d.off = dieOff;
+            d.byteSize = d.memberOffset = d.count = -1;
+            d.parent = parent;
+            d.tag = (u16)a->tag;
+            d.addrSize = (u8)u.addrSize;
+            for (int i = 0; i < a->nAttrs; i++) {
+                dwarfAttrSpecT* s = &abbrevs.attrs[a->firstAttr + i];
+                dwarfValueT v;
+                if (dwarfReadValue(f, &u, &uc, s->form, s->implicitConst, &v) != JIM_OK) goto corrupt;
+                if (a->tag == DW_TAG_compile_unit && s->name == DW_AT_str_offsets_base) {
+                    u.strOffsetsBase = v.num;
+                }
+                if ( ! record) continue;
+                switch (s->name) {
+                case DW_AT_name:        d.name = v.str; break;
+                case DW_AT_type:        if (v.isRef) d.typeOff = v.num; break;
+                case DW_AT_byte_size:   d.byteSize = (i64)v.num; break;
+                case DW_AT_declaration: d.declaration = v.num != 0; break;
+                case DW_AT_count:       d.count = (i64)v.num; break;
+                case DW_AT_upper_bound: if (d.count < 0) d.count = (i64)v.num + 1; break;
+                case DW_AT_data_member_location: d.memberOffset = dwarfMemberOffset(&v); break;
+                }
+            }
+            if (record) {
+                d.end = list->nDies + 1;
+                if (list->nDies == list->capDies) {
+                    list->capDies = list->capDies * 2 + 1024;
+                    list->dies = Jim_Realloc(list->dies, list->capDies * sizeof(dwarfDieT));
+                }
+                list->dies[list->nDies++] = d;
+            }
+            if (a->hasChildren) {
+                if (depth == capParents) {
+                    capParents = capParents * 2 + 32;
+                    parents = Jim_Realloc(parents, capParents * sizeof(int));
+                }
+                parents[depth++] = record  ?  list->nDies - 1  :  -1;
+            }
         }
     }
-    Jim_SetResultInt(itp, (jim_wide)ptr);
+    dwarfFreeAbbrevs(&abbrevs);
+    Jim_Free(parents);
     return JIM_OK;
+
+corrupt:
+    dwarfFreeAbbrevs(&abbrevs);
+    Jim_Free(parents);
+    Jim_SetResultString(itp, "DWARF debug info is corrupt or in an unsupported format.", -1);
+    return JIM_ERR;
 }
 
-// provides direct use of the system heap through Jim_Free(), for scripts.
-// pointer is expected to be a script integer, not binary packed.
-// silently ignores a NULL pointer.
-int freeHeap(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
-    enum {
-        cmdIX = 0,
-        ptrIX,
-        argCount
-    };
+// finds the recorded entry at the given offset in .debug_info, by binary search.
+// entries are recorded in offset order.
+int dwarfFindDie(dwarfDieListT* list, u64 off) {
+    int lo = 0, hi = list->nDies - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (list->dies[mid].off == off) return mid;
+        if (list->dies[mid].off < off) lo = mid + 1; else hi = mid - 1;
+    }
+    return -1;
+}
 
-    if (objc != argCount) {
-        Jim_SetResultString(itp, "Wrong # args.", -1);
-        return JIM_ERR;
+// follows typedefs and qualifiers to the underlying type.  returns its index, or -1.
+int dwarfStripType(dwarfDieListT* list, int ix) {
+    for (int hops = 0; ix >= 0 && hops < 64; hops++) {
+        u16 tag = list->dies[ix].tag;
+        if (tag != DW_TAG_typedef && tag != DW_TAG_const_type && tag != DW_TAG_volatile_type
+            && tag != DW_TAG_restrict_type && tag != DW_TAG_atomic_type)
+            return ix;
+        if (list->dies[ix].typeOff == 0) return -1; // such as const void.
+        ix = dwarfFindDie(list, list->dies[ix].typeOff);
     }
+    return -1;
+}
 
-    jim_wide ptr;
-    if (Jim_GetWide(itp, objv[ptrIX], &ptr) != JIM_OK) {
-        Jim_SetResultString(itp, "Expected heap pointer but got other data.", -1);
-        return JIM_ERR;
+// returns the size of the type at the given offset in .debug_info, or -1 if unknown.
+i64 dwarfTypeSize(dwarfDieListT* list, u64 typeOff, int nesting) {
+    int ix = dwarfStripType(list, dwarfFindDie(list, typeOff));
+    if (ix < 0 || nesting > 16) return -1;
+    dwarfDieT* d = &list->dies[ix];
+    if (d->byteSize >= 0) return d->byteSize;
+    if (d->tag == DW_TAG_pointer_type) return d->addrSize;
+    if (d->tag != DW_TAG_array_type) return -1;
+    i64 size = dwarfTypeSize(list, d->typeOff, nesting + 1);
+    int sawSubrange = 0;
+    for (int j = ix + 1; j < d->end && size >= 0; j++) {
+        if (list->dies[j].parent != ix) continue;
+        sawSubrange = 1;
+        size = list->dies[j].count < 0  ?  -1  :  size * list->dies[j].count;
     }
-    void* p = (void*)ptr;
-    if (p != NULL)
-        Jim_Free(p);
-    return JIM_OK;
+    return sawSubrange  ?  size  :  -1;
 }
 
-// create a Jim_Obj suitable for holding a binary structure of the given length.
-// sets *newBufP to point to the structure.
-// sets *newObjP to point to the new Jim_Obj.
-int createBufferObj(Jim_Interp* itp, int len, void** newBufP, Jim_Obj** newObjP) {
-    char* buf = Jim_Alloc(len + 1); // extra 1 for null terminator is not needed for dlr, but may be needed by any further script operations on the object.
-    if (buf == NULL) {
-        Jim_SetResultString(itp, "Out of memory while allocating buffer.", -1);
-        return JIM_ERR;
+// finds the complete struct or union known by the given name.  that's a typedef's name
+// (if typedefsToo), or else a struct or union tag.  returns its index, or -1.
+int dwarfFindStruct(dwarfDieListT* list, const char* name, int typedefsToo) {
+    int tagged = -1;
+    for (int i = 0; i < list->nDies; i++) {
+        dwarfDieT* d = &list->dies[i];
+        if (d->name == NULL || strcmp(d->name, name) != 0) continue;
+        if (d->tag == DW_TAG_typedef && typedefsToo) {
+            int ix = dwarfStripType(list, dwarfFindDie(list, d->typeOff));
+            if (ix < 0) continue;
+            u16 tag = list->dies[ix].tag;
+            if (tag != DW_TAG_structure_type && tag != DW_TAG_union_type) continue;
+            if ( ! list->dies[ix].declaration) return ix;
+            // the typedef names an incomplete struct in this unit.  find its definition.
+            if (list->dies[ix].name != NULL) {
+                int def = dwarfFindStruct(list, list->dies[ix].name, 0);
+                if (def >= 0) return def;
+            }
+        } else if ((d->tag == DW_TAG_structure_type || d->tag == DW_TAG_union_type)
+            && ! d->declaration && tagged < 0) {
+            tagged = i;
+        }
     }
-    buf[len] = 0; // last-ditch safety for any further script operations on the object.
-    *newBufP = (void*)buf;
-    *newObjP = Jim_NewStringObjNoAlloc(itp, buf, len);
-    return JIM_OK;
+    return tagged;
 }
 
-// create and set a script variable having the given name, suitable for holding a binary
-// structure of the given length.
-// if newBufP is not null, sets *newBufP to point to the structure.
-// if newObjP is not null, sets *newObjP to point to the new Jim_Obj.
-int createBufferVarNative(Jim_Interp* itp, Jim_Obj* varName, int len, void** newBufP, Jim_Obj** newObjP) {
-    void* buf = NULL;
-    Jim_Obj* valueObj = NULL;
-    if (createBufferObj(itp, len, &buf, &valueObj) != JIM_OK)
+// maps the given ELF file, and checks its headers.
+int elfMap(Jim_Interp* itp, const char* fileName, void** mapP, size_t* mapLenP) {
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0) {
+        Jim_SetResultFormatted(itp, "Couldn't open ELF file: %s", fileName);
         return JIM_ERR;
-    if (Jim_SetVariable(itp, varName, valueObj) != JIM_OK) {
-        Jim_SetResultString(itp, "Failed to set variable for buffer.", -1);
+    }
+    off_t len = lseek(fd, 0, SEEK_END);
+    void* map = len > 0  ?  mmap(NULL, (size_t)len, PROT_READ, MAP_PRIVATE, fd, 0)  :  MAP_FAILED;
+    close(fd);
+    if (map == MAP_FAILED) {
+        Jim_SetResultFormatted(itp, "Couldn't map ELF file: %s", fileName);
+        return JIM_ERR;
+    }
+    *mapP = map;
+    *mapLenP = (size_t)len;
+
+    const dwarfEhdrT* eh = (const dwarfEhdrT*)map;
+    if ((size_t)len < sizeof(dwarfEhdrT) || memcmp(eh->e_ident, ELFMAG, SELFMAG) != 0
+        || eh->e_ident[EI_CLASS] != DWARF_ELF_CLASS || eh->e_ident[EI_DATA] != DWARF_ELF_DATA) {
+        Jim_SetResultFormatted(itp, "Not an ELF file for this host: %s", fileName);
+        return JIM_ERR;
+    }
+    if (eh->e_shoff == 0 || eh->e_shentsize != sizeof(dwarfShdrT) || eh->e_shstrndx >= eh->e_shnum
+        || eh->e_shoff > (u64)len || (u64)eh->e_shnum * sizeof(dwarfShdrT) > (u64)len - eh->e_shoff) {
+        Jim_SetResultFormatted(itp, "ELF section headers are missing or corrupt: %s", fileName);
         return JIM_ERR;
     }
-    if (newBufP) *newBufP = (void*)buf;
-    if (newObjP) *newObjP = valueObj;
     return JIM_OK;
 }
 
-// exposes createBufferVarNative() to script.
-int createBufferVar(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
-    enum {
-        cmdIX = 0,
-        varNameIX,
-        lenIX,
-        argCount
-    };
+// returns nonzero if the section's content lies within a file of the given length.
+// compared this way around, so a huge offset or size can't wrap the sum.
+static int elfSectionInBounds(const dwarfShdrT* sh, size_t len) {
+    return sh->sh_size <= (u64)len && sh->sh_offset <= (u64)len - sh->sh_size;
+}
 
-    if (objc != argCount) {
-        Jim_SetResultString(itp, "Wrong # args.", -1);
-        return JIM_ERR;
+// finds the named section in an ELF file mapped by elfMap.  returns its header, or NULL if
+// it's missing, has no content in the file, or is out of bounds.
+const dwarfShdrT* elfFindSection(const u8* base, size_t len, const char* name) {
+    const dwarfEhdrT* eh = (const dwarfEhdrT*)base;
+    const dwarfShdrT* sh = (const dwarfShdrT*)(base + eh->e_shoff);
+    if ( ! elfSectionInBounds(&sh[eh->e_shstrndx], len)) return NULL;
+    dwarfSectionT names = {base + sh[eh->e_shstrndx].sh_offset, sh[eh->e_shstrndx].sh_size};
+    for (int i = 0; i < eh->e_shnum; i++) {
+        const char* secName = dwarfString(&names, sh[i].sh_name);
+        if (secName == NULL || sh[i].sh_type == SHT_NOBITS || strcmp(secName, name) != 0) continue;
+        return elfSectionInBounds(&sh[i], len)  ?  &sh[i]  :  NULL;
     }
+    return NULL;
+}
 
-    jim_wide len;
-    if (Jim_GetWide(itp, objv[lenIX], &len) != JIM_OK) {
-        Jim_SetResultString(itp, "Expected size integer but got other data.", -1);
-        return JIM_ERR;
-    }
+// maps the given ELF file, and finds its DWARF sections.
+int dwarfOpen(Jim_Interp* itp, const char* fileName, dwarfFileT* f, void** mapP, size_t* mapLenP) {
+    memset(f, 0, sizeof(dwarfFileT));
+    if (elfMap(itp, fileName, mapP, mapLenP) != JIM_OK) return JIM_ERR;
 
-    void* bufP = NULL;
-    if (createBufferVarNative(itp, objv[varNameIX], (int)len, &bufP, NULL) != JIM_OK)
+    const u8* base = (const u8*)*mapP;
+    struct { const char* name; dwarfSectionT* sec; } wanted[] = {
+        {".debug_info", &f->info}, {".debug_abbrev", &f->abbrev}, {".debug_str", &f->str},
+        {".debug_line_str", &f->lineStr}, {".debug_str_offsets", &f->strOffsets},
+    };
+    for (unsigned w = 0; w < sizeof(wanted) / sizeof(wanted[0]); w++) {
+        const dwarfShdrT* sh = elfFindSection(base, *mapLenP, wanted[w].name);
+        if (sh == NULL) continue;
+        if (sh->sh_flags & SHF_COMPRESSED) {
+            Jim_SetResultFormatted(itp, "Compressed DWARF debug info isn't supported: %s", fileName);
+            return JIM_ERR;
+        }
+        wanted[w].sec->p = base + sh->sh_offset;
+        wanted[w].sec->len = sh->sh_size;
+    }
+    if (f->info.p == NULL || f->abbrev.p == NULL) {
+        Jim_SetResultFormatted(itp, "No DWARF debug info found in file: %s", fileName);
         return JIM_ERR;
-
-    // pass new buffer's address back to script as result of this command.
-    Jim_SetResultInt(itp, (jim_wide)bufP);
+    }
     return JIM_OK;
 }
 
-// equivalent to [createBufferVar] followed by memcpy() to fill it.
-// this does involve making a copy, so it's OK (and often best) for the script to
-// free the pointer immediately after this.
-int copyToBufferVar(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+// reads struct layouts from DWARF debug info in the given ELF file, which can be the lib itself,
+// or its separate debug file.  request is a flat list of typeName memberNames pairs.
+// returns a dictionary of layout metadata by type name.  each layout has the same form as
+// the ones detected by compiling:  name typeName size N members {memberName {size N offset N} ...}
+// with the members in the requested order.
+//   dwarfStructLayouts fileName request
+int dwarfStructLayouts(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
     enum {
         cmdIX = 0,
-        varNameIX,
-        lenIX,
-        sourcePointerIntValueIX,
+        fileNameIX,
+        requestIX,
         argCount
     };
 
     if (objc != argCount) {
-        Jim_SetResultString(itp, "Wrong # args.", -1);
+        Jim_SetResultString(itp, "Wrong # args.  Should be: dwarfStructLayouts fileName request", -1);
         return JIM_ERR;
     }
-
-    jim_wide len;
-    if (Jim_GetWide(itp, objv[lenIX], &len) != JIM_OK) {
-        Jim_SetResultString(itp, "Expected size integer but got other data.", -1);
+    int reqLen = Jim_ListLength(itp, objv[requestIX]);
+    if (reqLen % 2 != 0) {
+        Jim_SetResultString(itp, "Expected request as a list of typeName memberNames pairs.", -1);
         return JIM_ERR;
     }
-    if (len < 1) {
-        Jim_SetResultString(itp, "Size must be at least 1.", -1);
-        return JIM_ERR;
+
+    dwarfFileT f;
+    void* map = NULL;
+    size_t mapLen = 0;
+    dwarfDieListT list;
+    memset(&list, 0, sizeof(list));
+    int result = JIM_ERR;
+    if (dwarfOpen(itp, Jim_String(objv[fileNameIX]), &f, &map, &mapLen) != JIM_OK) goto done;
+    if (dwarfReadDies(itp, &f, &list) != JIM_OK) goto done;
+
+    Jim_Obj* layouts = Jim_NewDictObj(itp, NULL, 0);
+    for (int r = 0; r < reqLen; r += 2) {
+        Jim_Obj* typeName = Jim_ListGetIndex(itp, objv[requestIX], r);
+        Jim_Obj* memberNames = Jim_ListGetIndex(itp, objv[requestIX], r + 1);
+        int sIX = dwarfFindStruct(&list, Jim_String(typeName), 1);
+        if (sIX < 0) {
+            Jim_SetResultFormatted(itp, "Struct type not found in DWARF debug info: %s", Jim_String(typeName));
+            Jim_FreeNewObj(itp, layouts);
+            goto done;
+        }
+        dwarfDieT* s = &list.dies[sIX];
+        Jim_Obj* members = Jim_NewDictObj(itp, NULL, 0);
+        int nMembers = Jim_ListLength(itp, memberNames);
+        for (int m = 0; m < nMembers; m++) {
+            Jim_Obj* mName = Jim_ListGetIndex(itp, memberNames, m);
+            i64 mSize = -1, mOffset = -1;
+            for (int j = sIX + 1; j < s->end; j++) {
+                dwarfDieT* d = &list.dies[j];
+                if (d->parent != sIX || d->name == NULL || strcmp(d->name, Jim_String(mName)) != 0) continue;
+                mSize = dwarfTypeSize(&list, d->typeOff, 0);
+                // union members have no location.  they're all at offset 0.
+                mOffset = d->memberOffset >= 0  ?  d->memberOffset  :  (s->tag == DW_TAG_union_type  ?  0  :  -1);
+                break;
+            }
+            if (mSize < 0 || mOffset < 0) {
+                Jim_SetResultFormatted(itp, "Struct member or its layout not found in DWARF debug info: %s.%s",
+                    Jim_String(typeName), Jim_String(mName));
+                Jim_FreeNewObj(itp, members);
+                Jim_FreeNewObj(itp, layouts);
+                goto done;
+            }
+            Jim_Obj* mElems[] = {
+                Jim_NewStringObj(itp, "size", -1),      Jim_NewIntObj(itp, mSize),
+                Jim_NewStringObj(itp, "offset", -1),    Jim_NewIntObj(itp, mOffset),
+            };
+            Jim_DictAddElement(itp, members, mName, Jim_NewDictObj(itp, mElems, 4));
+        }
+        Jim_Obj* elems[] = {
+            Jim_NewStringObj(itp, "name", -1),      typeName,
+            Jim_NewStringObj(itp, "size", -1),      Jim_NewIntObj(itp, s->byteSize),
+            Jim_NewStringObj(itp, "members", -1),   members,
+        };
+        Jim_DictAddElement(itp, layouts, typeName, Jim_NewDictObj(itp, elems, 6));
     }
+    Jim_SetResult(itp, layouts);
+    result = JIM_OK;
 
-    jim_wide srcW;
-    if (Jim_GetWide(itp, objv[sourcePointerIntValueIX], &srcW) != JIM_OK) {
-        Jim_SetResultString(itp, "Expected source pointer integer but got other data.", -1);
+done:
+    Jim_Free(list.dies);
+    if (map != NULL) munmap(map, mapLen);
+    return result;
+}
+
+// returns the GNU build-id of the given ELF file in hex, or an empty string if it has none.
+// the linker derives that from the file's content, so it changes whenever the lib is rebuilt.
+//   buildId fileName
+int buildId(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    if (objc != 2) {
+        Jim_SetResultString(itp, "Wrong # args.  Should be: buildId fileName", -1);
         return JIM_ERR;
     }
-    void* srcP = (void*)srcW;
-    if (srcP == NULL) {
-        Jim_SetResultString(itp, "Source pointer must not be null.", -1);
+    void* map = NULL;
+    size_t mapLen = 0;
+    if (elfMap(itp, Jim_String(objv[1]), &map, &mapLen) != JIM_OK) {
+        if (map != NULL) munmap(map, mapLen);
         return JIM_ERR;
     }
-
-    void* bufP = NULL;
-    if (createBufferVarNative(itp, objv[varNameIX], (int)len, &bufP, NULL) != JIM_OK)
+    Jim_Obj* id = Jim_NewEmptyStringObj(itp);
+    const dwarfShdrT* sh = elfFindSection((const u8*)map, mapLen, ".note.gnu.build-id");
+    if (sh != NULL) {
+        // one note:  name size, descriptor size, type, then the name and descriptor, each padded.
+        dwarfCursorT c = {(const u8*)map + sh->sh_offset, (const u8*)map + sh->sh_offset + sh->sh_size, 0};
+        u64 nameSize = dwarfFixed(&c, 4);
+        u64 descSize = dwarfFixed(&c, 4);
+        u64 type = dwarfFixed(&c, 4);
+        dwarfSkip(&c, (nameSize + 3) & ~(u64)3);
+        if (type == NT_GNU_BUILD_ID && ! c.bad && descSize <= (u64)(c.end - c.p)) {
+            for (u64 i = 0; i < descSize; i++) {
+                char hex[3];
+                snprintf(hex, sizeof(hex), "%02x", c.p[i]);
+                Jim_AppendString(itp, id, hex, 2);
+            }
+        }
+    }
+    munmap(map, mapLen);
+    Jim_SetResult(itp, id);
+    return JIM_OK;
+}
+
+// returns a 64-bit FNV-1a hash of the given value, in hex.  that's for noticing changes in the
+// inputs of generated metadata, not for security.
+//   hash value
+int hashValue(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    if (objc != 2) {
+        Jim_SetResultString(itp, "Wrong # args.  Should be: hash value", -1);
+        return JIM_ERR;
+    }
+    int len = 0;
+    const u8* bytes = (const u8*)Jim_GetString(objv[1], &len);
+    u64 h = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < len; i++) {
+        h ^= bytes[i];
+        h *= 0x100000001b3ULL;
+    }
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)h);
+    Jim_SetResultString(itp, hex, -1);
+    return JIM_OK;
+}
+
+// a native buffer is a Jim_Obj whose internal rep holds a block of native memory.
+// unlike a string buffer, its content stays at the same address for as long as the
+// object lives, no matter how many variables or calls it's passed through.  a string rep
+// is generated only if a script actually asks for one, and dlr discards that again
+// before writing to the block, so it never goes stale.
+// a duplicate made by Jim gets its own copy of the content, so it behaves as a separate value,
+// like a string would.  only a slice shares memory with its source, since that's requested
+// explicitly.  the block is released after the last object viewing it is freed.
+// the block lists every object viewing it, so a write through any one of them discards
+// the string reps of all of them, the source and its slices alike.
+typedef struct {
+    int refCount; // number of native buffer objects viewing the block.  also the length of views.
+    int owned; // free data with Jim_Free after the last view is gone.
+    u8* data;
+    int maxViews;
+    Jim_Obj** views;
+} nativeBlockT;
+
+static void freeNativeBufIntRep(Jim_Interp* itp, Jim_Obj* obj);
+static void dupNativeBufIntRep(Jim_Interp* itp, Jim_Obj* src, Jim_Obj* dup);
+static void updateNativeBufString(Jim_Obj* obj);
+
+static const Jim_ObjType nativeBufType = {
+    "dlr-nativeBuffer",
+    freeNativeBufIntRep,
+    dupNativeBufIntRep,
+    updateNativeBufString,
+    JIM_TYPE_NONE
+};
+
+// the internal rep is the block, plus the offset and length of this object's view of it.
+#define NB_BLOCK(obj)   ((nativeBlockT*)(obj)->internalRep.ptrIntValue.ptr)
+#define NB_OFFSET(obj)  ((obj)->internalRep.ptrIntValue.int1)
+#define NB_LEN(obj)     ((obj)->internalRep.ptrIntValue.int2)
+
+static nativeBlockT* newNativeBlock(u8* data, int owned) {
+    nativeBlockT* b = Jim_Alloc(sizeof(nativeBlockT));
+    b->refCount = 0;
+    b->owned = owned;
+    b->data = data;
+    b->maxViews = 0;
+    b->views = NULL;
+    return b;
+}
+
+// makes obj a view of len bytes of the block, starting at offset.
+static void attachNativeBlock(Jim_Obj* obj, nativeBlockT* b, int offset, int len) {
+    if (b->refCount == b->maxViews) {
+        b->maxViews = b->maxViews == 0  ?  2  :  b->maxViews * 2;
+        b->views = Jim_Realloc(b->views, b->maxViews * sizeof(Jim_Obj*));
+    }
+    b->views[b->refCount++] = obj;
+    obj->typePtr = &nativeBufType;
+    obj->internalRep.ptrIntValue.ptr = b;
+    NB_OFFSET(obj) = offset;
+    NB_LEN(obj) = len;
+}
+
+static void freeNativeBufIntRep(Jim_Interp* itp, Jim_Obj* obj) {
+    nativeBlockT* b = NB_BLOCK(obj);
+    for (int i = 0; i < b->refCount; i++) {
+        if (b->views[i] == obj) {
+            b->views[i] = b->views[b->refCount - 1];
+            break;
+        }
+    }
+    if (--b->refCount > 0) return;
+    if (b->owned) Jim_Free(b->data);
+    Jim_Free(b->views);
+    Jim_Free(b);
+}
+
+static void dupNativeBufIntRep(Jim_Interp* itp, Jim_Obj* src, Jim_Obj* dup) {
+    int len = NB_LEN(src);
+    nativeBlockT* b = newNativeBlock(Jim_Alloc(len > 0  ?  len  :  1), 1);
+    memcpy(b->data, NB_BLOCK(src)->data + NB_OFFSET(src), len);
+    attachNativeBlock(dup, b, 0, len);
+}
+
+static void updateNativeBufString(Jim_Obj* obj) {
+    int len = NB_LEN(obj);
+    obj->bytes = Jim_Alloc(len + 1);
+    memcpy(obj->bytes, NB_BLOCK(obj)->data + NB_OFFSET(obj), len);
+    obj->bytes[len] = 0;
+    obj->length = len;
+}
+
+// creates a native buffer object viewing len bytes at data.  if data is NULL, allocates a new
+// zeroed block instead.  if owned, the block is freed by Jim_Free after the last view is gone.
+Jim_Obj* newNativeBufferObj(Jim_Interp* itp, void* data, int len, int owned) {
+    if (data == NULL) {
+        data = Jim_Alloc(len > 0  ?  len  :  1);
+        memset(data, 0, len);
+        owned = 1;
+    }
+    Jim_Obj* obj = Jim_NewObj(itp);
+    obj->bytes = NULL;
+    obj->length = 0;
+    attachNativeBlock(obj, newNativeBlock((u8*)data, owned), 0, len);
+    return obj;
+}
+
+// returns the address of a buffer value's content, and sets *lenP to its length if lenP isn't NULL.
+// a native buffer gives its block directly, without generating a string rep.
+// any other value gives its string rep.
+u8* bufferBytes(Jim_Obj* v, int* lenP) {
+    if (v->typePtr == &nativeBufType) {
+        if (lenP) *lenP = NB_LEN(v);
+        return NB_BLOCK(v)->data + NB_OFFSET(v);
+    }
+    return (u8*)Jim_GetString(v, lenP);
+}
+
+// the same as bufferBytes, for content that's about to be written, by a packer or a native call.
+// that discards the string rep of every object viewing a native buffer's block, since they're
+// all about to be outdated.
+u8* bufferBytesForWrite(Jim_Obj* v, int* lenP) {
+    if (v->typePtr == &nativeBufType) {
+        nativeBlockT* b = NB_BLOCK(v);
+        for (int i = 0; i < b->refCount; i++) {
+            if (b->views[i]->bytes != NULL)
+                Jim_InvalidateStringRep(b->views[i]);
+        }
+    }
+    return bufferBytes(v, lenP);
+}
+
+int isNativeBuffer(Jim_Obj* v) {
+    return v->typePtr == &nativeBufType;
+}
+
+int bufferLength(Jim_Obj* v) {
+    return v->typePtr == &nativeBufType  ?  NB_LEN(v)  :  Jim_Length(v);
+}
+
+// a pointer object is a Jim_Obj whose internal rep holds a raw native pointer, so packers
+// and native calls read it without parsing an integer each time.  it also holds the pointer's
+// declared target type, when that's known, and whether it's the null pointer flag.
+// its string rep is the pointer's decimal integer value, the same as before, so scripts can
+// still do arithmetic and [format] on it.  the null pointer flag's string rep is the flag string.
+// any script integer is still accepted as a pointer.  it's converted to a pointer object
+// the first time it's used as one, so it's only parsed once.
+static void dupPointerIntRep(Jim_Interp* itp, Jim_Obj* src, Jim_Obj* dup);
+static void updatePointerString(Jim_Obj* obj);
+
+static const Jim_ObjType pointerType = {
+    "dlr-pointer",
+    NULL,
+    dupPointerIntRep,
+    updatePointerString,
+    JIM_TYPE_NONE
+};
+
+// the internal rep is the pointer, its interned target type ID (0 = unknown), and flags.
+#define PO_PTR(obj)     ((obj)->internalRep.ptrIntValue.ptr)
+#define PO_TYPE(obj)    ((obj)->internalRep.ptrIntValue.int1)
+#define PO_FLAGS(obj)   ((obj)->internalRep.ptrIntValue.int2)
+#define PF_NULL_FLAG    1
+
+static void dupPointerIntRep(Jim_Interp* itp, Jim_Obj* src, Jim_Obj* dup) {
+    dup->typePtr = &pointerType;
+    dup->internalRep.ptrIntValue = src->internalRep.ptrIntValue;
+}
+
+static void updatePointerString(Jim_Obj* obj) {
+    char buf[32];
+    int len = 0;
+    if (PO_FLAGS(obj) & PF_NULL_FLAG) {
+        strcpy(buf, DLR_NULL_PTR_FLAG);
+        len = DLR_NULL_PTR_FLAG_STRLEN;
+    } else {
+        len = snprintf(buf, sizeof(buf), "%lld", (long long)(jim_wide)PO_PTR(obj));
+    }
+    obj->bytes = Jim_Alloc(len + 1);
+    memcpy(obj->bytes, buf, len + 1);
+    obj->length = len;
+}
+
+// target type names are interned once, when a function is declared, so a pointer object
+// carries only a small integer ID.  IDs count from 1.  each interpreter has its own table of
+// names in its assoc data, so it's only touched on that interpreter's thread.
+#define POINTER_TYPES_KEY "dlrPointerTypes"
+
+typedef struct {
+    char** names;
+    int nNames;
+} pointerTypesT;
+
+void deletePointerTypes(Jim_Interp* itp, void* data) {
+    pointerTypesT* t = (pointerTypesT*)data;
+    for (int n = 0; n < t->nNames; n++)
+        Jim_Free(t->names[n]);
+    Jim_Free(t->names);
+    Jim_Free(t);
+}
+
+int internPointerType(Jim_Interp* itp, const char* name) {
+    if (name == NULL || *name == 0) return 0;
+    pointerTypesT* t = (pointerTypesT*)Jim_GetAssocData(itp, POINTER_TYPES_KEY);
+    if (t == NULL) {
+        t = Jim_Alloc(sizeof(pointerTypesT));
+        t->names = NULL;
+        t->nNames = 0;
+        Jim_SetAssocData(itp, POINTER_TYPES_KEY, deletePointerTypes, t);
+    }
+    for (int n = 0; n < t->nNames; n++)
+        if (strcmp(t->names[n], name) == 0)
+            return n + 1;
+    t->names = Jim_Realloc(t->names, (t->nNames + 1) * sizeof(char*));
+    t->names[t->nNames++] = Jim_StrDup(name);
+    return t->nNames;
+}
+
+Jim_Obj* newPointerObj(Jim_Interp* itp, void* p, int typeID) {
+    Jim_Obj* obj = Jim_NewObj(itp);
+    obj->bytes = NULL;
+    obj->length = 0;
+    obj->typePtr = &pointerType;
+    PO_PTR(obj) = p;
+    PO_TYPE(obj) = typeID;
+    PO_FLAGS(obj) = 0;
+    return obj;
+}
+
+// returns a new null pointer flag object.  it passes as a null pointer wherever a pointer is expected,
+// and wherever a string or other target value may be null.
+Jim_Obj* newNullPtrFlagObj(Jim_Interp* itp) {
+    Jim_Obj* obj = newPointerObj(itp, NULL, 0);
+    PO_FLAGS(obj) = PF_NULL_FLAG;
+    return obj;
+}
+
+// fetches the pointer held by a script value.  a pointer object gives it without parsing.
+// any other value must be an integer, and is converted to a pointer object.
+// the null pointer flag gives NULL.  on failure, leaves an error message in the interp result.
+int getPointer(Jim_Interp* itp, Jim_Obj* v, void** pP) {
+    if (v->typePtr == &pointerType) {
+        *pP = PO_PTR(v);
+        return JIM_OK;
+    }
+    jim_wide w = 0;
+    int flags = 0;
+    if (Jim_GetWide(itp, v, &w) != JIM_OK) {
+        if ( ! Jim_CompareStringImmediate(itp, v, DLR_NULL_PTR_FLAG)) {
+            Jim_SetResultString(itp, "Expected pointer integer but got other data.", -1);
+            return JIM_ERR;
+        }
+        Jim_SetEmptyResult(itp);
+        flags = PF_NULL_FLAG;
+    }
+    // the string rep is kept, or else regenerated identically.
+    Jim_FreeIntRep(itp, v);
+    v->typePtr = &pointerType;
+    PO_PTR(v) = (void*)w;
+    PO_TYPE(v) = 0;
+    PO_FLAGS(v) = flags;
+    *pP = (void*)w;
+    return JIM_OK;
+}
+
+// returns 1 if the value is the null pointer flag.  for a pointer object or a native buffer
+// that's a tag test.  other values are compared as strings.
+int isNullPtrFlag(Jim_Interp* itp, Jim_Obj* v) {
+    if (v->typePtr == &pointerType)
+        return (PO_FLAGS(v) & PF_NULL_FLAG) != 0;
+    if (isNativeBuffer(v))
+        return 0;
+    return Jim_CompareStringImmediate(itp, v, DLR_NULL_PTR_FLAG);
+}
+
+// the pointer functions compiled call stubs use.  see stubApiT.
+static stubApiT stubApi = {getPointer, newPointerObj, internPointerType};
+
+// returns a new pointer object, for the given pointer integer, optionally tagged with a target type name.
+//   newPointer pointerIntValue ?typeName?
+int newPointer(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    enum {
+        cmdIX = 0,
+        pointerIntValueIX,
+        typeNameIX,
+        argCount
+    };
+
+    if (objc < typeNameIX || objc > argCount) {
+        Jim_SetResultString(itp, "Wrong # args.  Should be: newPointer pointerIntValue ?typeName?", -1);
+        return JIM_ERR;
+    }
+    void* p = NULL;
+    if (getPointer(itp, objv[pointerIntValueIX], &p) != JIM_OK) return JIM_ERR;
+    Jim_SetResult(itp, newPointerObj(itp, p, objc > typeNameIX  ?  internPointerType(itp, Jim_String(objv[typeNameIX]))  :  0));
+    return JIM_OK;
+}
+
+// returns the target type name a pointer object was tagged with, or an empty string if it's unknown.
+//   pointerType value
+int pointerTypeName(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    if (objc != 2) {
+        Jim_SetResultString(itp, "Wrong # args.  Should be: pointerType value", -1);
+        return JIM_ERR;
+    }
+    Jim_Obj* v = objv[1];
+    pointerTypesT* t = (pointerTypesT*)Jim_GetAssocData(itp, POINTER_TYPES_KEY);
+    if (v->typePtr == &pointerType && t != NULL && PO_TYPE(v) > 0 && PO_TYPE(v) <= t->nNames) {
+        Jim_SetResultString(itp, t->names[PO_TYPE(v) - 1], -1);
+    } else {
+        Jim_SetResultString(itp, "", 0);
+    }
+    return JIM_OK;
+}
+
+// returns a new null pointer flag object.  scripts should use this instead of the flag string,
+// so that null checks are a tag test.
+int nullPtrFlag(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    Jim_SetResult(itp, newNullPtrFlagObj(itp));
+    return JIM_OK;
+}
+
+// returns a new native buffer of the given size, zeroed.
+//   newBuffer size
+// or, returns a native buffer viewing size bytes at an existing native pointer, without a copy.
+// with owned true, the buffer takes ownership of that memory block, and frees it by Jim_Free
+// (the same as freeHeap) after it's no longer needed.  otherwise the app must keep the
+// memory alive for as long as the buffer is used.
+//   wrapBuffer pointerIntValue size ?owned?
+int newBuffer(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    enum {
+        cmdIX = 0,
+        sizeIX,
+        argCount
+    };
+
+    jim_wide size = 0;
+    if (objc != argCount || Jim_GetWide(itp, objv[sizeIX], &size) != JIM_OK || size < 0 || size > INT32_MAX) {
+        Jim_SetResultString(itp, "Expected size integer.  Should be: newBuffer size", -1);
+        return JIM_ERR;
+    }
+    Jim_SetResult(itp, newNativeBufferObj(itp, NULL, (int)size, 1));
+    return JIM_OK;
+}
+
+int wrapBuffer(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    enum {
+        cmdIX = 0,
+        pointerIntValueIX,
+        sizeIX,
+        ownedIX,
+        argCount
+    };
+
+    if (objc < ownedIX || objc > argCount) {
+        Jim_SetResultString(itp, "Wrong # args.  Should be: wrapBuffer pointerIntValue size ?owned?", -1);
+        return JIM_ERR;
+    }
+    void* p = NULL;
+    if (getPointer(itp, objv[pointerIntValueIX], &p) != JIM_OK || p == NULL) {
+        Jim_SetResultString(itp, "Expected non-null pointer integer but got other data.", -1);
+        return JIM_ERR;
+    }
+    jim_wide size = 0;
+    if (Jim_GetWide(itp, objv[sizeIX], &size) != JIM_OK || size < 0 || size > INT32_MAX) {
+        Jim_SetResultString(itp, "Expected size integer but got other data.", -1);
+        return JIM_ERR;
+    }
+    int owned = 0;
+    if (objc > ownedIX && Jim_GetBoolean(itp, objv[ownedIX], &owned) != JIM_OK) {
+        Jim_SetResultString(itp, "Expected owned boolean but got other data.", -1);
+        return JIM_ERR;
+    }
+    Jim_SetResult(itp, newNativeBufferObj(itp, p, (int)size, owned));
+    return JIM_OK;
+}
+
+// returns a native buffer viewing length bytes of the given value, starting at offset.
+// if the value is a native buffer, the slice shares its memory, so writing either one
+// changes both.  any other value is copied into a new native buffer first.
+int sliceBuffer(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    enum {
+        cmdIX = 0,
+        bufferIX,
+        offsetIX,
+        lengthIX,
+        argCount
+    };
+
+    if (objc != argCount) {
+        Jim_SetResultString(itp, "Wrong # args.  Should be: sliceBuffer buffer offset length", -1);
+        return JIM_ERR;
+    }
+    Jim_Obj* v = objv[bufferIX];
+    int len = 0;
+    u8* bytes = bufferBytes(v, &len);
+    jim_wide offset = 0, length = 0;
+    if (Jim_GetWide(itp, objv[offsetIX], &offset) != JIM_OK || Jim_GetWide(itp, objv[lengthIX], &length) != JIM_OK
+        || offset < 0 || length < 0 || offset + length > len) {
+        Jim_SetResultString(itp, "Slice is outside the buffer.", -1);
+        return JIM_ERR;
+    }
+    if ( ! isNativeBuffer(v)) {
+        Jim_Obj* copy = newNativeBufferObj(itp, NULL, (int)length, 1);
+        memcpy(bufferBytes(copy, NULL), bytes + offset, length);
+        Jim_SetResult(itp, copy);
+        return JIM_OK;
+    }
+    Jim_Obj* slice = Jim_NewObj(itp);
+    slice->bytes = NULL;
+    slice->length = 0;
+    attachNativeBlock(slice, NB_BLOCK(v), NB_OFFSET(v) + (int)offset, (int)length);
+    Jim_SetResult(itp, slice);
+    return JIM_OK;
+}
+
+// returns the address of a buffer value's content, as an integer.  unlike addrOf, this takes
+// the value itself, not a variable name.  it's stable only for a native buffer.
+int bufferAddr(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    if (objc != 2) {
+        Jim_SetResultString(itp, "Wrong # args.  Should be: bufferAddr buffer", -1);
+        return JIM_ERR;
+    }
+    Jim_SetResult(itp, newPointerObj(itp, (void*)bufferBytesForWrite(objv[1], NULL), 0));
+    return JIM_OK;
+}
+
+// returns 1 if the value is the null pointer flag.  a native buffer never is, and this avoids
+// generating its string rep just to compare it.  a pointer object is a tag test.
+int isNullFlag(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    if (objc != 2) {
+        Jim_SetResultString(itp, "Wrong # args.  Should be: isNullFlag value", -1);
+        return JIM_ERR;
+    }
+    Jim_SetResultBool(itp, isNullPtrFlag(itp, objv[1]));
+    return JIM_OK;
+}
+
+/*
+addrOf() returns (to the script) an integer which is the memory address of the
+content bytes of the given variable name.  this always refers to the
+string representation, and none of Jim's internal representations.
+if the variable object's string representation is outdated due to
+previous script actions, then this command automatically updates it
+from the object's internal reps before extracting the address.
+(that's normal behavior for any Tcl command that requires a string.)
+thus addrOf() always returns a pointer to a string buffer.
+the exception is a native buffer object (see newNativeBufferObj), which
+gives the stable address of its memory block, without any string rep.
+in C, that is a "char*".  the buffer contains a string of ASCII or
+UTF8, or if it was prepared by packing, it contains a binary blob.
+note: if the string rep is already up to date, then it won't be touched,
+and will yield the same address as the last call to addrOf().  that's
+the case if the script hasn't assigned to that variable at all since
+the last call to addrOf().
+*/
+int addrOf(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    enum {
+        cmdIX = 0,
+        varNameIX,
+        argCount
+    };
+
+    if (objc != argCount) {
+        Jim_SetResultString(itp, "Wrong # args.", -1);
+        return JIM_ERR;
+    }
+
+    Jim_Obj* v = Jim_GetVariable(itp, objv[varNameIX], JIM_NONE);
+    if (v == NULL) {
+        Jim_SetResultString(itp, "Variable not found.", -1);
+        return JIM_ERR;
+    }
+    Jim_SetResult(itp, newPointerObj(itp, (void*)bufferBytesForWrite(v, NULL), 0));
+    return JIM_OK;
+}
+
+// provides direct use of the system heap through Jim_Alloc(), for scripts.
+// size is expected to be a script integer, not binary packed.
+// heap pointer is returned as a script integer, not binary packed.
+// throws a script error if the alloc fails.
+// this command creates easy opportunities for memory leaks and other bugs,
+// and blatant tests of such leaks have somehow eluded valgrind!
+// therefore createBufferVar is recommended instead.  that way the interpreter
+// tracks the memory block and can collect it automatically.
+// Jim's pack command works easily with that.
+// Jim references should work well with that too.
+int allocHeap(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    enum {
+        cmdIX = 0,
+        sizeIX,
+        argCount
+    };
+
+    if (objc != argCount) {
+        Jim_SetResultString(itp, "Wrong # args.", -1);
+        return JIM_ERR;
+    }
+
+    jim_wide size;
+    if (Jim_GetWide(itp, objv[sizeIX], &size) != JIM_OK) {
+        Jim_SetResultString(itp, "Expected size integer but got other data.", -1);
+        return JIM_ERR;
+    }
+    void* ptr = NULL;
+    if (size > 0) {
+        ptr = Jim_Alloc((int)size);
+        if (ptr == NULL) {
+            Jim_SetResultString(itp, "Alloc failed! Maybe out of heap memory.", -1);
+            return JIM_ERR;
+        }
+    }
+    Jim_SetResult(itp, newPointerObj(itp, (void*)ptr, 0));
+    return JIM_OK;
+}
+
+// provides direct use of the system heap through Jim_Free(), for scripts.
+// pointer is expected to be a script integer, not binary packed.
+// silently ignores a NULL pointer.
+int freeHeap(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    enum {
+        cmdIX = 0,
+        ptrIX,
+        argCount
+    };
+
+    if (objc != argCount) {
+        Jim_SetResultString(itp, "Wrong # args.", -1);
+        return JIM_ERR;
+    }
+
+    void* p = NULL;
+    if (getPointer(itp, objv[ptrIX], &p) != JIM_OK) {
+        Jim_SetResultString(itp, "Expected heap pointer but got other data.", -1);
+        return JIM_ERR;
+    }
+    if (p != NULL)
+        Jim_Free(p);
+    return JIM_OK;
+}
+
+// a block pool hands out fixed-size blocks of native memory, such as struct buffers passed
+// to native functions by pointer, in O(1) without touching the general heap.  freed blocks
+// go on a free list, and are handed out again while they're still warm in the CPU cache.
+// each block is aligned to a cache line, and its size is rounded up to whole cache lines,
+// so blocks never share a line.  the pool grows a slab at a time, count blocks per slab.
+// all slabs are freed when the pool command is deleted (rename it to {}).  any blocks
+// still in use become invalid then.
+// the pool is only touched on its interpreter's thread.
+// each slab has a bitmap of the blocks in use, so freeing a block twice, or freeing
+// anything but a block from this pool, is refused instead of corrupting the free list.
+// a free block holds the free list link, and its slab, so alloc finds its bit in O(1).
+// free searches the slabs for the block.  there are few slabs, since each holds count blocks.
+#define POOL_ALIGN 64
+
+typedef struct poolSlabT {
+    struct poolSlabT* next;
+    u8* blocks;
+    u8 inUse[]; // one bit per block.
+} poolSlabT;
+
+typedef struct {
+    void* next; // next block in the free list, or NULL.
+    poolSlabT* slab; // slab containing this block.
+} poolFreeBlockT;
+
+typedef struct {
+    size_t blockSize; // rounded up to whole cache lines.
+    int perSlab;
+    int typeID; // interned target type for pointers handed out, or 0.
+    void* freeList; // each free block is a poolFreeBlockT.
+    poolSlabT* slabs;
+    jim_wide capacity;
+    jim_wide inUse;
+    jim_wide highWater;
+    jim_wide allocs;
+    jim_wide frees;
+} blockPoolT;
+
+void deleteBlockPool(Jim_Interp* itp, void* privData) {
+    blockPoolT* pool = (blockPoolT*)privData;
+    while (pool->slabs != NULL) {
+        poolSlabT* next = pool->slabs->next;
+        free(pool->slabs->blocks);
+        Jim_Free(pool->slabs);
+        pool->slabs = next;
+    }
+    Jim_Free(pool);
+}
+
+// adds a slab of blocks to the pool's free list.
+int growBlockPool(Jim_Interp* itp, blockPoolT* pool) {
+    u8* blocks = aligned_alloc(POOL_ALIGN, pool->blockSize * pool->perSlab);
+    if (blocks == NULL) {
+        Jim_SetResultString(itp, "Out of memory while growing block pool.", -1);
+        return JIM_ERR;
+    }
+    size_t mapLen = ((size_t)pool->perSlab + 7) / 8;
+    poolSlabT* slab = Jim_Alloc(sizeof(poolSlabT) + mapLen);
+    memset(slab->inUse, 0, mapLen);
+    slab->blocks = blocks;
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+    // link the blocks in address order, so they're handed out that way.
+    for (int n = pool->perSlab - 1; n >= 0; n--) {
+        poolFreeBlockT* block = (poolFreeBlockT*)(blocks + n * pool->blockSize);
+        block->next = pool->freeList;
+        block->slab = slab;
+        pool->freeList = block;
+    }
+    pool->capacity += pool->perSlab;
+    return JIM_OK;
+}
+
+// a block pool command's subcommands:
+//   alloc          returns a pointer to a zeroed block.
+//   free pointer   returns a block to the pool.  silently ignores a null pointer.
+//   blockSize      returns the size of each block in bytes, after rounding.
+//   stats          returns a dictionary of usage counters.
+int blockPoolCmd(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    enum {
+        cmdIX = 0,
+        subCmdIX,
+        argsIX
+    };
+    static const char * const subCmds[] = {"alloc", "free", "blockSize", "stats", NULL};
+    enum { SC_ALLOC, SC_FREE, SC_BLOCK_SIZE, SC_STATS };
+
+    blockPoolT* pool = (blockPoolT*)Jim_CmdPrivData(itp);
+    if (objc < argsIX) {
+        Jim_WrongNumArgs(itp, 1, objv, "subcommand ?arg ...?");
+        return JIM_ERR;
+    }
+    int sc;
+    if (Jim_GetEnum(itp, objv[subCmdIX], subCmds, &sc, "subcommand", JIM_ERRMSG) != JIM_OK)
+        return JIM_ERR;
+
+    switch (sc) {
+    case SC_ALLOC: {
+        if (pool->freeList == NULL && growBlockPool(itp, pool) != JIM_OK) return JIM_ERR;
+        poolFreeBlockT* block = (poolFreeBlockT*)pool->freeList;
+        pool->freeList = block->next;
+        size_t n = ((u8*)block - block->slab->blocks) / pool->blockSize;
+        block->slab->inUse[n / 8] |= (u8)(1 << (n % 8));
+        memset(block, 0, pool->blockSize);
+        pool->allocs++;
+        if (++pool->inUse > pool->highWater) pool->highWater = pool->inUse;
+        Jim_SetResult(itp, newPointerObj(itp, block, pool->typeID));
+        return JIM_OK;
+    }
+    case SC_FREE: {
+        void* block = NULL;
+        if (objc != argsIX + 1) {
+            Jim_WrongNumArgs(itp, 2, objv, "pointer");
+            return JIM_ERR;
+        }
+        if (getPointer(itp, objv[argsIX], &block) != JIM_OK) return JIM_ERR;
+        if (block == NULL) return JIM_OK;
+        // find the block's slab, and verify it's at a block boundary there, and in use.
+        poolSlabT* slab = pool->slabs;
+        size_t slabLen = pool->blockSize * pool->perSlab;
+        while (slab != NULL && ((u8*)block < slab->blocks || (u8*)block >= slab->blocks + slabLen))
+            slab = slab->next;
+        size_t n = slab == NULL  ?  0  :  ((u8*)block - slab->blocks) / pool->blockSize;
+        if (slab == NULL || ((u8*)block - slab->blocks) % pool->blockSize != 0
+            || (slab->inUse[n / 8] & (1 << (n % 8))) == 0) {
+            Jim_SetResultString(itp, "Pointer isn't a block in use from this pool.", -1);
+            return JIM_ERR;
+        }
+        slab->inUse[n / 8] &= (u8)~(1 << (n % 8));
+        poolFreeBlockT* freed = (poolFreeBlockT*)block;
+        freed->next = pool->freeList;
+        freed->slab = slab;
+        pool->freeList = freed;
+        pool->frees++;
+        pool->inUse--;
+        return JIM_OK;
+    }
+    case SC_BLOCK_SIZE:
+        Jim_SetResultInt(itp, (jim_wide)pool->blockSize);
+        return JIM_OK;
+    case SC_STATS: {
+        Jim_Obj* elems[] = {
+            Jim_NewStringObj(itp, "blockSize", -1), Jim_NewIntObj(itp, (jim_wide)pool->blockSize),
+            Jim_NewStringObj(itp, "capacity", -1),  Jim_NewIntObj(itp, pool->capacity),
+            Jim_NewStringObj(itp, "inUse", -1),     Jim_NewIntObj(itp, pool->inUse),
+            Jim_NewStringObj(itp, "highWater", -1), Jim_NewIntObj(itp, pool->highWater),
+            Jim_NewStringObj(itp, "allocs", -1),    Jim_NewIntObj(itp, pool->allocs),
+            Jim_NewStringObj(itp, "frees", -1),     Jim_NewIntObj(itp, pool->frees),
+        };
+        Jim_SetResult(itp, Jim_NewDictObj(itp, elems, 12));
+        return JIM_OK;
+    }
+    }
+    return JIM_ERR;
+}
+
+// creates a block pool command with the given name, for blocks of at least blockSize bytes.
+// count blocks are allocated up front, and each time the pool grows.  pointers handed out are
+// tagged with typeName, if given.
+//   createBlockPool poolCmdName blockSize count ?typeName?
+int createBlockPool(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    enum {
+        cmdIX = 0,
+        poolCmdNameIX,
+        blockSizeIX,
+        countIX,
+        typeNameIX,
+        argCount
+    };
+
+    if (objc < typeNameIX || objc > argCount) {
+        Jim_SetResultString(itp, "Wrong # args.  Should be: createBlockPool poolCmdName blockSize count ?typeName?", -1);
+        return JIM_ERR;
+    }
+    jim_wide size = 0, count = 0;
+    if (Jim_GetWide(itp, objv[blockSizeIX], &size) != JIM_OK || size < 1 || size > INT32_MAX) {
+        Jim_SetResultString(itp, "Expected block size as a positive integer.", -1);
+        return JIM_ERR;
+    }
+    if (Jim_GetWide(itp, objv[countIX], &count) != JIM_OK || count < 1 || count > INT32_MAX) {
+        Jim_SetResultString(itp, "Expected block count as a positive integer.", -1);
+        return JIM_ERR;
+    }
+
+    blockPoolT* pool = Jim_Alloc(sizeof(blockPoolT));
+    memset(pool, 0, sizeof(blockPoolT));
+    pool->blockSize = ((size_t)size + POOL_ALIGN - 1) & ~(size_t)(POOL_ALIGN - 1);
+    pool->perSlab = (int)count;
+    pool->typeID = objc > typeNameIX  ?  internPointerType(itp, Jim_String(objv[typeNameIX]))  :  0;
+    if (growBlockPool(itp, pool) != JIM_OK) {
+        deleteBlockPool(itp, pool);
+        return JIM_ERR;
+    }
+    if (Jim_CreateCommand(itp, Jim_String(objv[poolCmdNameIX]), blockPoolCmd, pool, deleteBlockPool) != JIM_OK) {
+        deleteBlockPool(itp, pool);
+        return JIM_ERR;
+    }
+    Jim_SetResult(itp, objv[poolCmdNameIX]);
+    return JIM_OK;
+}
+
+// a pack cursor owns a growable buffer and a write position, for building a record
+// field by field.  its capacity doubles as needed, so appending n fields costs O(n) overall.
+// any existing packer can append into it: the cursor passes its token object as the
+// packer's packVarName.  packerSetup_byVal and createBufferVar recognize that exact object,
+// and return space at the cursor instead of in a variable.  that covers the native packers
+// and the generated struct packers.  any other packer writes the token's variable instead,
+// and then the cursor copies those bytes in.
+typedef struct {
+    u8* buf; // from Jim_Alloc.  1 byte longer than cap, for a null terminator.
+    int len; // length of content so far.  also the write position.
+    int cap;
+    int base; // position where the current put began.  packer offsets are relative to this.
+    int claimed; // nonzero after a packer has written directly into the current put.
+    Jim_Obj* token; // packVarName given to packers.  also names the scratch variable for script packers.
+} packCursorT;
+
+// each interpreter's assoc data tracks the cursor whose put is now running there, if any.
+// nActivePuts counts the puts running on this thread, so a packer can skip the lookup
+// when there are none.
+#define ACTIVE_CURSOR_KEY "dlrActiveCursor"
+static _Thread_local int nActivePuts = 0;
+
+typedef struct {
+    packCursorT* cursor; // or NULL if none.
+} activeCursorT;
+
+static void deleteActiveCursor(Jim_Interp* itp, void* data) {
+    Jim_Free(data);
+}
+
+static activeCursorT* getActiveCursorSlot(Jim_Interp* itp) {
+    activeCursorT* a = (activeCursorT*)Jim_GetAssocData(itp, ACTIVE_CURSOR_KEY);
+    if (a != NULL) return a;
+    a = Jim_Alloc(sizeof(activeCursorT));
+    a->cursor = NULL;
+    Jim_SetAssocData(itp, ACTIVE_CURSOR_KEY, deleteActiveCursor, a);
+    return a;
+}
+
+// returns the cursor whose put is now running in the interpreter, if any.
+static packCursorT* activeCursor(Jim_Interp* itp) {
+    if (nActivePuts == 0) return NULL;
+    activeCursorT* a = (activeCursorT*)Jim_GetAssocData(itp, ACTIVE_CURSOR_KEY);
+    return a == NULL  ?  NULL  :  a->cursor;
+}
+
+// ensures the cursor's buffer can hold at least the given length.  any new space is zeroed,
+// so alignment gaps and unwritten padding come out zero.
+int cursorReserve(Jim_Interp* itp, packCursorT* c, jim_wide end) {
+    if (end <= c->cap) return JIM_OK;
+    if (end > INT32_MAX / 2) {
+        Jim_SetResultString(itp, "Pack cursor is too large.", -1);
+        return JIM_ERR;
+    }
+    int cap = c->cap < 64 ? 64 : c->cap;
+    while (cap < end) cap *= 2;
+    u8* buf = Jim_Realloc(c->buf, cap + 1);
+    if (buf == NULL) {
+        Jim_SetResultString(itp, "Out of memory while growing pack cursor.", -1);
+        return JIM_ERR;
+    }
+    memset(buf + c->cap, 0, cap + 1 - c->cap);
+    c->buf = buf;
+    c->cap = cap;
+    return JIM_OK;
+}
+
+// called by packerSetup_byVal and createBufferVar when given the active cursor's token.
+// returns space for sizeBytes at offset from the start of the current put.
+int cursorClaim(Jim_Interp* itp, packCursorT* c, jim_wide offset, int sizeBytes, void** bufP) {
+    jim_wide end = c->base + offset + sizeBytes;
+    if (cursorReserve(itp, c, end) != JIM_OK) return JIM_ERR;
+    if (end > c->len) c->len = (int)end;
+    c->claimed = 1;
+    *bufP = (void*)(c->buf + c->base + offset);
+    return JIM_OK;
+}
+
+// hands off the cursor's content, and leaves the cursor empty and ready for reuse.
+// the returned block is from Jim_Alloc, with a null terminator after len bytes.
+u8* cursorDetach(Jim_Interp* itp, packCursorT* c, int* lenP) {
+    if (c->buf == NULL && cursorReserve(itp, c, 1) != JIM_OK) return NULL;
+    u8* buf = c->buf;
+    buf[c->len] = 0;
+    *lenP = c->len;
+    c->buf = NULL;
+    c->len = c->cap = 0;
+    return buf;
+}
+
+void deletePackCursor(Jim_Interp* itp, void* privData) {
+    packCursorT* c = (packCursorT*)privData;
+    activeCursorT* a = (activeCursorT*)Jim_GetAssocData(itp, ACTIVE_CURSOR_KEY);
+    if (a != NULL && a->cursor == c) a->cursor = NULL;
+    Jim_DecrRefCount(itp, c->token);
+    Jim_Free(c->buf);
+    Jim_Free(c);
+}
+
+// implements each pack cursor's command.  subcommands:
+//   put packerCmd unpackedData ?offset?   runs the packer, appending at the write position.
+//                                         the result is the position of the new field.
+//   putBytes packedValue                  appends bytes already packed.
+//   align n                               pads with zeros up to a multiple of n.
+//   position                              returns the write position.
+//   bytes                                 returns the content as a script value, without a copy.
+//                                         the cursor becomes empty.
+//   heap                                  returns the content as a heap pointer, without a copy.
+//                                         the cursor becomes empty.  release it with freeHeap.
+int packCursorCmd(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    enum {
+        cmdIX = 0,
+        subCmdIX,
+        argsIX
+    };
+    static const char * const subCmds[] = {"put", "putBytes", "align", "position", "bytes", "heap", NULL};
+    enum { SC_PUT, SC_PUT_BYTES, SC_ALIGN, SC_POSITION, SC_BYTES, SC_HEAP };
+
+    packCursorT* c = (packCursorT*)Jim_CmdPrivData(itp);
+    if (objc < argsIX) {
+        Jim_WrongNumArgs(itp, 1, objv, "subcommand ?arg ...?");
+        return JIM_ERR;
+    }
+    int sc;
+    if (Jim_GetEnum(itp, objv[subCmdIX], subCmds, &sc, "subcommand", JIM_ERRMSG) != JIM_OK)
+        return JIM_ERR;
+
+    switch (sc) {
+    case SC_PUT: {
+        if (objc < argsIX + 2 || objc > argsIX + 3) {
+            Jim_WrongNumArgs(itp, 2, objv, "packerCmd unpackedData ?offset?");
+            return JIM_ERR;
+        }
+        // the packer is invoked as:  packerCmd token unpackedData ?offset?
+        Jim_Obj* callv[4] = {objv[argsIX], c->token, objv[argsIX + 1], objc > argsIX + 2 ? objv[argsIX + 2] : NULL};
+        int savedBase = c->base, savedClaimed = c->claimed;
+        activeCursorT* a = getActiveCursorSlot(itp);
+        packCursorT* savedActive = a->cursor;
+        int pos = c->len;
+        c->base = pos;
+        c->claimed = 0;
+        a->cursor = c;
+        nActivePuts++;
+        int ret = Jim_EvalObjVector(itp, objc > argsIX + 2 ? 4 : 3, callv);
+        nActivePuts--;
+        a->cursor = savedActive;
+        int claimed = c->claimed;
+        c->base = savedBase;
+        c->claimed = savedClaimed;
+        if (ret != JIM_OK) {
+            // roll back any space the failed packer claimed, so the cursor is as it was.
+            // the space is zeroed again, as later padding relies on that.
+            if (c->len > pos) memset(c->buf + pos, 0, c->len - pos);
+            c->len = pos;
+            Jim_UnsetVariable(itp, c->token, JIM_NONE);
+            return ret;
+        }
+        if ( ! claimed) {
+            // a script packer wrote the scratch variable.  copy its bytes in.
+            Jim_Obj* v = Jim_GetVariable(itp, c->token, JIM_NONE);
+            if (v == NULL) {
+                Jim_SetResultFormatted(itp, "Packer did not pack into the cursor: %#s", objv[argsIX]);
+                return JIM_ERR;
+            }
+            int vLen = 0;
+            const char* vBytes = Jim_GetString(v, &vLen);
+            if (cursorReserve(itp, c, (jim_wide)pos + vLen) != JIM_OK) {
+                Jim_UnsetVariable(itp, c->token, JIM_NONE);
+                return JIM_ERR;
+            }
+            memcpy(c->buf + pos, vBytes, vLen);
+            if (pos + vLen > c->len) c->len = pos + vLen;
+            Jim_UnsetVariable(itp, c->token, JIM_NONE);
+        }
+        Jim_SetResultInt(itp, pos);
+        return JIM_OK;
+    }
+    case SC_PUT_BYTES: {
+        if (objc != argsIX + 1) {
+            Jim_WrongNumArgs(itp, 2, objv, "packedValue");
+            return JIM_ERR;
+        }
+        int vLen = 0;
+        const u8* vBytes = bufferBytes(objv[argsIX], &vLen);
+        int pos = c->len;
+        if (cursorReserve(itp, c, (jim_wide)pos + vLen) != JIM_OK) return JIM_ERR;
+        memcpy(c->buf + pos, vBytes, vLen);
+        c->len = pos + vLen;
+        Jim_SetResultInt(itp, pos);
+        return JIM_OK;
+    }
+    case SC_ALIGN: {
+        jim_wide n;
+        if (objc != argsIX + 1 || Jim_GetWide(itp, objv[argsIX], &n) != JIM_OK || n < 1) {
+            Jim_SetResultString(itp, "Expected alignment as a positive integer.", -1);
+            return JIM_ERR;
+        }
+        jim_wide end = (c->len + n - 1) / n * n;
+        if (cursorReserve(itp, c, end) != JIM_OK) return JIM_ERR;
+        c->len = (int)end; // the gap was zeroed when reserved.
+        Jim_SetResultInt(itp, end);
+        return JIM_OK;
+    }
+    case SC_POSITION:
+        Jim_SetResultInt(itp, c->len);
+        return JIM_OK;
+    case SC_BYTES: {
+        if (activeCursor(itp) == c) {
+            Jim_SetResultString(itp, "Cannot finalize a pack cursor during its own put.", -1);
+            return JIM_ERR;
+        }
+        int len = 0;
+        u8* buf = cursorDetach(itp, c, &len);
+        if (buf == NULL) return JIM_ERR;
+        Jim_SetResult(itp, Jim_NewStringObjNoAlloc(itp, (char*)buf, len));
+        return JIM_OK;
+    }
+    case SC_HEAP: {
+        if (activeCursor(itp) == c) {
+            Jim_SetResultString(itp, "Cannot finalize a pack cursor during its own put.", -1);
+            return JIM_ERR;
+        }
+        int len = 0;
+        u8* buf = cursorDetach(itp, c, &len);
+        if (buf == NULL) return JIM_ERR;
+        Jim_SetResult(itp, newPointerObj(itp, (void*)buf, 0));
+        return JIM_OK;
+    }
+    }
+    return JIM_ERR;
+}
+
+// creates a pack cursor command with the given name.  the cursor is freed when its command
+// is deleted (rename it to {}).  scratchVarName names the variable where script packers
+// pack each field temporarily; it's never used by native packers.
+int createPackCursor(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    enum {
+        cmdIX = 0,
+        cursorCmdNameIX,
+        scratchVarNameIX,
+        argCount
+    };
+
+    if (objc != argCount) {
+        Jim_SetResultString(itp, "Wrong # args.", -1);
+        return JIM_ERR;
+    }
+
+    packCursorT* c = Jim_Alloc(sizeof(packCursorT));
+    if (c == NULL) {
+        Jim_SetResultString(itp, "Out of memory while allocating pack cursor.", -1);
+        return JIM_ERR;
+    }
+    memset(c, 0, sizeof(packCursorT));
+    // a private copy, so no other caller can pass the same object by accident.
+    c->token = Jim_DuplicateObj(itp, objv[scratchVarNameIX]);
+    Jim_IncrRefCount(c->token);
+    if (Jim_CreateCommand(itp, Jim_String(objv[cursorCmdNameIX]), packCursorCmd, c, deletePackCursor) != JIM_OK) {
+        deletePackCursor(itp, c);
+        return JIM_ERR;
+    }
+    Jim_SetResult(itp, objv[cursorCmdNameIX]);
+    return JIM_OK;
+}
+
+// create a Jim_Obj suitable for holding a binary structure of the given length.
+// sets *newBufP to point to the structure.
+// sets *newObjP to point to the new Jim_Obj.
+int createBufferObj(Jim_Interp* itp, int len, void** newBufP, Jim_Obj** newObjP) {
+    char* buf = Jim_Alloc(len + 1); // extra 1 for null terminator is not needed for dlr, but may be needed by any further script operations on the object.
+    if (buf == NULL) {
+        Jim_SetResultString(itp, "Out of memory while allocating buffer.", -1);
+        return JIM_ERR;
+    }
+    buf[len] = 0; // last-ditch safety for any further script operations on the object.
+    *newBufP = (void*)buf;
+    *newObjP = Jim_NewStringObjNoAlloc(itp, buf, len);
+    return JIM_OK;
+}
+
+// create and set a script variable having the given name, suitable for holding a binary
+// structure of the given length.
+// if newBufP is not null, sets *newBufP to point to the structure.
+// if newObjP is not null, sets *newObjP to point to the new Jim_Obj.
+int createBufferVarNative(Jim_Interp* itp, Jim_Obj* varName, int len, void** newBufP, Jim_Obj** newObjP) {
+    void* buf = NULL;
+    Jim_Obj* valueObj = NULL;
+    if (createBufferObj(itp, len, &buf, &valueObj) != JIM_OK)
+        return JIM_ERR;
+    if (Jim_SetVariable(itp, varName, valueObj) != JIM_OK) {
+        Jim_SetResultString(itp, "Failed to set variable for buffer.", -1);
+        return JIM_ERR;
+    }
+    if (newBufP) *newBufP = (void*)buf;
+    if (newObjP) *newObjP = valueObj;
+    return JIM_OK;
+}
+
+// exposes createBufferVarNative() to script.
+int createBufferVar(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    enum {
+        cmdIX = 0,
+        varNameIX,
+        lenIX,
+        argCount
+    };
+
+    if (objc != argCount) {
+        Jim_SetResultString(itp, "Wrong # args.", -1);
+        return JIM_ERR;
+    }
+
+    jim_wide len;
+    if (Jim_GetWide(itp, objv[lenIX], &len) != JIM_OK) {
+        Jim_SetResultString(itp, "Expected size integer but got other data.", -1);
+        return JIM_ERR;
+    }
+
+    void* bufP = NULL;
+    Jim_Obj* v = NULL;
+    packCursorT* c = activeCursor(itp);
+    if (c != NULL && objv[varNameIX] == c->token) {
+        // a script packer is sizing its buffer inside a pack cursor.
+        if (cursorClaim(itp, c, 0, (int)len, &bufP) != JIM_OK)
+            return JIM_ERR;
+    } else if ((v = Jim_GetVariable(itp, objv[varNameIX], JIM_NONE)) != NULL && isNativeBuffer(v)
+        && bufferLength(v) >= len) {
+        // a native buffer that's big enough keeps its address.
+        bufP = bufferBytesForWrite(v, NULL);
+    } else if (createBufferVarNative(itp, objv[varNameIX], (int)len, &bufP, NULL) != JIM_OK)
+        return JIM_ERR;
+
+    // pass new buffer's address back to script as result of this command.
+    Jim_SetResult(itp, newPointerObj(itp, (void*)bufP, 0));
+    return JIM_OK;
+}
+
+// equivalent to [createBufferVar] followed by memcpy() to fill it.
+// this does involve making a copy, so it's OK (and often best) for the script to
+// free the pointer immediately after this.
+int copyToBufferVar(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    enum {
+        cmdIX = 0,
+        varNameIX,
+        lenIX,
+        sourcePointerIntValueIX,
+        argCount
+    };
+
+    if (objc != argCount) {
+        Jim_SetResultString(itp, "Wrong # args.", -1);
+        return JIM_ERR;
+    }
+
+    jim_wide len;
+    if (Jim_GetWide(itp, objv[lenIX], &len) != JIM_OK) {
+        Jim_SetResultString(itp, "Expected size integer but got other data.", -1);
+        return JIM_ERR;
+    }
+    if (len < 1) {
+        Jim_SetResultString(itp, "Size must be at least 1.", -1);
+        return JIM_ERR;
+    }
+
+    void* srcP = NULL;
+    if (getPointer(itp, objv[sourcePointerIntValueIX], &srcP) != JIM_OK) {
+        Jim_SetResultString(itp, "Expected source pointer integer but got other data.", -1);
+        return JIM_ERR;
+    }
+    if (srcP == NULL) {
+        Jim_SetResultString(itp, "Source pointer must not be null.", -1);
+        return JIM_ERR;
+    }
+
+    void* bufP = NULL;
+    if (createBufferVarNative(itp, objv[varNameIX], (int)len, &bufP, NULL) != JIM_OK)
+        return JIM_ERR;
+    memcpy(bufP, srcP, (size_t)len);
+
+    // pass new buffer's address back to script as result of this command.
+    Jim_SetResult(itp, newPointerObj(itp, (void*)bufP, 0));
+    return JIM_OK;
+}
+
+int varToTypeP(Jim_Interp* itp, Jim_Obj *var, ffi_type** typ) {
+    Jim_Obj* typeObj = Jim_GetVariable(itp, var, JIM_ERRMSG);
+    if (typeObj == NULL) return JIM_ERR;
+    jim_wide code = 0;
+    if (Jim_GetWide(itp, typeObj, &code) == JIM_OK) {
+        // found integer.  valid type code?
+        if (code < 0 || code > FFI_TYPE_FINAL || ffiTypes[code] == NULL) {
+            Jim_SetResultString(itp, "Invalid type ID code integer.", -1);
+            return JIM_ERR;
+        }
+        *typ = ffiTypes[code];
+        return JIM_OK;
+    }
+    *typ = (ffi_type*)Jim_GetString(typeObj, NULL);
+    if (*typ == NULL || typeObj->length < sizeof(ffi_type)) {
+        Jim_SetResultString(itp, "Structure type metadata variable is unusable.", -1);
+        return JIM_ERR;
+    }
+    return JIM_OK;
+}
+
+// each interpreter's assoc data holds a dict of the member tables referenced by struct codecs,
+// keyed by the struct type variable name.  that keeps each table alive as long as its type blob.
+#define CODEC_TABLES_KEY "dlrCodecTables"
+
+static void deleteCodecTables(Jim_Interp* itp, void* data) {
+    Jim_DecrRefCount(itp, (Jim_Obj*)data);
+}
+
+// keeps the member table alive for the struct type blob in the given variable.  any table held
+// for an earlier blob in that variable is released.
+static void holdMemberTable(Jim_Interp* itp, Jim_Obj* structTypeVarName, Jim_Obj* table) {
+    Jim_Obj* tables = (Jim_Obj*)Jim_GetAssocData(itp, CODEC_TABLES_KEY);
+    if (tables == NULL) {
+        tables = Jim_NewDictObj(itp, NULL, 0);
+        Jim_IncrRefCount(tables);
+        Jim_SetAssocData(itp, CODEC_TABLES_KEY, deleteCodecTables, tables);
+    }
+    Jim_DictAddElement(itp, tables, structTypeVarName, table);
+}
+
+//todo: test with nested structs.
+int prepStructType(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    enum {
+        cmdIX = 0,
+        structTypeVarNameIX,
+        memberTypeVarNameListIX,
+        memberTableIX,
+        sizeIX,
+        argCount
+    };
+
+    if (objc != argCount && objc != memberTableIX) {
+        Jim_SetResultString(itp, "Wrong # args.", -1);
+        return JIM_ERR;
+    }
+
+    // create buffer variable for type blob.  first we must determine its final size from the number of its members.
+    Jim_Obj* typesList = objv[memberTypeVarNameListIX];
+    int nMemb = Jim_ListLength(itp, typesList);
+    int blobLen = sizeof(ffi_type) + (nMemb + 1) * sizeof(ffi_type*);
+    Jim_Obj* table = objc > memberTableIX  ?  objv[memberTableIX]  :  NULL;
+    if (table != NULL) {
+        if (Jim_ListLength(itp, table) != nMemb * MT_STRIDE) {
+            Jim_SetResultString(itp, "Member table length doesn't match the members.", -1);
+            return JIM_ERR;
+        }
+        blobLen += sizeof(structCodecT) + nMemb * sizeof(structMemberT);
+    }
+    ffi_type* structTyp;
+    if (createBufferVarNative(itp, objv[structTypeVarNameIX], blobLen, (void**)&structTyp, NULL) != JIM_OK) return JIM_ERR;
+    structTyp->type = FFI_TYPE_STRUCT;
+    structTyp->size = 0;
+    structTyp->alignment = 0;
+
+    // gather members types.
+    structTyp->elements = (ffi_type**)(structTyp + 1); // now structTyp->elements can be treated as the types array at the end of the struct.
+    for (int n = 0; n < nMemb; n++) {
+        if (varToTypeP(itp, Jim_ListGetIndex(itp, typesList, n), &structTyp->elements[n]) != JIM_OK) {
+            Jim_SetResultString(itp, "Variable defining a member type is unusable.", -1);
+            return JIM_ERR;
+        }
+    }
+    structTyp->elements[nMemb] = NULL; // terminating NULL element is required by FFI.
+
+    // build the codec's member table.  it lies directly beyond the elements array.
+    if (table != NULL) {
+        structCodecT* codec = (structCodecT*)&structTyp->elements[nMemb + 1];
+        *(u32*)codec->signature = *(u32*)CODEC_SIGNATURE;
+        codec->signature[4] = 0;
+        codec->nMembers = nMemb;
+        codec->memberTable = table;
+        jim_wide size = 0;
+        if (Jim_GetWide(itp, objv[sizeIX], &size) != JIM_OK || size <= 0) {
+            Jim_SetResultString(itp, "Expected struct size integer but got other data.", -1);
+            return JIM_ERR;
+        }
+        codec->size = (int)size;
+        for (int n = 0; n < nMemb; n++) {
+            jim_wide typeCode = 0;
+            jim_wide offset = 0;
+            if (Jim_GetWide(itp, Jim_ListGetIndex(itp, table, n * MT_STRIDE + MT_typeCodeIX), &typeCode) != JIM_OK
+                || Jim_GetWide(itp, Jim_ListGetIndex(itp, table, n * MT_STRIDE + MT_offsetIX), &offset) != JIM_OK
+                || typeCode < 0 || typeCode > FFI_TYPE_FINAL || ffiTypes[typeCode] == NULL
+                || offset < 0 || offset + (jim_wide)ffiTypes[typeCode]->size > size) {
+                Jim_SetResultString(itp, "Member table is unusable.", -1);
+                return JIM_ERR;
+            }
+            codec->members[n].offset = (u32)offset;
+            codec->members[n].typeCode = (u8)typeCode;
+        }
+        holdMemberTable(itp, objv[structTypeVarNameIX], table);
+    }
+
+    return JIM_OK;
+}
+
+// returns the codec held in the given struct type blob variable, or NULL with an error message.
+structCodecT* varToCodec(Jim_Interp* itp, Jim_Obj* structTypeVarName) {
+    Jim_Obj* v = Jim_GetVariable(itp, structTypeVarName, JIM_NONE);
+    if (v == NULL || v->bytes == NULL || (size_t)v->length < sizeof(ffi_type)) {
+        Jim_SetResultFormatted(itp, "Struct type variable not found: %#s", structTypeVarName);
+        return NULL;
+    }
+    ffi_type* structTyp = (ffi_type*)v->bytes;
+    ffi_type** e = (ffi_type**)(structTyp + 1);
+    while ((u8*)e < (u8*)v->bytes + v->length && *e != NULL) e++;
+    structCodecT* codec = (structCodecT*)(e + 1);
+    if ((u8*)codec + sizeof(structCodecT) > (u8*)v->bytes + v->length
+        || *(u32*)codec->signature != *(u32*)CODEC_SIGNATURE) {
+        Jim_SetResultFormatted(itp, "Struct type has no member table: %#s", structTypeVarName);
+        return NULL;
+    }
+    return codec;
+}
+
+// returns the trampoline suiting the given signature, or NULL if there is none.
+trampolineT selectTrampoline(ffi_cif* cif) {
+#ifdef DLR_TRAMPOLINES
+    unsigned nInts = 0;
+    unsigned nDoubles = 0;
+    for (unsigned n = 0; n < cif->nargs; n++) {
+        switch (cif->arg_types[n]->type) {
+            case FFI_TYPE_UINT8: case FFI_TYPE_UINT16: case FFI_TYPE_UINT32: case FFI_TYPE_UINT64:
+            case FFI_TYPE_SINT8: case FFI_TYPE_SINT16: case FFI_TYPE_SINT32: case FFI_TYPE_SINT64:
+            case FFI_TYPE_POINTER:
+                nInts++;
+                break;
+            case FFI_TYPE_DOUBLE:
+                nDoubles++;
+                break;
+            default:
+                // float, long double, and structs have their own rules.  libffi handles those.
+                return NULL;
+        }
+    }
+    if (nInts > TRAMP_MAX_INTS || nDoubles > TRAMP_MAX_DOUBLES) return NULL;
+
+    switch (cif->rtype->type) {
+        case FFI_TYPE_VOID:
+        case FFI_TYPE_UINT8: case FFI_TYPE_UINT16: case FFI_TYPE_UINT32: case FFI_TYPE_UINT64:
+        case FFI_TYPE_SINT8: case FFI_TYPE_SINT16: case FFI_TYPE_SINT32: case FFI_TYPE_SINT64:
+        case FFI_TYPE_POINTER:
+            return trampolines[nDoubles][nInts][0];
+        case FFI_TYPE_DOUBLE:
+            return trampolines[nDoubles][nInts][1];
+    }
+#endif
+    return NULL;
+}
+
+// functions sharing one signature share one prepared ffi_cif, and its type array.  big libs
+// such as GTK+ have thousands of functions, but far fewer distinct signatures, so that saves
+// most of the ffi_prep_cif() work and CIF memory at startup, and keeps the CIFs of common
+// signatures in cache.  each interpreter has its own signature table, created on first use.
+// only signatures made entirely of simple types are shared.  a struct type is a script buffer
+// that can be prepared again at another address, so a metaBlob using one keeps a private CIF.
+// a metaBlob is a plain script value with no destructor, so nothing can tell when the last
+// metaBlob using a signature is gone.  entries live as long as the interpreter.  refCount
+// counts the metaBlobs prepared with each one, for diagnostics.
+#define SIGNATURE_TABLE_KEY "dlrSignatures"
+#define SIGNATURE_MIN_BUCKETS 64
+
+typedef struct signatureT {
+    struct signatureT* next; // next entry in the same bucket, or NULL.
+    u32 hash;
+    unsigned refCount;
+    ffi_cif cif;
+    ffi_type* atypes[]; // cif.nargs elements.  cif.arg_types points here.
+} signatureT;
+
+typedef struct {
+    signatureT** buckets;
+    unsigned nBuckets; // always a power of 2.
+    unsigned nEntries;
+} signatureTableT;
+
+void deleteSignatureTable(Jim_Interp* itp, void* data) {
+    signatureTableT* tbl = (signatureTableT*)data;
+    for (unsigned b = 0; b < tbl->nBuckets; b++) {
+        signatureT* sig = tbl->buckets[b];
+        while (sig != NULL) {
+            signatureT* next = sig->next;
+            Jim_Free(sig);
+            sig = next;
+        }
+    }
+    Jim_Free(tbl->buckets);
+    Jim_Free(tbl);
+}
+
+// returns the interpreter's signature table, creating it if needed.
+signatureTableT* getSignatureTable(Jim_Interp* itp) {
+    signatureTableT* tbl = (signatureTableT*)Jim_GetAssocData(itp, SIGNATURE_TABLE_KEY);
+    if (tbl != NULL) return tbl;
+    tbl = Jim_Alloc(sizeof(signatureTableT));
+    tbl->nBuckets = SIGNATURE_MIN_BUCKETS;
+    tbl->buckets = Jim_Alloc(tbl->nBuckets * sizeof(signatureT*));
+    memset(tbl->buckets, 0, tbl->nBuckets * sizeof(signatureT*));
+    tbl->nEntries = 0;
+    Jim_SetAssocData(itp, SIGNATURE_TABLE_KEY, deleteSignatureTable, tbl);
+    return tbl;
+}
+
+// FNV-1a over the type codes.  distinct simple types can share a code, such as sint64 and
+// pointer on some machines, so entries are still compared by their type pointers.
+u32 signatureHash(ffi_type* rtype, unsigned nArgs, ffi_type** atypes) {
+    u32 h = 2166136261u;
+    h = (h ^ rtype->type) * 16777619u;
+    h = (h ^ nArgs) * 16777619u;
+    for (unsigned n = 0; n < nArgs; n++)
+        h = (h ^ atypes[n]->type) * 16777619u;
+    return h;
+}
+
+// returns nonzero if the given signature can be shared.
+int isSharedSignature(ffi_type* rtype, unsigned nArgs, ffi_type** atypes) {
+    if (rtype->type == FFI_TYPE_STRUCT) return 0;
+    for (unsigned n = 0; n < nArgs; n++)
+        if (atypes[n]->type == FFI_TYPE_STRUCT) return 0;
+    return 1;
+}
+
+// returns the shared signature of the given simple types, preparing its CIF if it's new,
+// and counts one more reference to it.  returns NULL if ffi_prep_cif() fails.
+signatureT* internSignature(Jim_Interp* itp, ffi_type* rtype, unsigned nArgs, ffi_type** atypes) {
+    signatureTableT* tbl = getSignatureTable(itp);
+    u32 hash = signatureHash(rtype, nArgs, atypes);
+    for (signatureT* sig = tbl->buckets[hash & (tbl->nBuckets - 1)]; sig != NULL; sig = sig->next) {
+        if (sig->hash == hash && sig->cif.rtype == rtype && sig->cif.nargs == nArgs
+            && (nArgs == 0 || memcmp(sig->atypes, atypes, nArgs * sizeof(ffi_type*)) == 0)) {
+            sig->refCount++;
+            return sig;
+        }
+    }
+
+    signatureT* sig = Jim_Alloc(sizeof(signatureT) + nArgs * sizeof(ffi_type*));
+    if (nArgs > 0) memcpy(sig->atypes, atypes, nArgs * sizeof(ffi_type*));
+    if (ffi_prep_cif(&sig->cif, FFI_DEFAULT_ABI, nArgs, rtype, sig->atypes) != FFI_OK) {
+        Jim_Free(sig);
+        return NULL;
+    }
+    sig->hash = hash;
+    sig->refCount = 1;
+
+    // keep the chains short.  double the buckets when the entries outnumber them.
+    if (tbl->nEntries >= tbl->nBuckets) {
+        unsigned nBuckets = tbl->nBuckets * 2;
+        signatureT** buckets = Jim_Alloc(nBuckets * sizeof(signatureT*));
+        memset(buckets, 0, nBuckets * sizeof(signatureT*));
+        for (unsigned b = 0; b < tbl->nBuckets; b++) {
+            signatureT* s = tbl->buckets[b];
+            while (s != NULL) {
+                signatureT* next = s->next;
+                s->next = buckets[s->hash & (nBuckets - 1)];
+                buckets[s->hash & (nBuckets - 1)] = s;
+                s = next;
+            }
+        }
+        Jim_Free(tbl->buckets);
+        tbl->buckets = buckets;
+        tbl->nBuckets = nBuckets;
+    }
+    signatureT** bucket = &tbl->buckets[hash & (tbl->nBuckets - 1)];
+    sig->next = *bucket;
+    *bucket = sig;
+    tbl->nEntries++;
+    return sig;
+}
+
+// returns a list of the number of shared signatures, and the number of metaBlobs sharing them.
+// this is for diagnostics and tests.
+//   signatureStats
+int signatureStats(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    if (objc != 1) {
+        Jim_SetResultString(itp, "Wrong # args.  Should be: signatureStats", -1);
+        return JIM_ERR;
+    }
+    signatureTableT* tbl = getSignatureTable(itp);
+    jim_wide refs = 0;
+    for (unsigned b = 0; b < tbl->nBuckets; b++)
+        for (signatureT* sig = tbl->buckets[b]; sig != NULL; sig = sig->next)
+            refs += sig->refCount;
+    Jim_Obj* elems[] = {Jim_NewIntObj(itp, tbl->nEntries), Jim_NewIntObj(itp, refs)};
+    Jim_SetResult(itp, Jim_NewListObj(itp, elems, 2));
+    return JIM_OK;
+}
+
+// prepMetaBlob builds or updates a metadata binary structure, storing it in the given variable.
+// it makes all preparations necessary for a series of callToNative for one native function.
+// after any of the metadata passed into prepMetaBlob has been touched by script,
+// script must call prepMetaBlob again to update the metaBlob.
+// failure to do that will probably crash the interp, or corrupt it.
+// (the contents of the native parameter variables themselves are not subject to that,
+// since those are not passed to prepMetaBlob.
+// instead their contents are assumed to be different for each callToNative.)
+// likewise, failure to prepMetaBlob before the first callToNative will probably
+// crash the interp, or corrupt it.
+// prepMetaBlob mainly converts type codes to type pointers, so it can call ffi_prep_cif.
+// metaBlobs whose types are all simple share one prepared CIF per signature.  see internSignature().
+// if the optional returnUnpack boolean is true, and the function returns a scalar
+// (integer, float, or pointer), callToNative will pass back the return value already
+// unpacked to a script integer or double, instead of a packed native buffer.
+// the optional plan is a marshaling plan list, for use by a planned call command.
+// like nativeParmsList, script must keep the plan list alive as long as the metaBlob.
+int prepMetaBlob(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    enum {
+        cmdIX = 0,
+        metaBlobVarNameIX,
+        fnPIX,
+        returnTypeVarNameIX,
+        nativeParmsListIX,
+        parmTypeVarNameListIX,
+        parmFlagsListIX,
+        returnUnpackIX,
+        planIX,
+        trampolineIX,
+        errorPolicyIX,
+        returnTargetTypeIX,
+        argCount
+    };
+
+    if (objc < returnUnpackIX || objc > argCount) {
+        Jim_SetResultString(itp, "Wrong # args.", -1);
+        return JIM_ERR;
+    }
+
+    Jim_Obj* flagsList = objv[parmFlagsListIX];
+    int isGIcall = Jim_ListLength(itp, flagsList) > 0;
+
+    // create buffer variable for metablob.  first we must determine its final size.
+    int nArgs = Jim_ListLength(itp, objv[nativeParmsListIX]);
+    Jim_Obj* planList = objc > planIX && Jim_ListLength(itp, objv[planIX]) > 0  ?  objv[planIX]  :  NULL;
+    if (planList != NULL && Jim_ListLength(itp, planList) != (nArgs + 1) * PLAN_STRIDE) {
+        Jim_SetResultString(itp, "Marshaling plan length doesn't match the parms.", -1);
+        return JIM_ERR;
+    }
+    // memorize function pointer.
+    jim_wide fnP = 0;
+    if (Jim_GetWide(itp, objv[fnPIX], &fnP) != JIM_OK) {
+        Jim_SetResultString(itp, "Expected function pointer but got other data.", -1);
+        return JIM_ERR;
+    }
+    if (fnP == 0) {
+        Jim_SetResultString(itp, "Null function pointer.", -1);
+        return JIM_ERR;
+    }
+
+    // gather return-value metadata.
+    ffi_type* rtype = NULL;
+    if (varToTypeP(itp, objv[returnTypeVarNameIX], &rtype) != JIM_OK) return JIM_ERR;
+
+    // gather parm types, then find their shared signature, if they have one.
+    Jim_Obj* typesList = objv[parmTypeVarNameListIX];
+    if (nArgs != Jim_ListLength(itp, typesList)) {
+        Jim_SetResultString(itp, "List lengths don't match.", -1);
+        return JIM_ERR;
+    }
+    if (isGIcall && nArgs != Jim_ListLength(itp, flagsList)) {
+        Jim_SetResultString(itp, "List lengths don't match.", -1);
+        return JIM_ERR;
+    }
+    ffi_type** t = Jim_Alloc((nArgs + 1) * sizeof(ffi_type*)); // +1 avoids a zero-length allocation.
+    for (int n = 0; n < nArgs; n++) {
+        Jim_Obj* typeVar = Jim_ListGetIndex(itp, typesList, n);
+        if (varToTypeP(itp, typeVar, &t[n]) != JIM_OK) {
+            Jim_Free(t);
+            return JIM_ERR;
+        }
+    }
+    signatureT* sig = NULL;
+    if (isSharedSignature(rtype, (unsigned)nArgs, t)) {
+        sig = internSignature(itp, rtype, (unsigned)nArgs, t);
+        if (sig == NULL) {
+            Jim_Free(t);
+            Jim_SetResultString(itp, "Failed to prep FFI CIF structure for call.", -1);
+            return JIM_ERR;
+        }
+    }
+
+    // create buffer variable for metablob.  first we must determine its final size.
+    // a signature that can't be shared is kept privately, directly beyond the structure.
+    int privateLen = sig == NULL  ?  sizeof(signatureT) + nArgs * sizeof(ffi_type*)  :  0;
+    int blobLen = sizeof(metaBlobT) + privateLen + nArgs * sizeof(dlrFlagsT);
+    if (planList != NULL)
+        blobLen += (nArgs + 1) * sizeof(planStepT);
+    metaBlobT* meta;
+    if (createBufferVarNative(itp, objv[metaBlobVarNameIX], blobLen, (void**)&meta, NULL) != JIM_OK) {
+        Jim_Free(t);
+        return JIM_ERR;
+    }
+    memset(meta, 0, sizeof(metaBlobT)); // initialize to zeros because this structure now has optional parts e.g. for gizmo.
+    *(u32*)meta->signature = *(u32*)METABLOB_SIGNATURE;
+    meta->signature[4] = 0; // string safety.
+    meta->nativeParmsList = objv[nativeParmsListIX];
+    if (sig == NULL) {
+        // prep private CIF.
+        // this will also set the .size of any structure types used here.
+        sig = (signatureT*)((u8*)meta + sizeof(metaBlobT));
+        sig->next = NULL;
+        sig->hash = 0;
+        sig->refCount = 1;
+        if (nArgs > 0) memcpy(sig->atypes, t, nArgs * sizeof(ffi_type*));
+        ffi_status err = ffi_prep_cif(&sig->cif, FFI_DEFAULT_ABI, (unsigned int)nArgs, rtype, sig->atypes);
+        if (err != FFI_OK) {
+            Jim_Free(t);
+            Jim_SetResultString(itp, "Failed to prep FFI CIF structure for call.", -1);
+            return JIM_ERR;
+        }
+    }
+    Jim_Free(t);
+    meta->cif = &sig->cif;
+
+#ifdef BUILD_GIZMO
+    if (isGIcall) {
+        meta->giInfo = (GIFunctionInfo*)fnP;
+        meta->aFlags = (dlrFlagsT*)((u8*)meta + sizeof(metaBlobT) + privateLen); // aflags array lies directly beyond the private signature, if any.
+        meta->nInArgs = 0;
+        meta->nOutArgs = 0;
+        for (int n = 0; n < nArgs; n++) {
+            jim_wide flags;
+            if (Jim_GetWide(itp, Jim_ListGetIndex(itp, flagsList, n), &flags) != JIM_OK) {
+                Jim_SetResultString(itp, "Expected parm flags integer but got other data.", -1);
+                return JIM_ERR;
+            }
+            meta->aFlags[n] = (dlrFlagsT)flags;
+            if (flags & DF_DIR_IN) meta->nInArgs++;
+            if (flags & DF_DIR_OUT) meta->nOutArgs++;
+        }
+    } else {
+        meta->fn = (ffiFnP)fnP;
+    }
+//todo: unref when this metablob destroyed.
+//    g_base_info_unref (base_info);
+// and the repo as well?
+#else
+    meta->fn = (ffiFnP)fnP;
+#endif
+
+    if (rtype == &ffi_type_void) {
+        meta->returnSizePadded = 0;
+    } else {
+        // calculate padding of return value AFTER ffi_prep_cif(), since that's where
+        // rtype->size is computed if rtype is a struct type.
+        meta->returnSizePadded = rtype->size;
+        // FFI requires padding the return variable up to sizeof(ffi_arg).
+        if (meta->returnSizePadded < sizeof(ffi_arg))
+            meta->returnSizePadded = sizeof(ffi_arg);
+    }
+
+    // choose how callToNative will pass back the return value.
+    int returnUnpack = 0;
+    if (objc > returnUnpackIX) {
+        if (Jim_GetBoolean(itp, objv[returnUnpackIX], &returnUnpack) != JIM_OK) {
+            Jim_SetResultString(itp, "Expected returnUnpack boolean but got other data.", -1);
+            return JIM_ERR;
+        }
+    }
+    // compile marshaling plan.
+    if (planList != NULL) {
+        meta->planList = planList;
+        meta->plan = (planStepT*)((u8*)meta + sizeof(metaBlobT) + privateLen + nArgs * sizeof(dlrFlagsT)); // plan lies directly beyond the aFlags array.
+        for (int n = 0; n <= nArgs; n++) {
+            Jim_Obj** stepList = &planList->internalRep.listValue.ele[n * PLAN_STRIDE];
+            planStepT* step = &meta->plan[n];
+            jim_wide dir = 0;
+            jim_wide typeCode = 0;
+            int passMethod = 0;
+            int kind = 0;
+            if (Jim_GetWide(itp, stepList[PL_dirIX], &dir) != JIM_OK
+                || Jim_GetEnum(itp, stepList[PL_passMethodIX], passMethodNames, &passMethod, "passMethod", JIM_ERRMSG) != JIM_OK
+                || Jim_GetEnum(itp, stepList[PL_kindIX], planKindNames, &kind, "plan kind", JIM_ERRMSG) != JIM_OK
+                || Jim_GetWide(itp, stepList[PL_typeCodeIX], &typeCode) != JIM_OK) {
+                Jim_SetResultString(itp, "Marshaling plan step is unusable.", -1);
+                return JIM_ERR;
+            }
+            if (typeCode < 0 || typeCode > FFI_TYPE_FINAL || (kind == PK_SCALAR && ffiTypes[typeCode] == NULL)) {
+                Jim_SetResultString(itp, "Invalid type ID code integer in marshaling plan.", -1);
+                return JIM_ERR;
+            }
+            step->dir = (u8)dir;
+            step->passMethod = (u8)passMethod;
+            step->kind = (u8)kind;
+            step->typeCode = (u8)typeCode;
+            step->memFree = Jim_CompareStringImmediate(itp, stepList[PL_memActionIX], "free");
+            step->borrow = Jim_CompareStringImmediate(itp, stepList[PL_memActionIX], "borrow");
+            if (kind == PK_BYTES && ! step->borrow) {
+                Jim_SetResultString(itp, "Marshaling plan step of kind bytes must be borrowed.", -1);
+                return JIM_ERR;
+            }
+        }
+    }
+
+    meta->returnClass = RC_NATIVE;
+    meta->returnPadding = 0;
+    if (returnUnpack) {
+        switch (rtype->type) {
+            case FFI_TYPE_SINT8: case FFI_TYPE_SINT16: case FFI_TYPE_SINT32: case FFI_TYPE_SINT64:
+                meta->returnClass = RC_SIGNED;
+                break;
+            case FFI_TYPE_UINT8: case FFI_TYPE_UINT16: case FFI_TYPE_UINT32: case FFI_TYPE_UINT64:
+                meta->returnClass = RC_UNSIGNED;
+                break;
+            case FFI_TYPE_POINTER:
+                // the pointer's declared target type is interned once here, for tagging each pointer returned.
+                meta->returnClass = RC_UNSIGNED;
+                meta->returnIsPtr = 1;
+                if (objc > returnTargetTypeIX)
+                    meta->returnPtrType = internPointerType(itp, Jim_String(objv[returnTargetTypeIX]));
+                break;
+            case FFI_TYPE_FLOAT: case FFI_TYPE_DOUBLE: case FFI_TYPE_LONGDOUBLE:
+                meta->returnClass = RC_FLOAT;
+                break;
+        }
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        // libffi widens small integers to a whole ffi_arg.  on a big endian machine
+        // that puts the value at a higher address.  floats are never widened.
+        if (meta->returnClass == RC_SIGNED || meta->returnClass == RC_UNSIGNED)
+            meta->returnPadding = meta->returnSizePadded - rtype->size;
+#endif
+    }
+
+    // select a trampoline to bypass libffi, if the caller allows it.
+    int trampoline = 1;
+    if (objc > trampolineIX) {
+        if (Jim_GetBoolean(itp, objv[trampolineIX], &trampoline) != JIM_OK) {
+            Jim_SetResultString(itp, "Expected trampoline boolean but got other data.", -1);
+            return JIM_ERR;
+        }
+    }
+    meta->trampoline = NULL;
+    if (trampoline && ! isGIcall)
+        meta->trampoline = selectTrampoline(meta->cif);
+
+    // parse error policy.  it requires a return value unpacked in C, as an integer.
+    if (objc > errorPolicyIX && Jim_ListLength(itp, objv[errorPolicyIX]) > 0) {
+        Jim_Obj* policyList = objv[errorPolicyIX];
+        if (Jim_ListLength(itp, policyList) != EP_COUNT) {
+            Jim_SetResultString(itp, "Error policy list has the wrong length.", -1);
+            return JIM_ERR;
+        }
+        if (meta->returnClass != RC_SIGNED && meta->returnClass != RC_UNSIGNED) {
+            Jim_SetResultString(itp, "Error policy requires an integer or pointer return value.", -1);
+            return JIM_ERR;
+        }
+        Jim_Obj** policy = policyList->internalRep.listValue.ele;
+        int condition = 0;
+        int message = 0;
+        jim_wide errorFn = 0;
+        if (Jim_GetEnum(itp, policy[EP_conditionIX], errorConditionNames, &condition, "error condition", JIM_ERRMSG) != JIM_OK
+            || Jim_GetEnum(itp, policy[EP_messageIX], errorMessageNames, &message, "error message source", JIM_ERRMSG) != JIM_OK)
+            return JIM_ERR;
+        if (Jim_GetWide(itp, policy[EP_fnPIX], &errorFn) != JIM_OK) {
+            Jim_SetResultString(itp, "Expected error message function pointer but got other data.", -1);
+            return JIM_ERR;
+        }
+        if ((message == EM_MSGFN || message == EM_CODEMSGFN) && errorFn == 0) {
+            Jim_SetResultString(itp, "Error policy requires an error message function.", -1);
+            return JIM_ERR;
+        }
+        meta->errorCondition = (u8)condition;
+        meta->errorMessage = (u8)message;
+        meta->errorFn = (void*)errorFn;
+        meta->errorPolicyList = policyList;
+    }
+
+    return JIM_OK;
+}
+
+// executes a native call through the trampoline selected by prepMetaBlob, or else through libffi.
+// rtn and argPtrs are as for ffi_call.  a trampoline's integer return value is widened to a
+// whole ffi_arg the same way libffi does it, so the results are identical either way.
+void invokeNative(metaBlobT* meta, void* rtn, void** argPtrs) {
+#ifdef DLR_TRAMPOLINES
+    if (meta->trampoline != NULL) {
+        u64 ints[TRAMP_MAX_INTS];
+        double doubles[TRAMP_MAX_DOUBLES];
+        unsigned nInts = 0;
+        unsigned nDoubles = 0;
+        for (unsigned n = 0; n < meta->cif->nargs; n++) {
+            void* a = argPtrs[n];
+            switch (meta->cif->arg_types[n]->type) {
+                case FFI_TYPE_UINT8:    ints[nInts++] = *(u8*)a; break;
+                case FFI_TYPE_UINT16:   ints[nInts++] = *(u16*)a; break;
+                case FFI_TYPE_UINT32:   ints[nInts++] = *(u32*)a; break;
+                case FFI_TYPE_UINT64:   ints[nInts++] = *(u64*)a; break;
+                case FFI_TYPE_SINT8:    ints[nInts++] = (u64)(i64)*(i8*)a; break;
+                case FFI_TYPE_SINT16:   ints[nInts++] = (u64)(i64)*(i16*)a; break;
+                case FFI_TYPE_SINT32:   ints[nInts++] = (u64)(i64)*(i32*)a; break;
+                case FFI_TYPE_SINT64:   ints[nInts++] = (u64)*(i64*)a; break;
+                case FFI_TYPE_POINTER:  ints[nInts++] = (u64)(uintptr_t)*(void**)a; break;
+                default:                doubles[nDoubles++] = *(double*)a; break;
+            }
+        }
+
+        scalarT r;
+        meta->trampoline(meta->fn, ints, doubles, &r);
+
+        // only the low-order bits of a small integer return value are meaningful.
+        ffi_arg* arg = (ffi_arg*)rtn;
+        switch (meta->cif->rtype->type) {
+            case FFI_TYPE_VOID:     break;
+            case FFI_TYPE_UINT8:    *arg = (ffi_arg)(u8)r.arg; break;
+            case FFI_TYPE_UINT16:   *arg = (ffi_arg)(u16)r.arg; break;
+            case FFI_TYPE_UINT32:   *arg = (ffi_arg)(u32)r.arg; break;
+            case FFI_TYPE_SINT8:    *arg = (ffi_arg)(ffi_sarg)(i8)r.arg; break;
+            case FFI_TYPE_SINT16:   *arg = (ffi_arg)(ffi_sarg)(i16)r.arg; break;
+            case FFI_TYPE_SINT32:   *arg = (ffi_arg)(ffi_sarg)(i32)r.arg; break;
+            case FFI_TYPE_DOUBLE:   *(double*)rtn = r.d; break;
+            default:                *arg = r.arg; break;
+        }
+        return;
+    }
+#endif
+    ffi_call(meta->cif, meta->fn, rtn, argPtrs);
+}
+
+// returns an integer return value written by libffi, for returnClass RC_SIGNED or RC_UNSIGNED.
+jim_wide integerReturn(metaBlobT* meta, scalarT* rtn) {
+    void* at = (u8*)rtn + meta->returnPadding;
+    if (meta->returnClass == RC_SIGNED) {
+        switch (meta->cif->rtype->size) {
+            case 1: return (jim_wide) *(i8*)at;
+            case 2: return (jim_wide) *(i16*)at;
+            case 4: return (jim_wide) *(i32*)at;
+            default: return (jim_wide) *(i64*)at;
+        }
+    }
+    switch (meta->cif->rtype->size) {
+        case 1: return (jim_wide) *(u8*)at;
+        case 2: return (jim_wide) *(u16*)at;
+        case 4: return (jim_wide) *(u32*)at;
+        default: return (jim_wide) *(u64*)at;
+    }
+}
+
+// converts a scalar return value written by libffi to a new script integer, double, or pointer object.
+Jim_Obj* unpackScalarReturn(Jim_Interp* itp, metaBlobT* meta, scalarT* rtn) {
+    switch (meta->returnClass) {
+        case RC_SIGNED:
+        case RC_UNSIGNED:
+            if (meta->returnIsPtr)
+                return newPointerObj(itp, (void*)(uintptr_t)integerReturn(meta, rtn), meta->returnPtrType);
+            return Jim_NewIntObj(itp, integerReturn(meta, rtn));
+        default:
+            if (meta->cif->rtype->type == FFI_TYPE_FLOAT)
+                return Jim_NewDoubleObj(itp, (double)rtn->f);
+            if (meta->cif->rtype->type == FFI_TYPE_LONGDOUBLE)
+                return Jim_NewDoubleObj(itp, (double)rtn->ld);
+            return Jim_NewDoubleObj(itp, rtn->d);
+    }
+}
+
+// an error raised by a callback script can't propagate back through the native code that
+// called the callback.  the first one is held in the interpreter's assoc data until that
+// native code returns to dlr.  then the dlr call command raises it.  this is only touched
+// on an interpreter's thread.  nHeldCallbackErrors counts the errors held by the interpreters
+// of this thread, so every call can check for one without a lookup.
+#define CALLBACK_ERROR_KEY "dlrCallbackError"
+static _Thread_local int nHeldCallbackErrors = 0;
+
+typedef struct {
+    Jim_Obj* error; // or NULL if none is held.
+} callbackErrorT;
+
+void deleteCallbackError(Jim_Interp* itp, void* data) {
+    callbackErrorT* held = (callbackErrorT*)data;
+    if (held->error != NULL) {
+        Jim_DecrRefCount(itp, held->error);
+        nHeldCallbackErrors--;
+    }
+    Jim_Free(held);
+}
+
+void holdCallbackError(Jim_Interp* itp, Jim_Obj* msg) {
+    callbackErrorT* held = (callbackErrorT*)Jim_GetAssocData(itp, CALLBACK_ERROR_KEY);
+    if (held == NULL) {
+        held = Jim_Alloc(sizeof(callbackErrorT));
+        held->error = NULL;
+        Jim_SetAssocData(itp, CALLBACK_ERROR_KEY, deleteCallbackError, held);
+    }
+    if (held->error != NULL) return;
+    held->error = msg;
+    Jim_IncrRefCount(msg);
+    nHeldCallbackErrors++;
+}
+
+// raises any callback error held for the given interpreter.  returns JIM_OK if there is none.
+int raiseCallbackError(Jim_Interp* itp) {
+    if (nHeldCallbackErrors == 0) return JIM_OK;
+    callbackErrorT* held = (callbackErrorT*)Jim_GetAssocData(itp, CALLBACK_ERROR_KEY);
+    if (held == NULL || held->error == NULL) return JIM_OK;
+    Jim_SetResult(itp, held->error);
+    Jim_DecrRefCount(itp, held->error);
+    held->error = NULL;
+    nHeldCallbackErrors--;
+    return JIM_ERR;
+}
+
+// applies the function's error policy to its return value.  errNo is errno as captured
+// immediately after the call, before anything else could change it.
+// returns JIM_ERR with an error message if the return value indicates failure.
+int checkReturn(Jim_Interp* itp, metaBlobT* meta, scalarT* rtn, int errNo) {
+    jim_wide value = integerReturn(meta, rtn);
+    int failed = 0;
+    switch (meta->errorCondition) {
+        case EC_NEGATIVE:   failed = value < 0; break;
+        case EC_NONZERO:    failed = value != 0; break;
+        case EC_ZERO:
+        case EC_NULL:       failed = value == 0; break;
+    }
+    if ( ! failed) return JIM_OK;
+
+    const char* msg = NULL;
+    char code[64];
+    switch (meta->errorMessage) {
+        case EM_ERRNO:
+            snprintf(code, sizeof(code), "errno %d", errNo);
+            msg = strerror(errNo);
+            break;
+        case EM_MSGFN:
+            msg = ((const char* (*)(void))meta->errorFn)();
+            break;
+        case EM_CODEMSGFN:
+            msg = ((const char* (*)(int))meta->errorFn)((int)value);
+            break;
+    }
+    if (meta->errorMessage != EM_ERRNO)
+        snprintf(code, sizeof(code), "returned %lld", (long long)value);
+    Jim_Obj* label = meta->errorPolicyList->internalRep.listValue.ele[EP_labelIX];
+    if (msg == NULL) {
+        Jim_SetResultFormatted(itp, "%#s failed: %s", label, code);
+    } else {
+        Jim_SetResultFormatted(itp, "%#s failed: %s (%s)", label, msg, code);
+    }
+    return JIM_ERR;
+}
+
+// executes one native call described by meta.
+// argVarNames is an array of meta->cif->nargs names of the variables holding
+// the packed native arguments, in the order the native function expects them.
+// this is the common back end of callToNative and every bound call command.
+int callMeta(Jim_Interp* itp, metaBlobT* meta, Jim_Obj* const argVarNames[]) {
+    // fill argPtrs with pointers to the content of designated script vars.
+    // those objects have the buffers for the packed native binary content during this native call.
+    // their content has probably moved to a new address since the last call,
+    // and their Jim_Obj's replaced with new ones,
+    // because the script assigned them new values since then.
+    unsigned nArgs = meta->cif->nargs;
+    void* argPtrs[nArgs];
+    for (unsigned n = 0; n < nArgs; n++) {
+        // look up the designated variable, in a global context.
+        Jim_Obj* varName = argVarNames[n];
+        // this must use Jim_GetVariable(), not Jim_GetGlobalVariable(), to support asNative.
+        Jim_Obj* v = Jim_GetVariable(itp, varName, JIM_NONE);
+        if (v == NULL) {
+            Jim_SetResultFormatted(itp, "Native argument variable not found: %#s", varName);
+            return JIM_ERR;
+        }
+        // const is discarded here.  that is required, to be able to pass an argument by pointer
+        // either in or out of a native function.  that is required for large data.
+        int len = 0;
+        argPtrs[n] = (void*)bufferBytesForWrite(v, &len);
+        // safety check.
+        // we'll let it slide here if the script allocated just enough bytes for the value,
+        // and no extra byte for a null terminator.  not all parms are strings.
+        if (argPtrs[n] == NULL || (size_t)len < meta->cif->arg_types[n]->size) {
+            Jim_SetResultFormatted(itp, "Inadequate buffer in argument variable: %#s", varName);
+            return JIM_ERR;
+        }
+    }
+
+    /* how to trace certain native calls.
+    if (meta->fn == (ffiFnP)g_irepository_require) {
+        printf("require     %p '%s' '%s'\n", *(void**)argPtrs[0], *(char**)argPtrs[1], *(char**)argPtrs[2]);
+    }
+    if (meta->fn == (ffiFnP)g_irepository_get_n_infos) {
+        printf("get_n_infos %p '%s'\n", *(void**)argPtrs[0], *(char**)argPtrs[1]);
+    }
+    */
+
+    if (meta->cif->rtype == &ffi_type_void) {
+        // arrange space for a junk return value, just in case libffi decides to write one.
+        ffi_arg rtn;
+
+        // execute call.
+        invokeNative(meta, &rtn, argPtrs);
+        Jim_SetEmptyResult(itp);
+    } else if (meta->returnClass != RC_NATIVE) {
+        // scalar return value needs no buffer object.  a stack variable serves instead,
+        // and the value is unpacked right here, saving a converter command in script.
+        scalarT rtn;
+
+        // execute call.
+        invokeNative(meta, &rtn, argPtrs);
+        int errNo = errno;
+        if (raiseCallbackError(itp) != JIM_OK) return JIM_ERR;
+        if (meta->errorCondition != EC_NONE && checkReturn(itp, meta, &rtn, errNo) != JIM_OK) return JIM_ERR;
+        Jim_SetResult(itp, unpackScalarReturn(itp, meta, &rtn));
+    } else {
+        // arrange space for return value.
+        void* resultBuf = NULL;
+        Jim_Obj* resultObj = NULL;
+        if (createBufferObj(itp, meta->returnSizePadded, &resultBuf, &resultObj) != JIM_OK) return JIM_ERR;
+
+        // execute call.
+        invokeNative(meta, resultBuf, argPtrs);
+        Jim_SetResult(itp, resultObj);
+    }
+    return raiseCallbackError(itp);
+}
+
+// returns the metaBlob held by the given object, or NULL if the object doesn't hold one.
+metaBlobT* objToMeta(Jim_Obj* metaBlobObj) {
+    // Jim_GetString() not used here.  we can detect an invalid metablob without it, and faster.
+    metaBlobT* meta = (metaBlobT*)metaBlobObj->bytes;
+    if (meta == NULL || *(u32*)meta->signature != *(u32*)METABLOB_SIGNATURE)
+        return NULL;
+    return meta;
+}
+
+int callToNative(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    enum {
+        cmdIX = 0,
+        metaBlobVarNameIX,
+        argCount
+    };
+
+    if (objc != argCount) {
+        Jim_SetResultString(itp, "Wrong # args.  Should be: callToNative metaBlobVarName", -1);
+        return JIM_ERR;
+    }
+
+    // find metaBlob for this native function.
+    Jim_Obj* metaBlobObj = Jim_GetVariable(itp, objv[metaBlobVarNameIX], JIM_NONE);
+    if (metaBlobObj == NULL) {
+        Jim_SetResultString(itp, "MetaBlob variable not found.", -1);
+        return JIM_ERR;
+    }
+    metaBlobT* meta = objToMeta(metaBlobObj);
+    if (meta == NULL) {
+        Jim_SetResultString(itp, "Invalid metaBlob content.", -1);
+        return JIM_ERR;
+    }
+
+    // using internalRep of the parms list here for a little more speed.
+    return callMeta(itp, meta, meta->nativeParmsList->internalRep.listValue.ele);
+}
+
+// the scratch arena holds temporary native data that lives for only one dlr command, such as
+// string copies for a native call, or the element array of a list being built.  allocating is
+// a pointer bump, and the whole lot is released in O(1) when the command finishes, back to a
+// mark taken when it started.  that nests correctly when a callback makes another call
+// meanwhile.  each interpreter has its own arena, created on first use.
+// the arena is a stack of chunks.  when the top chunk is full, a bigger one is pushed.  after the
+// outermost command releases everything, the chunks are merged into one of the total size, so
+// a steady workload settles into a single chunk, with no further heap traffic at all.
+#define SCRATCH_KEY "dlrScratch"
+#define SCRATCH_MIN_CHUNK 4096
+#define SCRATCH_ALIGN 16
+
+typedef struct scratchChunkT {
+    struct scratchChunkT* prev; // the chunk below this one in the stack, or NULL.
+    size_t cap;
+    size_t used;
+    _Alignas(SCRATCH_ALIGN) u8 data[];
+} scratchChunkT;
+
+typedef struct {
+    scratchChunkT* top; // never NULL.
+    int depth; // number of marks not yet released.
+} scratchT;
+
+typedef struct {
+    scratchChunkT* chunk;
+    size_t used;
+} scratchMarkT;
+
+scratchChunkT* newScratchChunk(scratchChunkT* prev, size_t cap) {
+    scratchChunkT* c = Jim_Alloc(sizeof(scratchChunkT) + cap);
+    if (c == NULL) return NULL;
+    c->prev = prev;
+    c->cap = cap;
+    c->used = 0;
+    return c;
+}
+
+void deleteScratch(Jim_Interp* itp, void* data) {
+    scratchT* s = (scratchT*)data;
+    while (s->top != NULL) {
+        scratchChunkT* prev = s->top->prev;
+        Jim_Free(s->top);
+        s->top = prev;
+    }
+    Jim_Free(s);
+}
+
+// returns the interpreter's scratch arena, creating it if needed.
+scratchT* getScratch(Jim_Interp* itp) {
+    scratchT* s = (scratchT*)Jim_GetAssocData(itp, SCRATCH_KEY);
+    if (s != NULL) return s;
+    s = Jim_Alloc(sizeof(scratchT));
+    s->top = newScratchChunk(NULL, SCRATCH_MIN_CHUNK);
+    s->depth = 0;
+    Jim_SetAssocData(itp, SCRATCH_KEY, deleteScratch, s);
+    return s;
+}
+
+// every mark must be released exactly once, in reverse order.
+scratchMarkT scratchMark(scratchT* s) {
+    scratchMarkT m = {s->top, s->top->used};
+    s->depth++;
+    return m;
+}
+
+// returns len bytes from the arena, aligned for any scalar type.  they're valid until the
+// arena is released back to a mark taken before this.
+void* scratchAlloc(scratchT* s, size_t len) {
+    size_t start = (s->top->used + SCRATCH_ALIGN - 1) & ~(size_t)(SCRATCH_ALIGN - 1);
+    if (start + len > s->top->cap) {
+        size_t cap = s->top->cap * 2;
+        if (cap < len) cap = len;
+        scratchChunkT* c = newScratchChunk(s->top, cap);
+        if (c == NULL) return NULL;
+        s->top = c;
+        start = 0;
+    }
+    s->top->used = start + len;
+    return s->top->data + start;
+}
+
+// releases everything allocated since the mark was taken.
+void scratchRelease(scratchT* s, scratchMarkT m) {
+    size_t total = 0;
+    while (s->top != m.chunk) {
+        scratchChunkT* prev = s->top->prev;
+        total += s->top->cap;
+        Jim_Free(s->top);
+        s->top = prev;
+    }
+    s->top->used = m.used;
+    if (--s->depth == 0 && total > 0 && s->top->prev == NULL) {
+        // the arena is empty now.  merge its chunks, so the next command fits in one.
+        total += s->top->cap;
+        Jim_Free(s->top);
+        s->top = newScratchChunk(NULL, total);
+    }
+}
+
+// returns a list of the scratch arena's bytes in use and its total capacity.
+// this is for diagnostics and tests.  between commands, nothing should be in use.
+//   scratchUsage
+int scratchUsage(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    if (objc != 1) {
+        Jim_SetResultString(itp, "Wrong # args.  Should be: scratchUsage", -1);
+        return JIM_ERR;
+    }
+    scratchT* s = getScratch(itp);
+    jim_wide used = 0, cap = 0;
+    for (scratchChunkT* c = s->top; c != NULL; c = c->prev) {
+        used += c->used;
+        cap += c->cap;
+    }
+    Jim_Obj* elems[] = {Jim_NewIntObj(itp, used), Jim_NewIntObj(itp, cap)};
+    Jim_SetResult(itp, Jim_NewListObj(itp, elems, 2));
+    return JIM_OK;
+}
+
+// a bound call command is a real Jim command dedicated to one native function.
+// it does the same job as callToNative, but everything callToNative looks up on every
+// call is resolved once, when the command is created, and held in its clientData:
+// the metaBlob object itself, and a table of argument slots.
+// each slot is a variable name object owned by the binding alone.  Jim caches
+// the variable resolution inside such an object, and since no script can ever shimmer
+// these objects to another type, that cache stays valid, and no namespace or hash
+// lookup is needed to find the packed argument buffers after the first call.
+typedef struct {
+    Jim_Obj* metaBlobObj; // reference held for the life of the command.
+    metaBlobT* meta;
+    scratchT* scratch; // the interpreter's scratch arena, for temporaries of one call.
+    Jim_Obj* slots[]; // one variable name per native argument.
+} callBindingT;
+
+int boundCallToNative(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    if (objc != 1) {
+        Jim_SetResultString(itp, "Wrong # args.  Bound call command takes no arguments.", -1);
+        return JIM_ERR;
+    }
+    callBindingT* binding = (callBindingT*)Jim_CmdPrivData(itp);
+    return callMeta(itp, binding->meta, binding->slots);
+}
+
+void deleteCallBinding(Jim_Interp* itp, void* privData) {
+    callBindingT* binding = (callBindingT*)privData;
+    for (unsigned n = 0; n < binding->meta->cif->nargs; n++)
+        Jim_DecrRefCount(itp, binding->slots[n]);
+    Jim_DecrRefCount(itp, binding->metaBlobObj);
+    Jim_Free(binding);
+}
+
+// allocates a call binding for the given metaBlob object, for a bound or planned call command.
+// returns NULL after setting an error message if that fails.
+callBindingT* newCallBinding(Jim_Interp* itp, Jim_Obj* metaBlobObj, metaBlobT* meta) {
+    unsigned nArgs = meta->cif->nargs;
+    callBindingT* binding = Jim_Alloc(sizeof(callBindingT) + nArgs * sizeof(Jim_Obj*));
+    if (binding == NULL) {
+        Jim_SetResultString(itp, "Out of memory while allocating call binding.", -1);
+        return NULL;
+    }
+    binding->metaBlobObj = metaBlobObj;
+    Jim_IncrRefCount(metaBlobObj);
+    binding->meta = meta;
+    binding->scratch = getScratch(itp);
+    for (unsigned n = 0; n < nArgs; n++) {
+        int len = 0;
+        const char* name = Jim_GetString(meta->nativeParmsList->internalRep.listValue.ele[n], &len);
+        binding->slots[n] = Jim_NewStringObj(itp, name, len);
+        Jim_IncrRefCount(binding->slots[n]);
+    }
+    return binding;
+}
+
+// creates (or replaces) a bound call command for the native function described
+// by the given metaBlob variable.
+// the command keeps using the metaBlob that was in the variable at the time it was bound.
+// so after any prepMetaBlob on that variable, script must call bindCallToNative again.
+int bindCallToNative(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    enum {
+        cmdIX = 0,
+        cmdNameIX,
+        metaBlobVarNameIX,
+        argCount
+    };
+
+    if (objc != argCount) {
+        Jim_SetResultString(itp, "Wrong # args.  Should be: bindCallToNative cmdName metaBlobVarName", -1);
+        return JIM_ERR;
+    }
+
+    Jim_Obj* metaBlobObj = Jim_GetVariable(itp, objv[metaBlobVarNameIX], JIM_NONE);
+    if (metaBlobObj == NULL) {
+        Jim_SetResultString(itp, "MetaBlob variable not found.", -1);
+        return JIM_ERR;
+    }
+    metaBlobT* meta = objToMeta(metaBlobObj);
+    if (meta == NULL) {
+        Jim_SetResultString(itp, "Invalid metaBlob content.", -1);
+        return JIM_ERR;
+    }
+
+    callBindingT* binding = newCallBinding(itp, metaBlobObj, meta);
+    if (binding == NULL) return JIM_ERR;
+    Jim_CreateCommand(itp, Jim_String(objv[cmdNameIX]), boundCallToNative, binding, deleteCallBinding);
+    return JIM_OK;
+}
+
+// creates (or replaces) a planned call command for the native function described
+// by the given metaBlob variable.  the metaBlob must have a marshaling plan.
+// the same rules apply as for bindCallToNative.
+int bindPlannedCall(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    enum {
+        cmdIX = 0,
+        cmdNameIX,
+        metaBlobVarNameIX,
+        argCount
+    };
+
+    if (objc != argCount) {
+        Jim_SetResultString(itp, "Wrong # args.  Should be: bindPlannedCall cmdName metaBlobVarName", -1);
+        return JIM_ERR;
+    }
+
+    Jim_Obj* metaBlobObj = Jim_GetVariable(itp, objv[metaBlobVarNameIX], JIM_NONE);
+    if (metaBlobObj == NULL) {
+        Jim_SetResultString(itp, "MetaBlob variable not found.", -1);
+        return JIM_ERR;
+    }
+    metaBlobT* meta = objToMeta(metaBlobObj);
+    if (meta == NULL) {
+        Jim_SetResultString(itp, "Invalid metaBlob content.", -1);
+        return JIM_ERR;
+    }
+    if (meta->plan == NULL) {
+        Jim_SetResultString(itp, "MetaBlob has no marshaling plan.", -1);
+        return JIM_ERR;
+    }
+
+    callBindingT* binding = newCallBinding(itp, metaBlobObj, meta);
+    if (binding == NULL) return JIM_ERR;
+    Jim_CreateCommand(itp, Jim_String(objv[cmdNameIX]), plannedCallToNative, binding, deleteCallBinding);
+    return JIM_OK;
+}
+
+// packs a script value into the scalar storage at dest, as the given FFI_TYPE_* type.
+int packScalar(Jim_Interp* itp, int typeCode, Jim_Obj* value, void* dest) {
+    if (typeCode == FFI_TYPE_FLOAT || typeCode == FFI_TYPE_DOUBLE || typeCode == FFI_TYPE_LONGDOUBLE) {
+        double d = 0;
+        if (Jim_GetDouble(itp, value, &d) != JIM_OK) {
+            Jim_SetResultString(itp, "Expected data value double-precision float but got other data.", -1);
+            return JIM_ERR;
+        }
+        if (typeCode == FFI_TYPE_FLOAT) {
+            *(float*)dest = (float)d;
+        } else if (typeCode == FFI_TYPE_DOUBLE) {
+            *(double*)dest = d;
+        } else {
+            *(long double*)dest = (long double)d;
+        }
+        return JIM_OK;
+    }
+    if (typeCode == FFI_TYPE_POINTER)
+        return getPointer(itp, value, (void**)dest);
+    jim_wide w = 0;
+    if (Jim_GetWide(itp, value, &w) != JIM_OK) {
+        Jim_SetResultString(itp, "Expected data value integer but got other data.", -1);
         return JIM_ERR;
-    memcpy(bufP, srcP, (size_t)len);
+    }
+    switch (typeCode) {
+        case FFI_TYPE_UINT8:  case FFI_TYPE_SINT8:  *(u8*)dest  = (u8)w;  break;
+        case FFI_TYPE_UINT16: case FFI_TYPE_SINT16: *(u16*)dest = (u16)w; break;
+        case FFI_TYPE_UINT32: case FFI_TYPE_SINT32: *(u32*)dest = (u32)w; break;
+        default:                                    *(u64*)dest = (u64)w; break;
+    }
+    return JIM_OK;
+}
 
-    // pass new buffer's address back to script as result of this command.
-    Jim_SetResultInt(itp, (jim_wide)bufP);
+// unpacks the scalar at src, of the given FFI_TYPE_* type, to a new script integer or double.
+Jim_Obj* unpackScalar(Jim_Interp* itp, int typeCode, void* src) {
+    switch (typeCode) {
+        case FFI_TYPE_UINT8:      return Jim_NewIntObj(itp, (jim_wide) *(u8*)src);
+        case FFI_TYPE_SINT8:      return Jim_NewIntObj(itp, (jim_wide) *(i8*)src);
+        case FFI_TYPE_UINT16:     return Jim_NewIntObj(itp, (jim_wide) *(u16*)src);
+        case FFI_TYPE_SINT16:     return Jim_NewIntObj(itp, (jim_wide) *(i16*)src);
+        case FFI_TYPE_UINT32:     return Jim_NewIntObj(itp, (jim_wide) *(u32*)src);
+        case FFI_TYPE_SINT32:     return Jim_NewIntObj(itp, (jim_wide) *(i32*)src);
+        case FFI_TYPE_POINTER:    return newPointerObj(itp, *(void**)src, 0);
+        case FFI_TYPE_FLOAT:      return Jim_NewDoubleObj(itp, (double) *(float*)src);
+        case FFI_TYPE_DOUBLE:     return Jim_NewDoubleObj(itp, *(double*)src);
+        case FFI_TYPE_LONGDOUBLE: return Jim_NewDoubleObj(itp, (double) *(long double*)src);
+        default:                  return Jim_NewIntObj(itp, (jim_wide) *(u64*)src);
+    }
+}
+
+// packs a value by calling the plan step's script packer, and fetches the packed buffer object.
+// the caller receives a new reference to the buffer object, and must release it.
+int planPackScript(Jim_Interp* itp, Jim_Obj* const stepList[], Jim_Obj* value, Jim_Obj** bufP) {
+    Jim_Obj* cmd[] = {stepList[PL_packerIX], stepList[PL_bufVarNameIX], value};
+    if (Jim_EvalObjVector(itp, 3, cmd) != JIM_OK) return JIM_ERR;
+    Jim_Obj* buf = Jim_GetVariable(itp, stepList[PL_bufVarNameIX], JIM_ERRMSG);
+    if (buf == NULL) return JIM_ERR;
+    Jim_GetString(buf, NULL); // ensure string rep exists.
+    Jim_IncrRefCount(buf);
+    *bufP = buf;
     return JIM_OK;
 }
 
-int varToTypeP(Jim_Interp* itp, Jim_Obj *var, ffi_type** typ) {
-    Jim_Obj* typeObj = Jim_GetVariable(itp, var, JIM_ERRMSG);
-    if (typeObj == NULL) return JIM_ERR;
-    jim_wide code = 0;
-    if (Jim_GetWide(itp, typeObj, &code) == JIM_OK) {
-        // found integer.  valid type code?
-        if (code < 0 || code > FFI_TYPE_FINAL || ffiTypes[code] == NULL) {
-            Jim_SetResultString(itp, "Invalid type ID code integer.", -1);
+// unpacks by calling the plan step's script unpacker.  the unpacked value is left in the interp result.
+int planUnpackScript(Jim_Interp* itp, Jim_Obj* const stepList[], Jim_Obj* packed) {
+    Jim_Obj* cmd[] = {stepList[PL_unpackerIX], packed};
+    return Jim_EvalObjVector(itp, 2, cmd);
+}
+
+// converts a native string given out by a native function, to a new script string,
+// and frees the native string if required.
+Jim_Obj* planUnpackAscii(Jim_Interp* itp, planStepT* step, char* str) {
+    if (str == NULL)
+        return newNullPtrFlagObj(itp);
+    Jim_Obj* obj = Jim_NewStringObj(itp, str, -1);
+    if (step->memFree)
+        Jim_Free(str);
+    return obj;
+}
+
+// a planned call command does all the work of a generated call wrapper proc, per the
+// marshaling plan in its metaBlob.  its arguments are the same as the wrapper's:
+// the values of "in" parms, and the names of the caller's variables for "out" and "inOut" parms.
+// its result is the unpacked return value.
+int plannedCallToNative(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    callBindingT* binding = (callBindingT*)Jim_CmdPrivData(itp);
+    metaBlobT* meta = binding->meta;
+    unsigned nArgs = meta->cif->nargs;
+    if (objc != (int)nArgs + 1) {
+        Jim_SetResultFormatted(itp, "Wrong # args.  %#s expects %d arguments.", objv[0], (int)nArgs);
+        return JIM_ERR;
+    }
+
+    Jim_Obj** planNames = meta->planList->internalRep.listValue.ele;
+    scalarT targets[nArgs + 1]; // target data for scalar parms.  +1 avoids a zero-length array.
+    void* ptrs[nArgs + 1]; // pointers to the target data.
+    void* ptrPtrs[nArgs + 1]; // pointers to those pointers.
+    char* copies[nArgs + 1]; // string copies in the scratch arena, for this call only.
+    Jim_Obj* bufs[nArgs + 1]; // buffer objects from script packers, referenced during this call.
+    void* argPtrs[nArgs + 1];
+    memset(copies, 0, sizeof(copies));
+    memset(bufs, 0, sizeof(bufs));
+    scratchMarkT mark = scratchMark(binding->scratch);
+    Jim_Obj* rtnBuf = NULL;
+    int status = JIM_ERR;
+
+    // pack parms.
+    for (unsigned n = 0; n < nArgs; n++) {
+        planStepT* step = &meta->plan[n];
+        Jim_Obj* const* stepList = &planNames[n * PLAN_STRIDE];
+
+        // "out" and "inOut" parms are given as the name of a variable in the caller's frame.
+        // its value is packed even for "out", to ensure buffer space is available before the call.
+        Jim_Obj* value = objv[n + 1];
+        if (step->dir & DF_DIR_OUT) {
+            value = Jim_GetVariable(itp, objv[n + 1], JIM_ERRMSG);
+            if (value == NULL) goto done;
+        }
+
+        if (step->passMethod == PM_BYVAL) {
+            if (step->kind == PK_SCALAR) {
+                if (packScalar(itp, step->typeCode, value, &targets[n]) != JIM_OK) goto done;
+                argPtrs[n] = &targets[n];
+            } else {
+                if (planPackScript(itp, stepList, value, &bufs[n]) != JIM_OK) goto done;
+                argPtrs[n] = bufs[n]->bytes;
+                if (bufs[n]->length < meta->cif->arg_types[n]->size) {
+                    Jim_SetResultFormatted(itp, "Inadequate buffer from packer: %#s", stepList[PL_packerIX]);
+                    goto done;
+                }
+            }
+            continue;
+        }
+
+        ptrs[n] = NULL;
+        if (step->passMethod == PM_BYPTRPTR) {
+            // the pointer-to-pointer is never null.  the native function gives out the target pointer.
+            ptrPtrs[n] = &ptrs[n];
+            argPtrs[n] = &ptrPtrs[n];
+            continue;
+        }
+
+        // pass by pointer.  check for the null pointer flag at run time.
+        argPtrs[n] = &ptrs[n];
+        int isNull = step->kind == PK_ASCII  ?  isNullPtrFlag(itp, value)  :  bufferLength(value) == 0;
+        if (isNull) continue;
+        if (step->kind == PK_SCALAR) {
+            if (packScalar(itp, step->typeCode, value, &targets[n]) != JIM_OK) goto done;
+            ptrs[n] = &targets[n];
+        } else if (step->borrow) {
+            // the caller's value stays alive until this command returns, so its bytes do too.
+            ptrs[n] = step->kind == PK_BYTES  ?  (void*)bufferBytes(value, NULL)  :  (void*)Jim_String(value);
+        } else if (step->kind == PK_ASCII) {
+            int len = 0;
+            const char* src = Jim_GetString(value, &len);
+            copies[n] = scratchAlloc(binding->scratch, len + 1);
+            memcpy(copies[n], src, len + 1);
+            ptrs[n] = copies[n];
+        } else {
+            if (planPackScript(itp, stepList, value, &bufs[n]) != JIM_OK) goto done;
+            ptrs[n] = bufs[n]->bytes;
+        }
+    }
+
+    // execute call.
+    scalarT rtn;
+    void* rtnP = &rtn;
+    if (meta->cif->rtype != &ffi_type_void && meta->returnClass == RC_NATIVE) {
+        if (createBufferObj(itp, meta->returnSizePadded, &rtnP, &rtnBuf) != JIM_OK) goto done;
+        Jim_IncrRefCount(rtnBuf);
+    }
+    invokeNative(meta, rtnP, argPtrs);
+    int errNo = errno;
+    if (raiseCallbackError(itp) != JIM_OK) goto done;
+    if (meta->errorCondition != EC_NONE && checkReturn(itp, meta, &rtn, errNo) != JIM_OK) goto done;
+
+    // unpack "out" parms.
+    for (unsigned n = 0; n < nArgs; n++) {
+        planStepT* step = &meta->plan[n];
+        Jim_Obj* const* stepList = &planNames[n * PLAN_STRIDE];
+        if ( ! (step->dir & DF_DIR_OUT)) continue;
+
+        Jim_Obj* result = NULL;
+        if (step->passMethod == PM_BYPTRPTR) {
+            if (step->kind == PK_ASCII) {
+                result = planUnpackAscii(itp, step, (char*)ptrs[n]);
+            } else {
+                // the script's scriptPtr unpacker also implements the memAction.
+                if (planUnpackScript(itp, stepList, Jim_NewIntObj(itp, (jim_wide)ptrs[n])) != JIM_OK) goto done;
+                result = Jim_GetResult(itp);
+            }
+        } else {
+            if (ptrs[n] == NULL) continue;
+            if (step->kind == PK_SCALAR) {
+                result = unpackScalar(itp, step->typeCode, &targets[n]);
+            } else if (step->kind == PK_ASCII) {
+                result = Jim_NewStringObj(itp, copies[n], -1);
+            } else {
+                if (planUnpackScript(itp, stepList, bufs[n]) != JIM_OK) goto done;
+                result = Jim_GetResult(itp);
+            }
+        }
+        if (Jim_SetVariable(itp, objv[n + 1], result) != JIM_OK) goto done;
+    }
+
+    // unpack return value.
+    planStepT* step = &meta->plan[nArgs];
+    Jim_Obj* const* stepList = &planNames[nArgs * PLAN_STRIDE];
+    if (step->kind == PK_VOID) {
+        Jim_SetEmptyResult(itp);
+    } else if (step->kind == PK_SCALAR) {
+        Jim_SetResult(itp, unpackScalarReturn(itp, meta, &rtn));
+    } else if (step->kind == PK_ASCII) {
+        Jim_SetResult(itp, planUnpackAscii(itp, step, (char*)rtn.p));
+    } else {
+        Jim_Obj* packed = step->passMethod == PM_BYVAL  ?  rtnBuf  :  Jim_NewIntObj(itp, (jim_wide)rtn.p);
+        if (planUnpackScript(itp, stepList, packed) != JIM_OK) goto done;
+    }
+    status = JIM_OK;
+
+done:
+    for (unsigned n = 0; n < nArgs; n++) {
+        if (bufs[n] != NULL) Jim_DecrRefCount(itp, bufs[n]);
+    }
+    if (rtnBuf != NULL) Jim_DecrRefCount(itp, rtnBuf);
+    scratchRelease(binding->scratch, mark);
+    return status;
+}
+
+// a batch is the native argument data for many calls to one function, packed up front,
+// so the calls themselves can run without touching any Jim objects.  that lets them be
+// split across worker threads.  each tuple has its own nArgs elements of each array.
+typedef struct {
+    metaBlobT* meta;
+    unsigned nArgs;
+    unsigned nTuples;
+    scalarT* targets; // target data for scalar parms.
+    void** ptrs; // pointers to the target data.
+    void** ptrPtrs; // pointers to those pointers.
+    char** copies; // string copies owned by the batch.
+    void** argPtrs;
+    scalarT* rtns; // one return value per tuple.
+    int* errNos; // errno as captured right after each call, for the error policy.
+    scratchT* scratch; // arena holding all of the above, or NULL if they're on the heap.
+} batchT;
+
+typedef struct {
+    batchT* batch;
+    unsigned first;
+    unsigned count;
+} batchSliceT;
+
+// allocates memory for a batch, from its scratch arena if it has one, or else the heap.
+void* batchAlloc(batchT* b, size_t len) {
+    return b->scratch != NULL  ?  scratchAlloc(b->scratch, len)  :  Jim_Alloc(len);
+}
+
+// allocates the arrays of a batch of nTuples calls.  a batch that's finished before the
+// command returns can keep them in the scratch arena.  the caller releases that afterward.
+// a batch that outlives the command gives NULL for scratch instead.
+void newBatch(batchT* b, metaBlobT* meta, unsigned nTuples, scratchT* scratch) {
+    unsigned nSlots = nTuples * meta->cif->nargs + 1; // +1 avoids a zero-length allocation.
+    b->meta = meta;
+    b->nArgs = meta->cif->nargs;
+    b->nTuples = nTuples;
+    b->scratch = scratch;
+    b->targets = batchAlloc(b, nSlots * sizeof(scalarT));
+    b->ptrs = batchAlloc(b, nSlots * sizeof(void*));
+    b->ptrPtrs = batchAlloc(b, nSlots * sizeof(void*));
+    b->copies = batchAlloc(b, nSlots * sizeof(char*));
+    b->argPtrs = batchAlloc(b, nSlots * sizeof(void*));
+    b->rtns = batchAlloc(b, (nTuples + 1) * sizeof(scalarT));
+    b->errNos = batchAlloc(b, (nTuples + 1) * sizeof(int));
+    memset(b->copies, 0, nSlots * sizeof(char*));
+}
+
+// frees the arrays of a batch, and any string copies it owns.  those in a scratch arena
+// are released with the arena instead.
+void freeBatch(batchT* b) {
+    if (b->scratch != NULL) return;
+    for (unsigned i = 0; i < b->nTuples * b->nArgs; i++) {
+        if (b->copies[i] != NULL) Jim_Free(b->copies[i]);
+    }
+    Jim_Free(b->targets);
+    Jim_Free(b->ptrs);
+    Jim_Free(b->ptrPtrs);
+    Jim_Free(b->copies);
+    Jim_Free(b->argPtrs);
+    Jim_Free(b->rtns);
+    Jim_Free(b->errNos);
+}
+
+// verifies the metaBlob's function can be called in a batch, with no script converters.
+// sets *hasOutsP if it has any "out" or "inOut" parms.
+// an error policy taking its message from msgFn isn't supported.  that function reports the
+// lib's state on the calling thread at the moment, which by then may belong to another call.
+int checkBatchPlan(Jim_Interp* itp, metaBlobT* meta, int* hasOutsP) {
+    unsigned nArgs = meta->cif->nargs;
+    *hasOutsP = 0;
+    if (meta->plan == NULL) {
+        Jim_SetResultString(itp, "Batch or async call requires a marshaling plan.", -1);
+        return JIM_ERR;
+    }
+    if (meta->errorCondition != EC_NONE && meta->errorMessage == EM_MSGFN) {
+        Jim_SetResultString(itp, "Batch or async call doesn't support an error policy with msgFn.", -1);
+        return JIM_ERR;
+    }
+    for (unsigned n = 0; n <= nArgs; n++) {
+        if (meta->plan[n].kind == PK_SCRIPT) {
+            Jim_SetResultString(itp, "Batch or async call doesn't support script converters.", -1);
             return JIM_ERR;
         }
-        *typ = ffiTypes[code];
-        return JIM_OK;
+        if (n < nArgs && (meta->plan[n].dir & DF_DIR_OUT)) *hasOutsP = 1;
     }
-    *typ = (ffi_type*)Jim_GetString(typeObj, NULL);
-    if (*typ == NULL || typeObj->length < sizeof(ffi_type)) {
-        Jim_SetResultString(itp, "Structure type metadata variable is unusable.", -1);
+    return JIM_OK;
+}
+
+// executes the calls for one slice of a batch.  runs on any thread.
+void* runBatchSlice(void* sliceP) {
+    batchSliceT* slice = (batchSliceT*)sliceP;
+    batchT* b = slice->batch;
+    for (unsigned t = slice->first; t < slice->first + slice->count; t++) {
+        invokeNative(b->meta, &b->rtns[t], &b->argPtrs[t * b->nArgs]);
+        b->errNos[t] = errno;
+    }
+    return NULL;
+}
+
+// packs one tuple of script values into the batch, per the marshaling plan.
+// borrowed parms point straight at the tuple's values only if borrowOK, meaning the caller
+// keeps the tuple alive until the calls are done.  otherwise they're copied like any others.
+int packBatchTuple(Jim_Interp* itp, batchT* b, unsigned t, Jim_Obj* tuple, int borrowOK) {
+    metaBlobT* meta = b->meta;
+    if (Jim_ListLength(itp, tuple) != (int)b->nArgs) {
+        Jim_SetResultFormatted(itp, "Argument tuple has the wrong length: %#s", tuple);
         return JIM_ERR;
     }
+    for (unsigned n = 0; n < b->nArgs; n++) {
+        unsigned i = t * b->nArgs + n;
+        planStepT* step = &meta->plan[n];
+        Jim_Obj* value = Jim_ListGetIndex(itp, tuple, n);
+
+        if (step->passMethod == PM_BYVAL) {
+            if (packScalar(itp, step->typeCode, value, &b->targets[i]) != JIM_OK) return JIM_ERR;
+            b->argPtrs[i] = &b->targets[i];
+            continue;
+        }
+
+        b->ptrs[i] = NULL;
+        if (step->passMethod == PM_BYPTRPTR) {
+            b->ptrPtrs[i] = &b->ptrs[i];
+            b->argPtrs[i] = &b->ptrPtrs[i];
+            continue;
+        }
+
+        b->argPtrs[i] = &b->ptrs[i];
+        int isNull = step->kind == PK_ASCII  ?  isNullPtrFlag(itp, value)  :  bufferLength(value) == 0;
+        if (isNull) continue;
+        if (step->kind == PK_SCALAR) {
+            if (packScalar(itp, step->typeCode, value, &b->targets[i]) != JIM_OK) return JIM_ERR;
+            b->ptrs[i] = &b->targets[i];
+        } else if (step->borrow && borrowOK) {
+            b->ptrs[i] = step->kind == PK_BYTES  ?  (void*)bufferBytes(value, NULL)  :  (void*)Jim_String(value);
+        } else {
+            int len = 0;
+            const char* src = Jim_GetString(value, &len);
+            b->copies[i] = batchAlloc(b, len + 1);
+            memcpy(b->copies[i], src, len + 1);
+            b->ptrs[i] = b->copies[i];
+        }
+    }
     return JIM_OK;
 }
 
-//todo: test with nested structs.
-int prepStructType(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+// unpacks the results of one tuple of the batch.  that's the return value, or if the
+// function has "out" or "inOut" parms, a list of the return value followed by those parms.
+Jim_Obj* unpackBatchTuple(Jim_Interp* itp, batchT* b, unsigned t, int hasOuts) {
+    metaBlobT* meta = b->meta;
+    planStepT* rtnStep = &meta->plan[b->nArgs];
+    Jim_Obj* rtn = NULL;
+    if (rtnStep->kind == PK_VOID) {
+        rtn = Jim_NewEmptyStringObj(itp);
+    } else if (rtnStep->kind == PK_SCALAR) {
+        rtn = unpackScalarReturn(itp, meta, &b->rtns[t]);
+    } else {
+        rtn = planUnpackAscii(itp, rtnStep, (char*)b->rtns[t].p);
+    }
+    if ( ! hasOuts) return rtn;
+
+    Jim_Obj* result = Jim_NewListObj(itp, &rtn, 1);
+    for (unsigned n = 0; n < b->nArgs; n++) {
+        unsigned i = t * b->nArgs + n;
+        planStepT* step = &meta->plan[n];
+        if ( ! (step->dir & DF_DIR_OUT)) continue;
+        Jim_Obj* out = NULL;
+        if (step->kind == PK_ASCII) {
+            out = planUnpackAscii(itp, step, step->passMethod == PM_BYPTRPTR  ?  (char*)b->ptrs[i]  :  b->copies[i]);
+        } else if (b->ptrs[i] == NULL) {
+            out = Jim_NewEmptyStringObj(itp);
+        } else {
+            out = unpackScalar(itp, step->typeCode, &b->targets[i]);
+        }
+        Jim_ListAppendElement(itp, result, out);
+    }
+    return result;
+}
+
+// calls the function described by the metaBlob once for each tuple in argTupleList,
+// and returns a list of the results.  each tuple gives a value for every parm, including
+// "out" and "inOut" (unlike a planned call command, which takes variable names for those).
+// the calls are split across the given number of threads, which must be 1 unless the
+// native function is thread-safe.  the dlr script package enforces that.
+// requires a marshaling plan with no script converters.
+int callBatch(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
     enum {
         cmdIX = 0,
-        structTypeVarNameIX,
-        memberTypeVarNameListIX,
+        metaBlobVarNameIX,
+        argTupleListIX,
+        threadsIX,
         argCount
     };
 
     if (objc != argCount) {
-        Jim_SetResultString(itp, "Wrong # args.", -1);
+        Jim_SetResultString(itp, "Wrong # args.  Should be: callBatch metaBlobVarName argTupleList threads", -1);
         return JIM_ERR;
     }
 
-    // create buffer variable for type blob.  first we must determine its final size from the number of its members.
-    Jim_Obj* typesList = objv[memberTypeVarNameListIX];
-    int nMemb = Jim_ListLength(itp, typesList);
-    int blobLen = sizeof(ffi_type) + (nMemb + 1) * sizeof(ffi_type*);
-    ffi_type* structTyp;
-    if (createBufferVarNative(itp, objv[structTypeVarNameIX], blobLen, (void**)&structTyp, NULL) != JIM_OK) return JIM_ERR;
-    structTyp->type = FFI_TYPE_STRUCT;
-    structTyp->size = 0;
-    structTyp->alignment = 0;
+    Jim_Obj* metaBlobObj = Jim_GetVariable(itp, objv[metaBlobVarNameIX], JIM_NONE);
+    if (metaBlobObj == NULL) {
+        Jim_SetResultString(itp, "MetaBlob variable not found.", -1);
+        return JIM_ERR;
+    }
+    metaBlobT* meta = objToMeta(metaBlobObj);
+    if (meta == NULL) {
+        Jim_SetResultString(itp, "Invalid metaBlob content.", -1);
+        return JIM_ERR;
+    }
+    int hasOuts = 0;
+    if (checkBatchPlan(itp, meta, &hasOuts) != JIM_OK) return JIM_ERR;
 
-    // gather members types.
-    structTyp->elements = (ffi_type**)(structTyp + 1); // now structTyp->elements can be treated as the types array at the end of the struct.
-    for (int n = 0; n < nMemb; n++) {
-        if (varToTypeP(itp, Jim_ListGetIndex(itp, typesList, n), &structTyp->elements[n]) != JIM_OK) {
-            Jim_SetResultString(itp, "Variable defining a member type is unusable.", -1);
-            return JIM_ERR;
+    jim_wide threads = 1;
+    if (Jim_GetWide(itp, objv[threadsIX], &threads) != JIM_OK || threads < 1) {
+        Jim_SetResultString(itp, "Expected thread count but got other data.", -1);
+        return JIM_ERR;
+    }
+
+    // hold the tuple list, in case a converter error or a script changes it meanwhile.
+    Jim_Obj* tupleList = objv[argTupleListIX];
+    Jim_IncrRefCount(tupleList);
+    unsigned nTuples = (unsigned)Jim_ListLength(itp, tupleList);
+    scratchT* scratch = getScratch(itp);
+    scratchMarkT mark = scratchMark(scratch);
+    batchT b;
+    newBatch(&b, meta, nTuples, scratch);
+    int status = JIM_ERR;
+
+    // pack all tuples.
+    for (unsigned t = 0; t < nTuples; t++) {
+        if (packBatchTuple(itp, &b, t, Jim_ListGetIndex(itp, tupleList, t), 1) != JIM_OK) goto done;
+    }
+
+    // execute calls.  this thread takes the first slice, and any workers take the others.
+    // more threads than online CPUs would only wait on each other, so that's the limit.
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        if (cpus < 1) cpus = 1;
+        if (threads > cpus) threads = cpus;
+        if (threads > nTuples) threads = nTuples > 0  ?  nTuples  :  1;
+        batchSliceT* slices = Jim_Alloc(threads * sizeof(batchSliceT));
+        pthread_t* workers = Jim_Alloc(threads * sizeof(pthread_t));
+        unsigned per = nTuples / threads;
+        unsigned extra = nTuples % threads;
+        unsigned first = 0;
+        for (unsigned w = 0; w < threads; w++) {
+            slices[w].batch = &b;
+            slices[w].first = first;
+            slices[w].count = per + (w < extra  ?  1  :  0);
+            first += slices[w].count;
         }
+        unsigned started = 1;
+        for ( ; started < threads; started++) {
+            // if a thread can't start, its slice is done on this thread instead.
+            if (pthread_create(&workers[started], NULL, runBatchSlice, &slices[started]) != 0) break;
+        }
+        runBatchSlice(&slices[0]);
+        for (unsigned w = started; w < threads; w++)
+            runBatchSlice(&slices[w]);
+        for (unsigned w = 1; w < started; w++)
+            pthread_join(workers[w], NULL);
+        Jim_Free(slices);
+        Jim_Free(workers);
     }
-    structTyp->elements[nMemb] = NULL; // terminating NULL element is required by FFI.
 
+    // unpack results.  all are unpacked first, so any native memory they own is freed.
+    // then an error held from a callback is raised, or else the error policy raises an
+    // error for the first call that failed, if any.
+    Jim_Obj* results = Jim_NewListObj(itp, NULL, 0);
+    for (unsigned t = 0; t < nTuples; t++)
+        Jim_ListAppendElement(itp, results, unpackBatchTuple(itp, &b, t, hasOuts));
+    if (raiseCallbackError(itp) != JIM_OK) {
+        Jim_FreeNewObj(itp, results);
+        goto done;
+    }
+    if (meta->errorCondition != EC_NONE) {
+        for (unsigned t = 0; t < nTuples; t++) {
+            if (checkReturn(itp, meta, &b.rtns[t], b.errNos[t]) != JIM_OK) {
+                Jim_FreeNewObj(itp, results);
+                goto done;
+            }
+        }
+    }
+    Jim_SetResult(itp, results);
+    status = JIM_OK;
+
+done:
+    freeBatch(&b);
+    scratchRelease(scratch, mark);
+    Jim_DecrRefCount(itp, tupleList);
+    return status;
+}
+
+// async calls run on a fixed pool of worker threads, so the interpreter stays responsive
+// while slow native functions run.  each job is a batch of one call, packed on the interpreter
+// thread.  a worker calls it, moves it to the finished list, and writes a byte to a pipe.
+// the interpreter's event loop sees the pipe readable, unpacks each finished job, and schedules
+// its callback script with "after idle", the same way as any other event.
+// the pool belongs to the interpreter, as assoc data.  it starts with the first async call.
+typedef struct asyncJobT {
+    struct asyncJobT* next;
+    batchT batch;
+    int hasOuts;
+    Jim_Obj* metaBlobObj; // referenced so the metaBlob stays alive, even if the function is redeclared.
+    Jim_Obj* callback;
+} asyncJobT;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    asyncJobT* pending; // queue head.
+    asyncJobT** pendingTail;
+    asyncJobT* finished; // queue head.
+    asyncJobT** finishedTail;
+    int stopping;
+    int pipeFds[2];
+    int nWorkers;
+    pthread_t* workers;
+} asyncPoolT;
+
+#define ASYNC_POOL_KEY "dlrAsyncPool"
+
+void freeAsyncJob(Jim_Interp* itp, asyncJobT* job) {
+    freeBatch(&job->batch);
+    Jim_DecrRefCount(itp, job->metaBlobObj);
+    Jim_DecrRefCount(itp, job->callback);
+    Jim_Free(job);
+}
+
+// the main loop of each worker thread.
+void* asyncWorker(void* poolP) {
+    asyncPoolT* pool = (asyncPoolT*)poolP;
+    pthread_mutex_lock(&pool->lock);
+    while (1) {
+        while (pool->pending == NULL && ! pool->stopping)
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        if (pool->stopping) break;
+        asyncJobT* job = pool->pending;
+        pool->pending = job->next;
+        if (pool->pending == NULL) pool->pendingTail = &pool->pending;
+        pthread_mutex_unlock(&pool->lock);
+
+        batchT* b = &job->batch;
+        invokeNative(b->meta, &b->rtns[0], b->argPtrs);
+        b->errNos[0] = errno;
+
+        pthread_mutex_lock(&pool->lock);
+        job->next = NULL;
+        *pool->finishedTail = job;
+        pool->finishedTail = &job->next;
+        // wake the event loop.  if the pipe is already full, it's already awake.
+        ssize_t junk = write(pool->pipeFds[1], "j", 1);
+        (void)junk;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+// event loop handler for the pool's pipe.  delivers all finished jobs.
+int asyncReadable(Jim_Interp* itp, void* poolP, int mask) {
+    asyncPoolT* pool = (asyncPoolT*)poolP;
+    char drain[64];
+    while (read(pool->pipeFds[0], drain, sizeof(drain)) > 0) {}
+
+    pthread_mutex_lock(&pool->lock);
+    asyncJobT* job = pool->finished;
+    pool->finished = NULL;
+    pool->finishedTail = &pool->finished;
+    pthread_mutex_unlock(&pool->lock);
+
+    while (job != NULL) {
+        asyncJobT* next = job->next;
+        // the callback is a command prefix.  the result is appended as its last argument.
+        // "after idle" reports any error through bgerror, and keeps this handler registered.
+        // if a callback error is held, or the error policy says the call failed, that error goes
+        // to bgerror instead of the callback.
+        Jim_Obj* script = Jim_DuplicateObj(itp, job->callback);
+        Jim_ListAppendElement(itp, script, unpackBatchTuple(itp, &job->batch, 0, job->hasOuts));
+        metaBlobT* meta = job->batch.meta;
+        if (raiseCallbackError(itp) != JIM_OK
+            || (meta->errorCondition != EC_NONE && checkReturn(itp, meta, &job->batch.rtns[0], job->batch.errNos[0]) != JIM_OK)) {
+            Jim_FreeNewObj(itp, script);
+            Jim_Obj* errorCmd[] = {Jim_NewStringObj(itp, "error", -1), Jim_GetResult(itp)};
+            script = Jim_NewListObj(itp, errorCmd, 2);
+        }
+        Jim_Obj* afterCmd[] = {Jim_NewStringObj(itp, "after", -1), Jim_NewStringObj(itp, "idle", -1), script};
+        Jim_EvalObjVector(itp, 3, afterCmd);
+        freeAsyncJob(itp, job);
+        job = next;
+    }
+    Jim_SetEmptyResult(itp);
     return JIM_OK;
 }
 
-// prepMetaBlob builds or updates a metadata binary structure, storing it in the given variable.
-// it makes all preparations necessary for a series of callToNative for one native function.
-// after any of the metadata passed into prepMetaBlob has been touched by script,
-// script must call prepMetaBlob again to update the metaBlob.
-// failure to do that will probably crash the interp, or corrupt it.
-// (the contents of the native parameter variables themselves are not subject to that,
-// since those are not passed to prepMetaBlob.
-// instead their contents are assumed to be different for each callToNative.)
-// likewise, failure to prepMetaBlob before the first callToNative will probably
-// crash the interp, or corrupt it.
-// prepMetaBlob mainly converts type codes to type pointers, so it can call ffi_prep_cif.
-int prepMetaBlob(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+// stops the pool's workers, and frees it.  calls already running are allowed to finish first.
+void deleteAsyncPool(Jim_Interp* itp, void* poolP) {
+    asyncPoolT* pool = (asyncPoolT*)poolP;
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (int w = 0; w < pool->nWorkers; w++)
+        pthread_join(pool->workers[w], NULL);
+
+    for (asyncJobT* job = pool->pending; job != NULL; ) {
+        asyncJobT* next = job->next;
+        freeAsyncJob(itp, job);
+        job = next;
+    }
+    for (asyncJobT* job = pool->finished; job != NULL; ) {
+        asyncJobT* next = job->next;
+        freeAsyncJob(itp, job);
+        job = next;
+    }
+    close(pool->pipeFds[0]);
+    close(pool->pipeFds[1]);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    Jim_Free(pool->workers);
+    Jim_Free(pool);
+}
+
+// returns the interpreter's async pool, starting it with the given number of workers if needed.
+asyncPoolT* getAsyncPool(Jim_Interp* itp, int nWorkers) {
+    asyncPoolT* pool = (asyncPoolT*)Jim_GetAssocData(itp, ASYNC_POOL_KEY);
+    if (pool != NULL) return pool;
+
+    pool = Jim_Alloc(sizeof(asyncPoolT));
+    memset(pool, 0, sizeof(asyncPoolT));
+    if (pipe(pool->pipeFds) != 0) {
+        Jim_Free(pool);
+        Jim_SetResultString(itp, "Failed to create pipe for async calls.", -1);
+        return NULL;
+    }
+    fcntl(pool->pipeFds[0], F_SETFL, O_NONBLOCK);
+    fcntl(pool->pipeFds[1], F_SETFL, O_NONBLOCK);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pool->pendingTail = &pool->pending;
+    pool->finishedTail = &pool->finished;
+    pool->workers = Jim_Alloc(nWorkers * sizeof(pthread_t));
+    for ( ; pool->nWorkers < nWorkers; pool->nWorkers++) {
+        if (pthread_create(&pool->workers[pool->nWorkers], NULL, asyncWorker, pool) != 0) break;
+    }
+    if (pool->nWorkers == 0) {
+        deleteAsyncPool(itp, pool);
+        Jim_SetResultString(itp, "Failed to start any async worker threads.", -1);
+        return NULL;
+    }
+    Jim_CreateFileHandler(itp, pool->pipeFds[0], JIM_EVENT_READABLE, asyncReadable, pool, NULL);
+    Jim_SetAssocData(itp, ASYNC_POOL_KEY, deleteAsyncPool, pool);
+    return pool;
+}
+
+// queues one call to the function described by the metaBlob, on the interpreter's async worker pool,
+// and returns immediately.  argList gives a value for every parm, the same as one tuple for callBatch.
+// when the call finishes, the event loop evaluates the callback command prefix, with the result
+// appended, also the same as for callBatch.  the pool is started with the given number of workers
+// at the first async call.  after that, the number is ignored.
+// requires a marshaling plan with no script converters.
+int callAsync(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
     enum {
         cmdIX = 0,
         metaBlobVarNameIX,
-        fnPIX,
-        returnTypeVarNameIX,
-        nativeParmsListIX,
-        parmTypeVarNameListIX,
-        parmFlagsListIX,
+        argListIX,
+        callbackIX,
+        workersIX,
         argCount
     };
 
     if (objc != argCount) {
-        Jim_SetResultString(itp, "Wrong # args.", -1);
+        Jim_SetResultString(itp, "Wrong # args.  Should be: callAsync metaBlobVarName argList callback workers", -1);
         return JIM_ERR;
     }
 
-    Jim_Obj* flagsList = objv[parmFlagsListIX];
-    int isGIcall = Jim_ListLength(itp, flagsList) > 0;
-
-    // create buffer variable for metablob.  first we must determine its final size.
-    int nArgs = Jim_ListLength(itp, objv[nativeParmsListIX]);
-    // in this calculation there's sizeof(ffi_type*) bytes of waste.  don't care.
-    int blobLen = sizeof(metaBlobT) + nArgs * sizeof(ffi_type*) + nArgs * sizeof(dlrFlagsT);
-    metaBlobT* meta;
-    if (createBufferVarNative(itp, objv[metaBlobVarNameIX], blobLen, (void**)&meta, NULL) != JIM_OK) return JIM_ERR;
-    memset(meta, 0, sizeof(metaBlobT)); // initialize to zeros because this structure now has optional parts e.g. for gizmo.
-    *(u32*)meta->signature = *(u32*)METABLOB_SIGNATURE;
-    meta->signature[4] = 0; // string safety.
-
-    // memorize function pointer.
-    jim_wide fnP = 0;
-    if (Jim_GetWide(itp, objv[fnPIX], &fnP) != JIM_OK) {
-        Jim_SetResultString(itp, "Expected function pointer but got other data.", -1);
+    Jim_Obj* metaBlobObj = Jim_GetVariable(itp, objv[metaBlobVarNameIX], JIM_NONE);
+    if (metaBlobObj == NULL) {
+        Jim_SetResultString(itp, "MetaBlob variable not found.", -1);
         return JIM_ERR;
     }
-    if (fnP == 0) {
-        Jim_SetResultString(itp, "Null function pointer.", -1);
+    metaBlobT* meta = objToMeta(metaBlobObj);
+    if (meta == NULL) {
+        Jim_SetResultString(itp, "Invalid metaBlob content.", -1);
         return JIM_ERR;
     }
+    int hasOuts = 0;
+    if (checkBatchPlan(itp, meta, &hasOuts) != JIM_OK) return JIM_ERR;
 
-    // gather return-value metadata.
-    ffi_type* rtype = NULL;
-    if (varToTypeP(itp, objv[returnTypeVarNameIX], &rtype) != JIM_OK) return JIM_ERR;
-
-    // gather parm metadata.
-    meta->nativeParmsList = objv[nativeParmsListIX];
-    Jim_Obj* typesList = objv[parmTypeVarNameListIX];
-    if (nArgs != Jim_ListLength(itp, typesList)) {
-        Jim_SetResultString(itp, "List lengths don't match.", -1);
+    jim_wide nWorkers = 0;
+    if (Jim_GetWide(itp, objv[workersIX], &nWorkers) != JIM_OK || nWorkers < 1) {
+        Jim_SetResultString(itp, "Expected worker count but got other data.", -1);
         return JIM_ERR;
     }
-    if (isGIcall && nArgs != Jim_ListLength(itp, flagsList)) {
-        Jim_SetResultString(itp, "List lengths don't match.", -1);
+    asyncPoolT* pool = getAsyncPool(itp, (int)nWorkers);
+    if (pool == NULL) return JIM_ERR;
+
+    // snapshot the arguments in native form.
+    asyncJobT* job = Jim_Alloc(sizeof(asyncJobT));
+    newBatch(&job->batch, meta, 1, NULL);
+    job->hasOuts = hasOuts;
+    job->metaBlobObj = metaBlobObj;
+    job->callback = objv[callbackIX];
+    Jim_IncrRefCount(job->metaBlobObj);
+    Jim_IncrRefCount(job->callback);
+    if (packBatchTuple(itp, &job->batch, 0, objv[argListIX], 0) != JIM_OK) {
+        freeAsyncJob(itp, job);
         return JIM_ERR;
     }
-    ffi_type** t = &meta->atypes; // now t can be treated as the types array at the end of the struct.
-    for (int n = 0; n < nArgs; n++) {
-        Jim_Obj* typeVar = Jim_ListGetIndex(itp, typesList, n);
-        if (varToTypeP(itp, typeVar, &t[n]) != JIM_OK) return JIM_ERR;
+
+    pthread_mutex_lock(&pool->lock);
+    job->next = NULL;
+    *pool->pendingTail = job;
+    pool->pendingTail = &job->next;
+    pthread_cond_signal(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    Jim_SetEmptyResult(itp);
+    return JIM_OK;
+}
+
+// callbacks let native code call script, through a libffi closure.  each callback type
+// (a function signature) has its own pool command, holding a pool of closures all prepared
+// for that signature.  acquiring one only binds it to a script command prefix.  releasing it
+// returns it to the pool for reuse.  so creating and destroying callbacks in a loop
+// costs no allocation or re-preparation.
+// inbound arguments are converted by C for scalars.  others are passed to the parm's unpacker
+// converter, either as packed native bytes, or as a pointer integer, the same way as return values.
+typedef enum {
+    CK_SCALAR = 0,  // unpacked in C.
+    CK_BYTES,       // unpacker receives the packed native value.
+    CK_POINTER      // unpacker receives the pointer as an integer, like a scriptPtr unpacker.
+} callbackKindT;
+static const char * const callbackKindNames[] = {"scalar", "bytes", "pointer", NULL};
+
+// index of each field in a callback parm's plan, from script.
+enum {
+    CB_kindIX = 0,
+    CB_typeCodeIX,
+    CB_unpackerIX,
+    CB_STRIDE
+};
+
+struct callbackTypeT;
+
+typedef struct callbackSlotT {
+    struct callbackSlotT* next;
+    struct callbackTypeT* cbType;
+    ffi_closure* closure;
+    void* code; // the function pointer native code calls.
+    Jim_Obj* cmdPrefix; // or NULL when the slot is free.
+} callbackSlotT;
+
+typedef struct callbackTypeT {
+    Jim_Interp* itp;
+    pthread_t thread; // the interpreter's thread.  callbacks from other threads are refused.
+    ffi_cif cif;
+    Jim_Obj* planList; // referenced for the unpacker names it holds.
+    int returnTypeCode; // FFI_TYPE_VOID or a scalar type.
+    callbackSlotT* free;
+    callbackSlotT* inUse;
+    u8* kinds; // points directly beyond the atypes array.
+    ffi_type* atypes[]; // followed by the kinds array.
+} callbackTypeT;
+
+// packs a callback's return value, widening small integers to a whole ffi_arg as libffi requires.
+int packCallbackReturn(Jim_Interp* itp, int typeCode, Jim_Obj* value, void* ret) {
+    scalarT s;
+    if (packScalar(itp, typeCode, value, &s) != JIM_OK) return JIM_ERR;
+    #define WIDEN(narrowT, wideT) { narrowT v; memcpy(&v, &s, sizeof(v)); *(wideT*)ret = v; } break;
+    switch (typeCode) {
+        case FFI_TYPE_UINT8:    WIDEN(u8, ffi_arg)
+        case FFI_TYPE_SINT8:    WIDEN(i8, ffi_sarg)
+        case FFI_TYPE_UINT16:   WIDEN(u16, ffi_arg)
+        case FFI_TYPE_SINT16:   WIDEN(i16, ffi_sarg)
+        case FFI_TYPE_UINT32:   WIDEN(u32, ffi_arg)
+        case FFI_TYPE_SINT32:   WIDEN(i32, ffi_sarg)
+        case FFI_TYPE_FLOAT:    *(float*)ret = s.f; break;
+        case FFI_TYPE_DOUBLE:   *(double*)ret = s.d; break;
+        case FFI_TYPE_LONGDOUBLE: *(long double*)ret = s.ld; break;
+        case FFI_TYPE_POINTER:  *(void**)ret = s.p; break;
+        default:                memcpy(ret, &s, sizeof(u64)); break;
     }
-#ifdef BUILD_GIZMO
-    if (isGIcall) {
-        meta->giInfo = (GIFunctionInfo*)fnP;
-        meta->aFlags = (dlrFlagsT*)((u8*)meta + sizeof(metaBlobT) + nArgs * sizeof(ffi_type*)); // aflags array lies directly beyond the atypes array.
-        meta->nInArgs = 0;
-        meta->nOutArgs = 0;
-        for (int n = 0; n < nArgs; n++) {
-            jim_wide flags;
-            if (Jim_GetWide(itp, Jim_ListGetIndex(itp, flagsList, n), &flags) != JIM_OK) {
-                Jim_SetResultString(itp, "Expected parm flags integer but got other data.", -1);
+    #undef WIDEN
+    return JIM_OK;
+}
+
+// libffi calls this when native code calls any closure.  it evaluates the closure's
+// command prefix with the unpacked arguments appended, and packs its result as the return value.
+void callbackHandler(ffi_cif* cif, void* ret, void** args, void* slotP) {
+    callbackSlotT* slot = (callbackSlotT*)slotP;
+    callbackTypeT* cbType = slot->cbType;
+    Jim_Interp* itp = cbType->itp;
+    if (cif->rtype != &ffi_type_void)
+        memset(ret, 0, cif->rtype->size > sizeof(ffi_arg)  ?  cif->rtype->size  :  sizeof(ffi_arg));
+    // Jim can't be entered from any other thread.  there's nowhere to report that either.
+    if ( ! pthread_equal(pthread_self(), cbType->thread)) return;
+    if (slot->cmdPrefix == NULL) {
+        holdCallbackError(itp, Jim_NewStringObj(itp, "Native code called a callback after it was released.", -1));
+        return;
+    }
+
+    Jim_Obj** unpackers = cbType->planList->internalRep.listValue.ele;
+    Jim_Obj* cmd = Jim_DuplicateObj(itp, slot->cmdPrefix);
+    Jim_IncrRefCount(cmd);
+    for (unsigned n = 0; n < cif->nargs; n++) {
+        Jim_Obj* value = NULL;
+        if (cbType->kinds[n] == CK_SCALAR) {
+            value = unpackScalar(itp, cif->arg_types[n]->type, args[n]);
+        } else {
+            Jim_Obj* unpackCmd[2] = {unpackers[n * CB_STRIDE + CB_unpackerIX], NULL};
+            unpackCmd[1] = cbType->kinds[n] == CK_BYTES
+                ?  Jim_NewStringObj(itp, (char*)args[n], cif->arg_types[n]->size)
+                :  Jim_NewIntObj(itp, (jim_wide)*(void**)args[n]);
+            if (Jim_EvalObjVector(itp, 2, unpackCmd) != JIM_OK) {
+                holdCallbackError(itp, Jim_GetResult(itp));
+                Jim_DecrRefCount(itp, cmd);
+                return;
+            }
+            value = Jim_GetResult(itp);
+        }
+        Jim_ListAppendElement(itp, cmd, value);
+    }
+
+    if (Jim_EvalObj(itp, cmd) != JIM_OK) {
+        holdCallbackError(itp, Jim_GetResult(itp));
+    } else if (cbType->returnTypeCode != FFI_TYPE_VOID) {
+        if (packCallbackReturn(itp, cbType->returnTypeCode, Jim_GetResult(itp), ret) != JIM_OK)
+            holdCallbackError(itp, Jim_GetResult(itp));
+    }
+    Jim_DecrRefCount(itp, cmd);
+}
+
+// allocates and prepares one more closure for the callback type.  returns NULL on failure.
+callbackSlotT* newCallbackSlot(callbackTypeT* cbType) {
+    callbackSlotT* slot = Jim_Alloc(sizeof(callbackSlotT));
+    slot->cbType = cbType;
+    slot->cmdPrefix = NULL;
+    slot->closure = ffi_closure_alloc(sizeof(ffi_closure), &slot->code);
+    if (slot->closure == NULL) {
+        Jim_Free(slot);
+        return NULL;
+    }
+    if (ffi_prep_closure_loc(slot->closure, &cbType->cif, callbackHandler, slot, slot->code) != FFI_OK) {
+        ffi_closure_free(slot->closure);
+        Jim_Free(slot);
+        return NULL;
+    }
+    return slot;
+}
+
+void freeCallbackSlots(Jim_Interp* itp, callbackSlotT* slot) {
+    while (slot != NULL) {
+        callbackSlotT* next = slot->next;
+        if (slot->cmdPrefix != NULL) Jim_DecrRefCount(itp, slot->cmdPrefix);
+        ffi_closure_free(slot->closure);
+        Jim_Free(slot);
+        slot = next;
+    }
+}
+
+// frees the callback type and all its closures.  any native code still holding one
+// of its function pointers must not call it after this.
+void deleteCallbackType(Jim_Interp* itp, void* privData) {
+    callbackTypeT* cbType = (callbackTypeT*)privData;
+    freeCallbackSlots(itp, cbType->free);
+    freeCallbackSlots(itp, cbType->inUse);
+    Jim_DecrRefCount(itp, cbType->planList);
+    Jim_Free(cbType);
+}
+
+// the pool command of a callback type.  its subcommands are:
+//   acquire cmdPrefix
+//      binds a closure to the command prefix, and returns its native function pointer, as an integer.
+//   release fnPointer
+//      returns the closure to the pool.
+int callbackPool(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    static const char * const subcmds[] = {"acquire", "release", NULL};
+    enum {SC_ACQUIRE, SC_RELEASE};
+    callbackTypeT* cbType = (callbackTypeT*)Jim_CmdPrivData(itp);
+    int subcmd = 0;
+    if (objc != 3) {
+        Jim_SetResultString(itp, "Wrong # args.  Should be: pool acquire cmdPrefix  -or-  pool release fnPointer", -1);
+        return JIM_ERR;
+    }
+    if (Jim_GetEnum(itp, objv[1], subcmds, &subcmd, "subcommand", JIM_ERRMSG) != JIM_OK) return JIM_ERR;
+
+    if (subcmd == SC_ACQUIRE) {
+        callbackSlotT* slot = cbType->free;
+        if (slot != NULL) {
+            cbType->free = slot->next;
+        } else {
+            slot = newCallbackSlot(cbType);
+            if (slot == NULL) {
+                Jim_SetResultString(itp, "Failed to allocate a closure for the callback.", -1);
                 return JIM_ERR;
             }
-            meta->aFlags[n] = (dlrFlagsT)flags;
-            if (flags & DF_DIR_IN) meta->nInArgs++;
-            if (flags & DF_DIR_OUT) meta->nOutArgs++;
         }
-    } else {
-        meta->fn = (ffiFnP)fnP;
+        slot->cmdPrefix = objv[2];
+        Jim_IncrRefCount(slot->cmdPrefix);
+        slot->next = cbType->inUse;
+        cbType->inUse = slot;
+        Jim_SetResult(itp, newPointerObj(itp, (void*)slot->code, 0));
+        return JIM_OK;
     }
-//todo: unref when this metablob destroyed.
-//    g_base_info_unref (base_info);
-// and the repo as well?
-#else
-    meta->fn = (ffiFnP)fnP;
-#endif
 
-    // prep CIF.
-    // this will also set the .size of any structure types used here.
-    ffi_status err = ffi_prep_cif(&meta->cif, FFI_DEFAULT_ABI, (unsigned int)nArgs, rtype, &meta->atypes);
-    if (err != FFI_OK) {
-        Jim_SetResultString(itp, "Failed to prep FFI CIF structure for call.", -1);
+    jim_wide code = 0;
+    if (Jim_GetWide(itp, objv[2], &code) != JIM_OK) {
+        Jim_SetResultString(itp, "Expected callback function pointer but got other data.", -1);
         return JIM_ERR;
     }
-
-    if (rtype == &ffi_type_void) {
-        meta->returnSizePadded = 0;
-    } else {
-        // calculate padding of return value AFTER ffi_prep_cif(), since that's where
-        // rtype->size is computed if rtype is a struct type.
-        meta->returnSizePadded = rtype->size;
-        // FFI requires padding the return variable up to sizeof(ffi_arg).
-        if (meta->returnSizePadded < sizeof(ffi_arg))
-            meta->returnSizePadded = sizeof(ffi_arg);
+    for (callbackSlotT** linkP = &cbType->inUse; *linkP != NULL; linkP = &(*linkP)->next) {
+        callbackSlotT* slot = *linkP;
+        if ((jim_wide)slot->code != code) continue;
+        *linkP = slot->next;
+        Jim_DecrRefCount(itp, slot->cmdPrefix);
+        slot->cmdPrefix = NULL;
+        slot->next = cbType->free;
+        cbType->free = slot;
+        Jim_SetEmptyResult(itp);
+        return JIM_OK;
     }
-
-    return JIM_OK;
+    Jim_SetResultString(itp, "Callback function pointer isn't in use in this pool.", -1);
+    return JIM_ERR;
 }
 
-int callToNative(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+// creates the pool command for a callback type, and preallocates some closures.
+// parmPlanList has CB_STRIDE elements per parm:  kind, ffi type code, unpacker.
+int prepCallbackType(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
     enum {
         cmdIX = 0,
-        metaBlobVarNameIX,
+        poolCmdNameIX,
+        returnTypeVarNameIX,
+        parmTypeVarNameListIX,
+        parmPlanListIX,
+        preallocIX,
         argCount
     };
 
     if (objc != argCount) {
-        Jim_SetResultString(itp, "Wrong # args.  Should be: callToNative metaBlobVarName", -1);
+        Jim_SetResultString(itp, "Wrong # args.  Should be: prepCallbackType poolCmdName returnTypeVarName parmTypeVarNameList parmPlanList prealloc", -1);
         return JIM_ERR;
     }
 
-    // find metaBlob for this native function.
-    Jim_Obj* metaBlobObj = Jim_GetVariable(itp, objv[metaBlobVarNameIX], JIM_NONE);
-    if (metaBlobObj == NULL) {
-        Jim_SetResultString(itp, "MetaBlob variable not found.", -1);
+    Jim_Obj* typesList = objv[parmTypeVarNameListIX];
+    Jim_Obj* planList = objv[parmPlanListIX];
+    int nArgs = Jim_ListLength(itp, typesList);
+    if (Jim_ListLength(itp, planList) != nArgs * CB_STRIDE) {
+        Jim_SetResultString(itp, "Callback plan length doesn't match the parms.", -1);
         return JIM_ERR;
     }
-    // Jim_GetString() not used here.  we can detect an invalid metablob without it, and faster.
-    metaBlobT* meta = (metaBlobT*)metaBlobObj->bytes;
-    if (meta == NULL || *(u32*)meta->signature != *(u32*)METABLOB_SIGNATURE) {
-        Jim_SetResultString(itp, "Invalid metaBlob content.", -1);
+    jim_wide prealloc = 0;
+    if (Jim_GetWide(itp, objv[preallocIX], &prealloc) != JIM_OK) {
+        Jim_SetResultString(itp, "Expected preallocation count but got other data.", -1);
         return JIM_ERR;
     }
 
-    // fill argPtrs with pointers to the content of designated script vars.
-    // those objects have the buffers for the packed native binary content during this native call.
-    // their content has probably moved to a new address since the last call,
-    // and their Jim_Obj's replaced with new ones,
-    // because the script assigned them new values since then.
-    unsigned nArgs = meta->cif.nargs;
-    void* argPtrs[nArgs];
-    for (unsigned n = 0; n < nArgs; n++) {
-        // look up the designated variable, in a global context.
-        // using internalRep of the parms list here for a little more speed.
-        Jim_Obj* varName = meta->nativeParmsList->internalRep.listValue.ele[n];
-        // this must use Jim_GetVariable(), not Jim_GetGlobalVariable(), to support asNative.
-        Jim_Obj* v = Jim_GetVariable(itp, varName, JIM_NONE);
-        if (v == NULL) {
-            Jim_SetResultFormatted(itp, "Native argument variable not found: %#s", varName);
-            return JIM_ERR;
-        }
-        // const is discarded here.  that is required, to be able to pass an argument by pointer
-        // either in or out of a native function.  that is required for large data.
-        argPtrs[n] = (void*)Jim_GetString(v, NULL);
-        // safety check.
-        // we'll let it slide here if the script allocated just enough bytes for the value,
-        // and no extra byte for a null terminator.  not all parms are strings.
-        if (argPtrs[n] == NULL || v->length < meta->cif.arg_types[n]->size) {
-            Jim_SetResultFormatted(itp, "Inadequate buffer in argument variable: %#s", varName);
-            return JIM_ERR;
-        }
-    }
+    callbackTypeT* cbType = Jim_Alloc(sizeof(callbackTypeT) + nArgs * sizeof(ffi_type*) + nArgs);
+    memset(cbType, 0, sizeof(callbackTypeT));
+    cbType->itp = itp;
+    cbType->thread = pthread_self();
+    cbType->kinds = (u8*)&cbType->atypes[nArgs];
 
-    /* how to trace certain native calls.
-    if (meta->fn == (ffiFnP)g_irepository_require) {
-        printf("require     %p '%s' '%s'\n", *(void**)argPtrs[0], *(char**)argPtrs[1], *(char**)argPtrs[2]);
+    ffi_type* rtype = NULL;
+    if (varToTypeP(itp, objv[returnTypeVarNameIX], &rtype) != JIM_OK) goto fail;
+    cbType->returnTypeCode = rtype->type;
+    for (int n = 0; n < nArgs; n++) {
+        if (varToTypeP(itp, Jim_ListGetIndex(itp, typesList, n), &cbType->atypes[n]) != JIM_OK) goto fail;
+        int kind = 0;
+        if (Jim_GetEnum(itp, Jim_ListGetIndex(itp, planList, n * CB_STRIDE + CB_kindIX), callbackKindNames, &kind, "callback parm kind", JIM_ERRMSG) != JIM_OK) goto fail;
+        cbType->kinds[n] = (u8)kind;
     }
-    if (meta->fn == (ffiFnP)g_irepository_get_n_infos) {
-        printf("get_n_infos %p '%s'\n", *(void**)argPtrs[0], *(char**)argPtrs[1]);
+    if (ffi_prep_cif(&cbType->cif, FFI_DEFAULT_ABI, (unsigned int)nArgs, rtype, cbType->atypes) != FFI_OK) {
+        Jim_SetResultString(itp, "Failed to prep FFI CIF structure for callback.", -1);
+        goto fail;
     }
-    */
-
-    if (meta->cif.rtype == &ffi_type_void) {
-        // arrange space for a junk return value, just in case libffi decides to write one.
-        ffi_arg rtn;
-
-        // execute call.
-        ffi_call(&meta->cif, meta->fn, &rtn, argPtrs);
-        Jim_SetEmptyResult(itp);
-    } else {
-        // arrange space for return value.
-        void* resultBuf = NULL;
-        Jim_Obj* resultObj = NULL;
-        if (createBufferObj(itp, meta->returnSizePadded, &resultBuf, &resultObj) != JIM_OK) return JIM_ERR;
-
-        // execute call.
-        ffi_call(&meta->cif, meta->fn, resultBuf, argPtrs);
-        Jim_SetResult(itp, resultObj);
+    cbType->planList = planList;
+    Jim_IncrRefCount(cbType->planList);
+
+    for (jim_wide n = 0; n < prealloc; n++) {
+        callbackSlotT* slot = newCallbackSlot(cbType);
+        if (slot == NULL) break;
+        slot->next = cbType->free;
+        cbType->free = slot;
     }
 
-    //todo: optionally check for errors, in the ways offered by the most common libs.
-    //todo: optionally call a custom error checking function.
+    Jim_CreateCommand(itp, Jim_String(objv[poolCmdNameIX]), callbackPool, cbType, deleteCallbackType);
     return JIM_OK;
+
+fail:
+    Jim_Free(cbType);
+    return JIM_ERR;
 }
 
 #ifdef BUILD_GIZMO
@@ -709,7 +4425,7 @@ int giCallToNative(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
     // their content has probably moved to a new address since the last call,
     // and their Jim_Obj's replaced with new ones,
     // because the script assigned them new values since then.
-    unsigned nArgs = meta->cif.nargs;
+    unsigned nArgs = meta->cif->nargs;
     GIArgument inArgs[meta->nInArgs];
     unsigned inArgPos = 0;
     GIArgument outArgs[meta->nOutArgs];
@@ -737,7 +4453,7 @@ int giCallToNative(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
         //// safety check.
         //// we'll let it slide here if the script allocated just enough bytes for the value,
         //// and no extra byte for a null terminator.  not all parms are strings.
-        //if (argPtrs[n] == NULL || v->length < meta->cif.arg_types[n]->size) {
+        //if (argPtrs[n] == NULL || v->length < meta->cif->arg_types[n]->size) {
             //Jim_SetResultFormatted(itp, "Inadequate buffer in argument variable: %#s", varName);
             //return JIM_ERR;
         //}
@@ -813,11 +4529,34 @@ int packerSetup_byVal(Jim_Interp* itp, int objc, Jim_Obj * const objv[],
     }
     int requiredLen = offset + sizeBytes;
 
-    Jim_Obj* v = Jim_GetVariable(itp, objv[pk_packVarNameIX], JIM_NONE);
-    if (v == NULL || v->bytes == NULL || v->length < requiredLen) {
-        if (createBufferVarNative(itp, objv[pk_packVarNameIX], sizeBytes, NULL, &v) != JIM_OK) return JIM_ERR;
+    packCursorT* c = activeCursor(itp);
+    if (c != NULL && objv[pk_packVarNameIX] == c->token) {
+        if (cursorClaim(itp, c, offset, sizeBytes, bufP) != JIM_OK) return JIM_ERR;
+    } else {
+        Jim_Obj* v = Jim_GetVariable(itp, objv[pk_packVarNameIX], JIM_NONE);
+        u8* vBytes = NULL;
+        int vLen = 0;
+        if (v != NULL && (isNativeBuffer(v) || v->bytes != NULL))
+            vBytes = bufferBytesForWrite(v, &vLen);
+        if (vBytes == NULL || vLen < requiredLen) {
+            // grow the buffer, keeping any fields packed there earlier.
+            Jim_Obj* grown = NULL;
+            void* grownBuf = NULL;
+            if (createBufferObj(itp, requiredLen, &grownBuf, &grown) != JIM_OK) return JIM_ERR;
+            memset(grownBuf, 0, requiredLen);
+            if (v != NULL) {
+                int oldLen = 0;
+                const u8* oldBytes = bufferBytes(v, &oldLen);
+                memcpy(grownBuf, oldBytes, oldLen < requiredLen ? oldLen : requiredLen);
+            }
+            if (Jim_SetVariable(itp, objv[pk_packVarNameIX], grown) != JIM_OK) {
+                Jim_SetResultString(itp, "Failed to set variable for buffer.", -1);
+                return JIM_ERR;
+            }
+            vBytes = (u8*)grownBuf;
+        }
+        *bufP = (void*)(vBytes + offset);
     }
-    *bufP = (void*)((u8*)v->bytes + offset);
 
     if (objc > pk_nextOffsetVarNameIX) {
         // memorize the offset for the next operation after this one.
@@ -920,6 +4659,16 @@ int i64_pack_byVal_asInt(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
     return JIM_OK;
 }
 
+// reads a pointer object without parsing, and accepts the null pointer flag as NULL.
+int ptr_pack_byVal_asInt(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    void** buf = NULL;
+    if (packerSetup_byVal(itp, objc, objv, sizeof(void*), (void**)&buf) != JIM_OK) return JIM_ERR;
+    void* p = NULL;
+    if (getPointer(itp, objv[pk_unpackedDataIX], &p) != JIM_OK) return JIM_ERR;
+    *buf = p;
+    return JIM_OK;
+}
+
 int double_pack_byVal_asDouble(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
     double* buf = NULL;
     if (packerSetup_byVal(itp, objc, objv, sizeof(double), (void**)&buf) != JIM_OK) return JIM_ERR;
@@ -962,48 +4711,23 @@ int ascii_pack_byVal_asString(Jim_Interp* itp, int objc, Jim_Obj * const objv[])
     return JIM_OK;
 }
 
+// pack-null takes no data value, so its args are shifted to packerSetup_byVal's places.
+// the command name stands in for the data value there.  it's never used.
+//   pack-null packVarName ?offsetBytes? ?nextOffsetVarName?
 int pack_null(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
-    enum {
-        cmdIX = 0,
-        packVarNameIX,
-        offsetBytesIX,
-        nextOffsetVarNameIX,
-        argCount
-    };
-
-    if (objc > argCount || objc < offsetBytesIX) {
+    if (objc > pk_argCount - 1 || objc < pk_unpackedDataIX) {
         Jim_SetResultString(itp, "Wrong # args.", -1);
         return JIM_ERR;
     }
-
-    jim_wide offset = 0;
-    if (objc > offsetBytesIX) {
-        if (Jim_GetWide(itp, objv[offsetBytesIX], &offset) != JIM_OK) {
-            Jim_SetResultString(itp, "Expected offset integer but got other data.", -1);
-            return JIM_ERR;
-        }
-        if (offset < 0) {
-            Jim_SetResultString(itp, "Offset cannot be negative.", -1);
-            return JIM_ERR;
-        }
-    }
-    const int sizeBytes = sizeof(void*);
-    int requiredLen = offset + sizeBytes;
-
-    Jim_Obj* v = Jim_GetVariable(itp, objv[packVarNameIX], JIM_NONE);
-    if (v == NULL || v->bytes == NULL || v->length < requiredLen) {
-        if (createBufferVarNative(itp, objv[packVarNameIX], sizeBytes, NULL, &v) != JIM_OK) return JIM_ERR;
-    }
-    void** bufP = (void**)((u8*)v->bytes + offset);
-
-    if (objc > nextOffsetVarNameIX) {
-        // memorize the offset for the next operation after this one.
-        if (Jim_SetVariable(itp, objv[nextOffsetVarNameIX], Jim_NewIntObj(itp, requiredLen)) != JIM_OK) {
-            Jim_SetResultString(itp, "Failed to memorize next offset.", -1);
-            return JIM_ERR;
-        }
-    }
-
+    Jim_Obj* args[pk_argCount];
+    args[pk_cmdIX] = objv[0];
+    args[pk_packVarNameIX] = objv[1];
+    args[pk_unpackedDataIX] = objv[0];
+    for (int n = pk_unpackedDataIX; n < objc; n++)
+        args[n + 1] = objv[n];
+
+    void** bufP = NULL;
+    if (packerSetup_byVal(itp, objc + 1, args, sizeof(void*), (void**)&bufP) != JIM_OK) return JIM_ERR;
     *bufP = NULL;
     return JIM_OK;
 }
@@ -1037,8 +4761,9 @@ int unpackerSetup_byVal(Jim_Interp* itp, int objc, Jim_Obj * const objv[],
     }
     int requiredLen = offset + sizeBytes;
 
-    Jim_Obj* v = objv[packedValueIX];
-    if (v->bytes == NULL || v->length < requiredLen) {
+    int vLen = 0;
+    u8* vBytes = bufferBytes(objv[packedValueIX], &vLen);
+    if (vLen < requiredLen) {
         Jim_SetResultString(itp, "Packed value is too short.", -1);
         return JIM_ERR;
     }
@@ -1051,7 +4776,7 @@ int unpackerSetup_byVal(Jim_Interp* itp, int objc, Jim_Obj * const objv[],
         }
     }
 
-    *bufP = (void*)((u8*)v->bytes + offset);
+    *bufP = (void*)(vBytes + offset);
     return JIM_OK;
 }
 
@@ -1069,14 +4794,7 @@ int unpackerSetup_scriptPtr(Jim_Interp* itp, int objc, Jim_Obj * const objv[],
         return JIM_ERR;
     }
 
-    jim_wide p = 0;
-    if (Jim_GetWide(itp, objv[pointerIntValueIX], &p) != JIM_OK) {
-        Jim_SetResultString(itp, "Expected pointer integer but got other data.", -1);
-        return JIM_ERR;
-    }
-
-    *bufP = (void*)p;
-    return JIM_OK;
+    return getPointer(itp, objv[pointerIntValueIX], bufP);
 }
 
 int u8_unpack_byVal_asInt(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
@@ -1135,6 +4853,13 @@ int i64_unpack_byVal_asInt(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
     return JIM_OK;
 }
 
+int ptr_unpack_byVal_asInt(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    void** buf = NULL;
+    if (unpackerSetup_byVal(itp, objc, objv, sizeof(void*), (void**)&buf) != JIM_OK) return JIM_ERR;
+    Jim_SetResult(itp, newPointerObj(itp, *buf, 0));
+    return JIM_OK;
+}
+
 int float_unpack_byVal_asDouble(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
     float* buf = NULL;
     if (unpackerSetup_byVal(itp, objc, objv, sizeof(float), (void**)&buf) != JIM_OK) return JIM_ERR;
@@ -1156,11 +4881,16 @@ int longDouble_unpack_byVal_asDouble(Jim_Interp* itp, int objc, Jim_Obj * const
     return JIM_OK;
 }
 
+// the string ends at its null terminator, or at the end of the packed value, whichever is first.
+// so an unterminated buffer is safe to read.
 int ascii_unpack_byVal_asString(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
     char* buf = NULL;
     if (unpackerSetup_byVal(itp, objc, objv, 0, (void**)&buf) != JIM_OK) return JIM_ERR;
-    //todo: limit to a certain max length here for safety.  have the lib's binding script fetch that from metadata and pass it to here.
-    Jim_SetResultString(itp, buf, -1);
+    int vLen = 0;
+    u8* vBytes = bufferBytes(objv[1], &vLen);
+    int maxLen = vLen - (int)((u8*)buf - vBytes);
+    const char* end = memchr(buf, 0, maxLen);
+    Jim_SetResultString(itp, buf, end == NULL  ?  maxLen  :  (int)(end - buf));
     return JIM_OK;
 }
 
@@ -1178,6 +4908,376 @@ int ascii_unpack_scriptPtr_asString(Jim_Interp* itp, int objc, Jim_Obj * const o
     return JIM_OK;
 }
 
+// unpacks a string of known length, or of at most a given length, from a native pointer.
+// with a known length, such as the byte count reported by a read()-style function,
+// the string isn't scanned at all; any nulls within it are kept.  with a maximum length,
+// the string ends at its null terminator or at that length, so a buffer that's never
+// terminated is safe to read.  memchr() does that scan much faster than a byte loop.
+// either way the script value is built in one allocation.
+// a negative length gives an empty string, since that's typically an error return from the
+// function that reported the length.  a null pointer gives the null pointer flag.
+// this does involve making a copy, so it's OK (and often best) for the script to
+// free the pointer immediately after this.
+int unpackBoundedString(Jim_Interp* itp, int objc, Jim_Obj * const objv[], int exact) {
+    enum {
+        cmdIX = 0,
+        pointerIntValueIX,
+        lengthIX,
+        argCount
+    };
+
+    if (objc != argCount) {
+        Jim_SetResultString(itp, "Wrong # args.", -1);
+        return JIM_ERR;
+    }
+    void* p = NULL;
+    if (getPointer(itp, objv[pointerIntValueIX], &p) != JIM_OK) return JIM_ERR;
+    jim_wide len = 0;
+    if (Jim_GetWide(itp, objv[lengthIX], &len) != JIM_OK) {
+        Jim_SetResultString(itp, "Expected length integer but got other data.", -1);
+        return JIM_ERR;
+    }
+    if (len > INT32_MAX) {
+        Jim_SetResultString(itp, "String length is too large.", -1);
+        return JIM_ERR;
+    }
+
+    const char* buf = (const char*)p;
+    if (buf == NULL) {
+        setResultNullPtrFlag(itp);
+        return JIM_OK;
+    }
+    if (len < 0) len = 0;
+    if ( ! exact) {
+        const char* end = memchr(buf, 0, (size_t)len);
+        if (end != NULL) len = end - buf;
+    }
+    Jim_SetResultString(itp, buf, (int)len);
+    return JIM_OK;
+}
+
+int ascii_unpack_scriptPtr_asStringLen(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    return unpackBoundedString(itp, objc, objv, 1);
+}
+
+int ascii_unpack_scriptPtr_asStringMax(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    return unpackBoundedString(itp, objc, objv, 0);
+}
+
+// the struct codec packs or unpacks a whole struct in one command, driven by the member table
+// prepStructType stores in the struct's type blob.  it takes the place of the struct's generated
+// converter procs, which call a converter command for each member.  it's aliased with the
+// first 2 args, so the remaining args are the same as for any other converter:
+//   structPack    structTypeVarName  scriptForm  packVarName  unpackedData  ?offsetBytes?  ?nextOffsetVarName?
+//   structUnpack  structTypeVarName  scriptForm  packedValue  ?offsetBytes?  ?nextOffsetVarName?
+// scriptForm is asList or asDict.  dict keys are the member names from the member table, so
+// every dict shares the same key objects.
+static const char * const codecForms[] = {"asList", "asDict", NULL};
+enum {CF_LIST, CF_DICT};
+
+int structPack(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    if (objc < 4) {
+        Jim_SetResultString(itp, "Wrong # args.  Should be: structPack structTypeVarName scriptForm packVarName unpackedData ?offsetBytes? ?nextOffsetVarName?", -1);
+        return JIM_ERR;
+    }
+    structCodecT* codec = varToCodec(itp, objv[1]);
+    if (codec == NULL) return JIM_ERR;
+    int form = 0;
+    if (Jim_GetEnum(itp, objv[2], codecForms, &form, "scriptForm", JIM_ERRMSG) != JIM_OK) return JIM_ERR;
+    // the remaining args are laid out just like a simple packer's, when shifted over by 2.
+    u8* buf = NULL;
+    if (packerSetup_byVal(itp, objc - 2, objv + 2, codec->size, (void**)&buf) != JIM_OK) return JIM_ERR;
+
+    Jim_Obj* data = objv[2 + pk_unpackedDataIX];
+    if (form == CF_LIST && Jim_ListLength(itp, data) < codec->nMembers) {
+        Jim_SetResultString(itp, "Struct data list has too few members.", -1);
+        return JIM_ERR;
+    }
+    for (int n = 0; n < codec->nMembers; n++) {
+        structMemberT* m = &codec->members[n];
+        Jim_Obj* value = NULL;
+        if (form == CF_LIST) {
+            value = Jim_ListGetIndex(itp, data, n);
+        } else if (Jim_DictKey(itp, data, Jim_ListGetIndex(itp, codec->memberTable, n * MT_STRIDE + MT_nameIX), &value, JIM_ERRMSG) != JIM_OK) {
+            return JIM_ERR;
+        }
+        scalarT s;
+        if (packScalar(itp, m->typeCode, value, &s) != JIM_OK) return JIM_ERR;
+        memcpy(buf + m->offset, &s, ffiTypes[m->typeCode]->size);
+    }
+    return JIM_OK;
+}
+
+int structUnpack(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    if (objc < 4) {
+        Jim_SetResultString(itp, "Wrong # args.  Should be: structUnpack structTypeVarName scriptForm packedValue ?offsetBytes? ?nextOffsetVarName?", -1);
+        return JIM_ERR;
+    }
+    structCodecT* codec = varToCodec(itp, objv[1]);
+    if (codec == NULL) return JIM_ERR;
+    int form = 0;
+    if (Jim_GetEnum(itp, objv[2], codecForms, &form, "scriptForm", JIM_ERRMSG) != JIM_OK) return JIM_ERR;
+    u8* buf = NULL;
+    if (unpackerSetup_byVal(itp, objc - 2, objv + 2, codec->size, (void**)&buf) != JIM_OK) return JIM_ERR;
+
+    Jim_Obj* elems[codec->nMembers * 2 + 1];
+    int nElems = 0;
+    for (int n = 0; n < codec->nMembers; n++) {
+        structMemberT* m = &codec->members[n];
+        scalarT s;
+        memcpy(&s, buf + m->offset, ffiTypes[m->typeCode]->size); // the packed value might not be aligned.
+        if (form == CF_DICT)
+            elems[nElems++] = Jim_ListGetIndex(itp, codec->memberTable, n * MT_STRIDE + MT_nameIX);
+        elems[nElems++] = unpackScalar(itp, m->typeCode, &s);
+    }
+    Jim_SetResult(itp, form == CF_DICT  ?  Jim_NewDictObj(itp, elems, nElems)  :  Jim_NewListObj(itp, elems, nElems));
+    return JIM_OK;
+}
+
+// unpacks count structs from a native array in one pass over memory, without any script
+// converter per struct.  it supports the simple types a struct's members may have.
+// layoutList has 3 elements per member:  name, ffi type code, offset in bytes.
+// scriptForm is asList or asDict for a list with one element per struct, or asColumns for
+// one dict of per-member lists.
+int unpackStructArray(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) {
+    static const char * const forms[] = {"asList", "asDict", "asColumns", NULL};
+    enum {SF_LIST, SF_DICT, SF_COLUMNS};
+    enum {
+        cmdIX = 0,
+        pointerIntValueIX,
+        countIX,
+        strideIX,
+        layoutListIX,
+        scriptFormIX,
+        argCount
+    };
+
+    if (objc != argCount) {
+        Jim_SetResultString(itp, "Wrong # args.  Should be: unpackStructArray pointerIntValue count stride layoutList scriptForm", -1);
+        return JIM_ERR;
+    }
+    void* p = NULL;
+    jim_wide count = 0;
+    jim_wide stride = 0;
+    int form = 0;
+    if (getPointer(itp, objv[pointerIntValueIX], &p) != JIM_OK
+        || Jim_GetWide(itp, objv[countIX], &count) != JIM_OK
+        || Jim_GetWide(itp, objv[strideIX], &stride) != JIM_OK
+        || count < 0 || stride < 0) {
+        Jim_SetResultString(itp, "Expected pointer, count, and stride integers but got other data.", -1);
+        return JIM_ERR;
+    }
+    if (Jim_GetEnum(itp, objv[scriptFormIX], forms, &form, "scriptForm", JIM_ERRMSG) != JIM_OK) return JIM_ERR;
+    if (p == NULL && count > 0) {
+        Jim_SetResultString(itp, "Null pointer to struct array.", -1);
+        return JIM_ERR;
+    }
+
+    if (count > INT32_MAX / (jim_wide)sizeof(Jim_Obj*)) {
+        Jim_SetResultString(itp, "Struct array count is too large.", -1);
+        return JIM_ERR;
+    }
+
+    // the per-member arrays are sized by the layout from script, so they come from the heap.
+    Jim_Obj* layoutList = objv[layoutListIX];
+    int nMembers = Jim_ListLength(itp, layoutList) / 3;
+    Jim_Obj** names = Jim_Alloc((nMembers + 1) * sizeof(Jim_Obj*)); // +1 avoids a zero-length allocation.
+    int* typeCodes = Jim_Alloc((nMembers + 1) * sizeof(int));
+    jim_wide* offsets = Jim_Alloc((nMembers + 1) * sizeof(jim_wide));
+    Jim_Obj** elems = Jim_Alloc((nMembers * 2 + 1) * sizeof(Jim_Obj*)); // also the columns, for asColumns.
+    int ret = JIM_ERR;
+    if (names == NULL || typeCodes == NULL || offsets == NULL || elems == NULL) {
+        Jim_SetResultString(itp, "Out of memory while unpacking struct array.", -1);
+        goto done;
+    }
+    for (int m = 0; m < nMembers; m++) {
+        jim_wide typeCode = 0;
+        names[m] = Jim_ListGetIndex(itp, layoutList, m * 3);
+        if (Jim_GetWide(itp, Jim_ListGetIndex(itp, layoutList, m * 3 + 1), &typeCode) != JIM_OK
+            || Jim_GetWide(itp, Jim_ListGetIndex(itp, layoutList, m * 3 + 2), &offsets[m]) != JIM_OK
+            || typeCode < 0 || typeCode > FFI_TYPE_FINAL || ffiTypes[typeCode] == NULL) {
+            Jim_SetResultString(itp, "Struct array layout is unusable.", -1);
+            goto done;
+        }
+        // every member must lie within one stride, so no read runs past the last struct.
+        if (offsets[m] < 0 || offsets[m] > stride - (jim_wide)ffiTypes[typeCode]->size) {
+            Jim_SetResultString(itp, "Struct array layout has a member outside the stride.", -1);
+            goto done;
+        }
+        typeCodes[m] = (int)typeCode;
+    }
+
+    u8* row = (u8*)p;
+    if (form == SF_COLUMNS) {
+        Jim_Obj** columns = elems;
+        for (int m = 0; m < nMembers; m++)
+            columns[m] = Jim_NewListObj(itp, NULL, 0);
+        for (jim_wide n = 0; n < count; n++, row += stride) {
+            for (int m = 0; m < nMembers; m++)
+                Jim_ListAppendElement(itp, columns[m], unpackScalar(itp, typeCodes[m], row + offsets[m]));
+        }
+        Jim_Obj* dict = Jim_NewDictObj(itp, NULL, 0);
+        for (int m = 0; m < nMembers; m++)
+            Jim_DictAddElement(itp, dict, names[m], columns[m]);
+        Jim_SetResult(itp, dict);
+        ret = JIM_OK;
+        goto done;
+    }
+
+    scratchT* scratch = getScratch(itp);
+    scratchMarkT mark = scratchMark(scratch);
+    Jim_Obj** rows = scratchAlloc(scratch, count * sizeof(Jim_Obj*));
+    if (rows == NULL) {
+        scratchRelease(scratch, mark);
+        Jim_SetResultString(itp, "Out of memory while unpacking struct array.", -1);
+        goto done;
+    }
+    for (jim_wide n = 0; n < count; n++, row += stride) {
+        if (form == SF_LIST) {
+            for (int m = 0; m < nMembers; m++)
+                elems[m] = unpackScalar(itp, typeCodes[m], row + offsets[m]);
+            rows[n] = Jim_NewListObj(itp, elems, nMembers);
+        } else {
+            for (int m = 0; m < nMembers; m++) {
+                elems[m * 2] = names[m];
+                elems[m * 2 + 1] = unpackScalar(itp, typeCodes[m], row + offsets[m]);
+            }
+            rows[n] = Jim_NewDictObj(itp, elems, nMembers * 2);
+        }
+    }
+    Jim_SetResult(itp, Jim_NewListObj(itp, rows, (int)count));
+    scratchRelease(scratch, mark);
+    ret = JIM_OK;
+
+done:
+    Jim_Free(names);
+    Jim_Free(typeCodes);
+    Jim_Free(offsets);
+    Jim_Free(elems);
+    return ret;
+}
+
+// array converters pack a whole script list into a contiguous native array in one command,
+// or unpack one, instead of one converter command per element.  they implement scriptForm asList
+// for simple types, which is always passed byPtr.
+// packer args are:  packVarName  list  ?count?
+// the array has count elements, or as many as the list if that's more.  extra elements are zeroed.
+// the packer always creates a new buffer, so it never writes to a value shared elsewhere.
+// unpacker args are:  packedValue  ?count?
+// it unpacks count elements, or every whole element in the packed value by default.
+int arrayPackerSetup(Jim_Interp* itp, int objc, Jim_Obj * const objv[],
+    int elemSize, void** bufP, int* lenP) {
+
+    enum {
+        cmdIX = 0,
+        packVarNameIX,
+        listIX,
+        countIX,
+        argCount
+    };
+
+    if (objc > argCount || objc < countIX) {
+        Jim_SetResultString(itp, "Wrong # args.  Should be: packer packVarName list ?count?", -1);
+        return JIM_ERR;
+    }
+    int len = Jim_ListLength(itp, objv[listIX]);
+    jim_wide count = len;
+    if (objc > countIX) {
+        if (Jim_GetWide(itp, objv[countIX], &count) != JIM_OK || count < 0) {
+            Jim_SetResultString(itp, "Expected element count integer but got other data.", -1);
+            return JIM_ERR;
+        }
+        if (count < len) count = len;
+    }
+    if (count > INT32_MAX / elemSize) {
+        Jim_SetResultString(itp, "Element count is too large for a buffer.", -1);
+        return JIM_ERR;
+    }
+    if (createBufferVarNative(itp, objv[packVarNameIX], (int)count * elemSize, bufP, NULL) != JIM_OK) return JIM_ERR;
+    memset(*bufP, 0, (size_t)count * elemSize);
+    *lenP = len;
+    return JIM_OK;
+}
+
+int arrayUnpackerSetup(Jim_Interp* itp, int objc, Jim_Obj * const objv[],
+    int elemSize, void** bufP, int* countP) {
+
+    enum {
+        cmdIX = 0,
+        packedValueIX,
+        countIX,
+        argCount
+    };
+
+    if (objc > argCount || objc < countIX) {
+        Jim_SetResultString(itp, "Wrong # args.  Should be: unpacker packedValue ?count?", -1);
+        return JIM_ERR;
+    }
+    Jim_Obj* v = objv[packedValueIX];
+    int len = 0;
+    *bufP = (void*)bufferBytes(v, &len);
+    jim_wide count = len / elemSize;
+    if (objc > countIX) {
+        if (Jim_GetWide(itp, objv[countIX], &count) != JIM_OK || count < 0) {
+            Jim_SetResultString(itp, "Expected element count integer but got other data.", -1);
+            return JIM_ERR;
+        }
+        if (count * elemSize > len) {
+            Jim_SetResultString(itp, "Packed value is too short.", -1);
+            return JIM_ERR;
+        }
+    }
+    *countP = (int)count;
+    return JIM_OK;
+}
+
+// defines the array packer and unpacker for one simple type.  getter is Jim_GetWide or Jim_GetDouble.
+// the list's internal element array is read directly; Jim_ListLength already made sure it has one.
+#define ARRAY_CONVERTERS(name, cType, wideT, getter, newObj, expected) \
+    int name##_pack_byVal_asList(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) { \
+        cType* buf = NULL; \
+        int len = 0; \
+        if (arrayPackerSetup(itp, objc, objv, sizeof(cType), (void**)&buf, &len) != JIM_OK) return JIM_ERR; \
+        Jim_Obj** elems = objv[2]->internalRep.listValue.ele; \
+        for (int n = 0; n < len; n++) { \
+            wideT data; \
+            if (getter(itp, elems[n], &data) != JIM_OK) { \
+                Jim_SetResultString(itp, "Expected array element " expected " but got other data.", -1); \
+                return JIM_ERR; \
+            } \
+            buf[n] = (cType)data; \
+        } \
+        return JIM_OK; \
+    } \
+    int name##_unpack_byVal_asList(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) { \
+        cType* buf = NULL; \
+        int count = 0; \
+        if (arrayUnpackerSetup(itp, objc, objv, sizeof(cType), (void**)&buf, &count) != JIM_OK) return JIM_ERR; \
+        scratchT* scratch = getScratch(itp); \
+        scratchMarkT mark = scratchMark(scratch); \
+        Jim_Obj** elems = scratchAlloc(scratch, count * sizeof(Jim_Obj*)); \
+        for (int n = 0; n < count; n++) { \
+            cType data; \
+            memcpy(&data, &buf[n], sizeof(cType)); /* the packed value might not be aligned. */ \
+            elems[n] = newObj(itp, (wideT)data); \
+        } \
+        Jim_SetResult(itp, Jim_NewListObj(itp, elems, count)); \
+        scratchRelease(scratch, mark); \
+        return JIM_OK; \
+    }
+
+ARRAY_CONVERTERS(u8,  u8,  jim_wide, Jim_GetWide, Jim_NewIntObj, "integer")
+ARRAY_CONVERTERS(u16, u16, jim_wide, Jim_GetWide, Jim_NewIntObj, "integer")
+ARRAY_CONVERTERS(u32, u32, jim_wide, Jim_GetWide, Jim_NewIntObj, "integer")
+ARRAY_CONVERTERS(u64, u64, jim_wide, Jim_GetWide, Jim_NewIntObj, "integer")
+ARRAY_CONVERTERS(i8,  i8,  jim_wide, Jim_GetWide, Jim_NewIntObj, "integer")
+ARRAY_CONVERTERS(i16, i16, jim_wide, Jim_GetWide, Jim_NewIntObj, "integer")
+ARRAY_CONVERTERS(i32, i32, jim_wide, Jim_GetWide, Jim_NewIntObj, "integer")
+ARRAY_CONVERTERS(i64, i64, jim_wide, Jim_GetWide, Jim_NewIntObj, "integer")
+ARRAY_CONVERTERS(float,      float,       double, Jim_GetDouble, Jim_NewDoubleObj, "double-precision float")
+ARRAY_CONVERTERS(double,     double,      double, Jim_GetDouble, Jim_NewDoubleObj, "double-precision float")
+ARRAY_CONVERTERS(longDouble, long double, double, Jim_GetDouble, Jim_NewDoubleObj, "double-precision float")
+
 // this function's name is based on the library's actual filename.  Jim requires that.
 int Jim_dlrNativeInit(Jim_Interp* itp) {
     //ivkClientT* client = client_alloc(itp);
@@ -1188,10 +5288,17 @@ int Jim_dlrNativeInit(Jim_Interp* itp) {
         return JIM_ERR;
     }
 
+    Jim_SetAssocData(itp, STUB_API_KEY, NULL, &stubApi);
+
     // main required features.
     Jim_CreateCommand(itp, "dlr::native::loadLib", loadLib, NULL, NULL);
     Jim_CreateCommand(itp, "dlr::native::prepMetaBlob", prepMetaBlob, NULL, NULL);
     Jim_CreateCommand(itp, "dlr::native::callToNative", callToNative, NULL, NULL);
+    Jim_CreateCommand(itp, "dlr::native::bindCallToNative", bindCallToNative, NULL, NULL);
+    Jim_CreateCommand(itp, "dlr::native::bindPlannedCall", bindPlannedCall, NULL, NULL);
+    Jim_CreateCommand(itp, "dlr::native::callBatch", callBatch, NULL, NULL);
+    Jim_CreateCommand(itp, "dlr::native::callAsync", callAsync, NULL, NULL);
+    Jim_CreateCommand(itp, "dlr::native::prepCallbackType", prepCallbackType, NULL, NULL);
 #ifdef BUILD_GIZMO
     Jim_CreateCommand(itp, "dlr::native::giCallToNative", giCallToNative, NULL, NULL);
     Jim_CreateCommand(itp, "dlr::native::giFreeHeap", giFreeHeap, NULL, NULL);
@@ -1204,8 +5311,23 @@ int Jim_dlrNativeInit(Jim_Interp* itp) {
     Jim_CreateCommand(itp, "dlr::native::createBufferVar", createBufferVar, NULL, NULL);
     Jim_CreateCommand(itp, "dlr::native::copyToBufferVar", copyToBufferVar, NULL, NULL);
     Jim_CreateCommand(itp, "dlr::native::allocHeap", allocHeap, NULL, NULL);
+    Jim_CreateCommand(itp, "dlr::native::createPackCursor", createPackCursor, NULL, NULL);
+    Jim_CreateCommand(itp, "dlr::native::createBlockPool", createBlockPool, NULL, NULL);
+    Jim_CreateCommand(itp, "dlr::native::newBuffer", newBuffer, NULL, NULL);
+    Jim_CreateCommand(itp, "dlr::native::wrapBuffer", wrapBuffer, NULL, NULL);
+    Jim_CreateCommand(itp, "dlr::native::sliceBuffer", sliceBuffer, NULL, NULL);
+    Jim_CreateCommand(itp, "dlr::native::bufferAddr", bufferAddr, NULL, NULL);
+    Jim_CreateCommand(itp, "dlr::native::isNullFlag", isNullFlag, NULL, NULL);
+    Jim_CreateCommand(itp, "dlr::native::newPointer", newPointer, NULL, NULL);
+    Jim_CreateCommand(itp, "dlr::native::pointerType", pointerTypeName, NULL, NULL);
+    Jim_CreateCommand(itp, "dlr::native::nullPtrFlag", nullPtrFlag, NULL, NULL);
     Jim_CreateCommand(itp, "dlr::native::freeHeap", freeHeap, NULL, NULL);
+    Jim_CreateCommand(itp, "dlr::native::scratchUsage", scratchUsage, NULL, NULL);
+    Jim_CreateCommand(itp, "dlr::native::signatureStats", signatureStats, NULL, NULL);
     Jim_CreateCommand(itp, "dlr::native::sizeOfTypes", sizeOfTypes, NULL, NULL);
+    Jim_CreateCommand(itp, "dlr::native::dwarfStructLayouts", dwarfStructLayouts, NULL, NULL);
+    Jim_CreateCommand(itp, "dlr::native::buildId", buildId, NULL, NULL);
+    Jim_CreateCommand(itp, "dlr::native::hash", hashValue, NULL, NULL);
 
     // data packers.
     Jim_CreateCommand(itp, "dlr::native::u8-pack-byVal-asInt",              u8_pack_byVal_asInt,  NULL, NULL);
@@ -1216,6 +5338,7 @@ int Jim_dlrNativeInit(Jim_Interp* itp) {
     Jim_CreateCommand(itp, "dlr::native::i16-pack-byVal-asInt",             i16_pack_byVal_asInt, NULL, NULL);
     Jim_CreateCommand(itp, "dlr::native::i32-pack-byVal-asInt",             i32_pack_byVal_asInt, NULL, NULL);
     Jim_CreateCommand(itp, "dlr::native::i64-pack-byVal-asInt",             i64_pack_byVal_asInt, NULL, NULL);
+    Jim_CreateCommand(itp, "dlr::native::ptr-pack-byVal-asInt",             ptr_pack_byVal_asInt, NULL, NULL);
     Jim_CreateCommand(itp, "dlr::native::float-pack-byVal-asDouble",        float_pack_byVal_asDouble, NULL, NULL);
     Jim_CreateCommand(itp, "dlr::native::double-pack-byVal-asDouble",       double_pack_byVal_asDouble, NULL, NULL);
     Jim_CreateCommand(itp, "dlr::native::longDouble-pack-byVal-asDouble",   longDouble_pack_byVal_asDouble, NULL, NULL);
@@ -1231,11 +5354,33 @@ int Jim_dlrNativeInit(Jim_Interp* itp) {
     Jim_CreateCommand(itp, "dlr::native::i16-unpack-byVal-asInt",           i16_unpack_byVal_asInt, NULL, NULL);
     Jim_CreateCommand(itp, "dlr::native::i32-unpack-byVal-asInt",           i32_unpack_byVal_asInt, NULL, NULL);
     Jim_CreateCommand(itp, "dlr::native::i64-unpack-byVal-asInt",           i64_unpack_byVal_asInt, NULL, NULL);
+    Jim_CreateCommand(itp, "dlr::native::ptr-unpack-byVal-asInt",           ptr_unpack_byVal_asInt, NULL, NULL);
     Jim_CreateCommand(itp, "dlr::native::float-unpack-byVal-asDouble",      float_unpack_byVal_asDouble, NULL, NULL);
     Jim_CreateCommand(itp, "dlr::native::double-unpack-byVal-asDouble",     double_unpack_byVal_asDouble, NULL, NULL);
     Jim_CreateCommand(itp, "dlr::native::longDouble-unpack-byVal-asDouble", longDouble_unpack_byVal_asDouble, NULL, NULL);
     Jim_CreateCommand(itp, "dlr::native::ascii-unpack-byVal-asString",      ascii_unpack_byVal_asString, NULL, NULL);
     Jim_CreateCommand(itp, "dlr::native::ascii-unpack-scriptPtr-asString",  ascii_unpack_scriptPtr_asString, NULL, NULL);
+    Jim_CreateCommand(itp, "dlr::native::ascii-unpack-scriptPtr-asStringLen", ascii_unpack_scriptPtr_asStringLen, NULL, NULL);
+    Jim_CreateCommand(itp, "dlr::native::ascii-unpack-scriptPtr-asStringMax", ascii_unpack_scriptPtr_asStringMax, NULL, NULL);
+
+    Jim_CreateCommand(itp, "dlr::native::unpackStructArray", unpackStructArray, NULL, NULL);
+    Jim_CreateCommand(itp, "dlr::native::structPack", structPack, NULL, NULL);
+    Jim_CreateCommand(itp, "dlr::native::structUnpack", structUnpack, NULL, NULL);
+
+    #define REGISTER_ARRAY_CONVERTERS(name) \
+        Jim_CreateCommand(itp, "dlr::native::" #name "-pack-byVal-asList",   name##_pack_byVal_asList, NULL, NULL); \
+        Jim_CreateCommand(itp, "dlr::native::" #name "-unpack-byVal-asList", name##_unpack_byVal_asList, NULL, NULL);
+    REGISTER_ARRAY_CONVERTERS(u8)
+    REGISTER_ARRAY_CONVERTERS(u16)
+    REGISTER_ARRAY_CONVERTERS(u32)
+    REGISTER_ARRAY_CONVERTERS(u64)
+    REGISTER_ARRAY_CONVERTERS(i8)
+    REGISTER_ARRAY_CONVERTERS(i16)
+    REGISTER_ARRAY_CONVERTERS(i32)
+    REGISTER_ARRAY_CONVERTERS(i64)
+    REGISTER_ARRAY_CONVERTERS(float)
+    REGISTER_ARRAY_CONVERTERS(double)
+    REGISTER_ARRAY_CONVERTERS(longDouble)
 
     return JIM_OK;
 }
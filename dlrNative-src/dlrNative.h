@@ -36,12 +36,64 @@ typedef  int16_t i16;
 typedef  int32_t i32;
 typedef  int64_t i64;
 
+// compiled call stubs are loaded with their symbols private, like any Jim extension, so they
+// can't link to dlrNative's functions.  instead dlrNative publishes this table of them in each
+// interpreter, under STUB_API_KEY, for the stubs to fetch with Jim_GetAssocData().
+// compileCallStubs in the dlr script package declares the same structure.  change both together.
+#define STUB_API_KEY "dlrStubApi"
+typedef struct {
+    int (*getPointer)(Jim_Interp* itp, Jim_Obj* v, void** pP);
+    Jim_Obj* (*newPointerObj)(Jim_Interp* itp, void* p, int typeID);
+    int (*internPointerType)(Jim_Interp* itp, const char* name);
+} stubApiT;
+
 
 extern int loadLib(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
 
 extern int fnAddr(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
 
 extern int sizeOfTypes(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+extern int dwarfStructLayouts(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+extern int buildId(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+extern int hashValue(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern Jim_Obj* newNativeBufferObj(Jim_Interp* itp, void* data, int len, int owned) ;
+
+extern u8* bufferBytes(Jim_Obj* v, int* lenP) ;
+
+extern u8* bufferBytesForWrite(Jim_Obj* v, int* lenP) ;
+
+extern int isNativeBuffer(Jim_Obj* v) ;
+
+extern int bufferLength(Jim_Obj* v) ;
+
+extern void deletePointerTypes(Jim_Interp* itp, void* data) ;
+
+extern int internPointerType(Jim_Interp* itp, const char* name) ;
+
+extern Jim_Obj* newPointerObj(Jim_Interp* itp, void* p, int typeID) ;
+
+extern Jim_Obj* newNullPtrFlagObj(Jim_Interp* itp) ;
+
+extern int getPointer(Jim_Interp* itp, Jim_Obj* v, void** pP) ;
+
+extern int isNullPtrFlag(Jim_Interp* itp, Jim_Obj* v) ;
+
+extern int newPointer(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int pointerTypeName(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int nullPtrFlag(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int newBuffer(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int wrapBuffer(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int sliceBuffer(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int bufferAddr(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int isNullFlag(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
 
 extern int addrOf(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
 
@@ -49,6 +101,14 @@ extern int allocHeap(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
 
 extern int freeHeap(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
 
+extern void deleteBlockPool(Jim_Interp* itp, void* privData) ;
+
+extern int blockPoolCmd(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int createBlockPool(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int createPackCursor(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
 extern int createBufferObj(Jim_Interp* itp, int len, void** newBufP, Jim_Obj** newObjP) ;
 
 extern int createBufferVarNative(Jim_Interp* itp, Jim_Obj* varName, int len, void** newBufP, Jim_Obj** newObjP) ;
@@ -61,10 +121,66 @@ extern int varToTypeP(Jim_Interp* itp, Jim_Obj *var, ffi_type** typ) ;
 
 extern int prepStructType(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
 
+extern int structPack(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int structUnpack(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern void deleteSignatureTable(Jim_Interp* itp, void* data) ;
+
+extern int signatureStats(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
 extern int prepMetaBlob(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
 
 extern int callToNative(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
 
+extern void deleteScratch(Jim_Interp* itp, void* data) ;
+
+extern int scratchUsage(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int boundCallToNative(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern void deleteCallBinding(Jim_Interp* itp, void* privData) ;
+
+extern int bindCallToNative(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int bindPlannedCall(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int packScalar(Jim_Interp* itp, int typeCode, Jim_Obj* value, void* dest) ;
+
+extern Jim_Obj* unpackScalar(Jim_Interp* itp, int typeCode, void* src) ;
+
+extern int planPackScript(Jim_Interp* itp, Jim_Obj* const stepList[], Jim_Obj* value, Jim_Obj** bufP) ;
+
+extern int planUnpackScript(Jim_Interp* itp, Jim_Obj* const stepList[], Jim_Obj* packed) ;
+
+extern int plannedCallToNative(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern void* runBatchSlice(void* sliceP) ;
+
+extern int callBatch(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern void* asyncWorker(void* poolP) ;
+
+extern int asyncReadable(Jim_Interp* itp, void* poolP, int mask) ;
+
+extern void deleteAsyncPool(Jim_Interp* itp, void* poolP) ;
+
+extern int callAsync(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern void deleteCallbackError(Jim_Interp* itp, void* data) ;
+
+extern void holdCallbackError(Jim_Interp* itp, Jim_Obj* msg) ;
+
+extern int raiseCallbackError(Jim_Interp* itp) ;
+
+extern int packCallbackReturn(Jim_Interp* itp, int typeCode, Jim_Obj* value, void* ret) ;
+
+extern void callbackHandler(ffi_cif* cif, void* ret, void** args, void* slotP) ;
+
+extern int callbackPool(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int prepCallbackType(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
 #ifdef BUILD_GIZMO
     extern int giCallToNative(Jim_Interp* itp, int objc, Jim_Obj * const objv[]);
 
@@ -94,6 +210,8 @@ extern int i32_pack_byVal_asInt(Jim_Interp* itp, int objc, Jim_Obj * const objv[
 
 extern int i64_pack_byVal_asInt(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
 
+extern int ptr_pack_byVal_asInt(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
 extern int double_pack_byVal_asDouble(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
 
 extern int float_pack_byVal_asDouble(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
@@ -126,6 +244,8 @@ extern int i32_unpack_byVal_asInt(Jim_Interp* itp, int objc, Jim_Obj * const obj
 
 extern int i64_unpack_byVal_asInt(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
 
+extern int ptr_unpack_byVal_asInt(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
 extern int float_unpack_byVal_asDouble(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
 
 extern int double_unpack_byVal_asDouble(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
@@ -136,6 +256,64 @@ extern int ascii_unpack_byVal_asString(Jim_Interp* itp, int objc, Jim_Obj * cons
 
 extern int ascii_unpack_scriptPtr_asString(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
 
+extern int unpackBoundedString(Jim_Interp* itp, int objc, Jim_Obj * const objv[], int exact) ;
+
+extern int ascii_unpack_scriptPtr_asStringLen(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int ascii_unpack_scriptPtr_asStringMax(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int unpackStructArray(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int arrayPackerSetup(Jim_Interp* itp, int objc, Jim_Obj * const objv[],
+    int elemSize, void** bufP, int* lenP);
+
+extern int arrayUnpackerSetup(Jim_Interp* itp, int objc, Jim_Obj * const objv[],
+    int elemSize, void** bufP, int* countP);
+
+extern int u8_pack_byVal_asList(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int u8_unpack_byVal_asList(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int u16_pack_byVal_asList(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int u16_unpack_byVal_asList(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int u32_pack_byVal_asList(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int u32_unpack_byVal_asList(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int u64_pack_byVal_asList(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int u64_unpack_byVal_asList(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int i8_pack_byVal_asList(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int i8_unpack_byVal_asList(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int i16_pack_byVal_asList(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int i16_unpack_byVal_asList(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int i32_pack_byVal_asList(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int i32_unpack_byVal_asList(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int i64_pack_byVal_asList(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int i64_unpack_byVal_asList(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int float_pack_byVal_asList(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int float_unpack_byVal_asList(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int double_pack_byVal_asList(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int double_unpack_byVal_asList(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int longDouble_pack_byVal_asList(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
+extern int longDouble_unpack_byVal_asList(Jim_Interp* itp, int objc, Jim_Obj * const objv[]) ;
+
 // this function's name is based on the library's actual filename.  Jim requires that.
 extern int Jim_dlrNativeInit(Jim_Interp* itp);
 
@@ -41,11 +41,33 @@ proc bench {label  reps  script} {
     flush stdout
 }
 
+# pack the native argument variables of strtolTest by hand, the same way its generated
+# call wrapper would.  that's required before using them with callToNative directly.
+proc packStrtolArgs {str  radix} {
+    set qal ::dlr::lib::testLib::strtolTest::parm::
+    ::dlr::simple::ascii::pack-byVal-asString  ${qal}str::targetNative  $str
+    ::dlr::simple::ptr::pack-byVal-asInt       ${qal}str::ptrNative     [::dlr::addrOf ${qal}str::targetNative]
+    ::dlr::simple::ptr::pack-byVal-asInt       ${qal}endP::targetNative 0
+    ::dlr::simple::ptr::pack-byVal-asInt       ${qal}endP::ptrNative    [::dlr::addrOf ${qal}endP::targetNative]
+    ::dlr::simple::int::pack-byVal-asInt       ${qal}radix::targetNative  $radix
+}
+
 puts paths=$::auto_path
 
 set version [package require dlr]
 puts version=$version
 
+# with ffiOnly, every call goes through libffi.  that verifies the trampolines give identical results.
+# an optional third argument selects an alternate implementation, for comparison.
+set option [lindex $::argv 2]
+if {$option eq {ffiOnly}} {
+    set ::dlr::trampolines 0
+} elseif {$option eq {scriptStructs}} {
+    set ::dlr::structCodec 0
+} elseif {$option eq {lazy}} {
+    set ::dlr::lazyBinding 1
+}
+
 lassign  $::argv  metaAction  benchReps
 
 puts "int::bits=$::dlr::simple::int::bits  long::bits=$::dlr::simple::long::bits  ptr::bits=$::dlr::simple::ptr::bits"
@@ -60,18 +82,76 @@ assert {[llength [::dlr::allLibAliases]] == 0}
 ::dlr::loadLib  $metaAction  testLib  [file join $::appDir testLib-src testLib.so]
 assert {[llength [::dlr::allLibAliases]] == 1}
 assert {[lindex [::dlr::allLibAliases] 0] eq {testLib}}
+# every load leaves a metadata bundle.  keepMeta reads it, instead of the generated files.
+assert {[file readable [::dlr::bundlePath testLib]]}
+assert {[exists ::dlr::bundle::testLib::loaded] == ($metaAction in {keepMeta autoMeta})}
+# each generated artifact's inputs are hashed.  autoMeta regenerates only those that changed,
+# and nothing did since the previous run.
+assert {[::dlr::native::hash abc] eq {e71fa2190541574b}}
+assert {[dict exists $::dlr::lib::testLib::artifactHashes  call:strtolTest]}
+assert {[dict exists $::dlr::lib::testLib::artifactHashes  struct:quadT]}
+if {$metaAction eq {autoMeta}} {
+    assert { ! $::dlr::lib::testLib::artifactsChanged}
+}
+assert {[exists ::dlr::lib::testLib::struct::quadT::member::d::offset]}
+if {$option eq {lazy}} {
+    # with lazy binding, a function is resolved at its first call, with its "out" parms intact.
+    assert {! [exists ::dlr::lib::testLib::strtolTest::meta]}
+    set endP 0
+    assert {[::testLib::strtolTest  321  endP  10] == 321}
+    assert {$endP != 0}
+    assert {[exists ::dlr::lib::testLib::strtolTest::meta]}
+    # or resolved ahead of time, before using its metaBlob directly.
+    ::dlr::resolveCall  testLib  mulPtr
+    assert {[exists ::dlr::lib::testLib::mulPtr::meta]}
+}
+if {$metaAction eq {compileStubs}} {
+    # call stubs were compiled and loaded.  functions without script converters have them.
+    assert {{strtolTest} in $::dlr::lib::testLib::stubbedFns}
+    assert {{mulPtr} ni $::dlr::lib::testLib::stubbedFns}
+    assert {{passPtr} in $::dlr::lib::testLib::stubbedFns}
+}
+# pointer parms accept the null pointer flag, and pointers come back as pointer objects.
+# under compileStubs that's through the stub.
+assert {[::testLib::passPtr  $::dlr::nullPtrFlag] == 0}
+assert {[::testLib::passPtr  1234] == 1234}
 if [::dlr::refreshMeta] {
     set sQal ::dlr::lib::testLib::struct::quadT::
     set mQal ${sQal}member::
     puts "detected:  name=quadT  size=[set ${sQal}size]  cOfs=[set ${mQal}c::offset]"
     assert {[set ${mQal}a::offset] == 0} ;# all the other offsets beyond this first one depend on the compiler's word size and structure packing behavior.
     assert {[set ${mQal}c::type] == {::dlr::simple::int}}
+
+    # the same layout can be read from testLib's DWARF debug info, with no compile.
+    set ::dlr::structLayoutSource  dwarf
+    set lay [dict get [::dlr::detectStructLayouts testLib quadT] quadT]
+    set ::dlr::structLayoutSource  compile
+    assert {$lay(size) == [set ${sQal}size]}
+    foreach mName [set ${sQal}memberOrder] {
+        assert {[dict get $lay members $mName offset] == [set ${mQal}${mName}::offset]}
+        assert {[dict get $lay members $mName size] == [set [set ${mQal}${mName}::type]::size]}
+    }
+    unset lay
 }
 # dump the metadata structure in ram.  this is big.
 #puts [join [lsort [info vars ::dlr::*]] \n]
 
 # speed benchmark.  test conditions very comparable to bench-0.1.tcl.
 # difference is under 1%, far less than the background noise from the OS multitasking.
+# a second metaBlob for strtolTest, always calling through libffi, for comparison with its trampoline.
+set fQal ::dlr::lib::testLib::strtolTest::
+::dlr::prepMetaBlob  ::test::ffiMeta  [::dlr::fnAddr strtolTest testLib]  ::dlr::simple::long::ffiTypeCode  \
+    [set ${fQal}orderNative]  [lmap p [set ${fQal}parmOrder] {::dlr::selectTypeMeta [set ${fQal}parm::${p}::passType]}]  \
+    {}  1  {}  0
+::dlr::bindCallToNative  ::test::ffiCall  ::test::ffiMeta
+# metaBlobs of the same signature share one prepared CIF.
+lassign [::dlr::native::signatureStats]  sigCount  metaCount
+::dlr::prepMetaBlob  ::test::sharedMeta  [::dlr::fnAddr strtolTest testLib]  ::dlr::simple::long::ffiTypeCode  \
+    [set ${fQal}orderNative]  [lmap p [set ${fQal}parmOrder] {::dlr::selectTypeMeta [set ${fQal}parm::${p}::passType]}]
+lassign [::dlr::native::signatureStats]  sigCount2  metaCount2
+assert {$sigCount2 == $sigCount && $metaCount2 == $metaCount + 1}
+unset ::test::sharedMeta sigCount metaCount sigCount2 metaCount2
+
 if {$benchReps ne {}} {
     set benchReps $(int($benchReps))
     set str 905
@@ -86,9 +166,38 @@ if {$benchReps ne {}} {
         ::dlr::simple::ptr::pack-byVal-asInt  ::dlr::lib::testLib::strtolTest::parm::endPP [::dlr::addrOf ::dlr::lib::testLib::strtolTest::parm::endP]
         ::dlr::simple::int::pack-byVal-asInt  ::dlr::lib::testLib::strtolTest::parm::radix  10
     }
+    packStrtolArgs  $str  10
     bench callToNative $benchReps {
         ::dlr::callToNative  ::dlr::lib::testLib::strtolTest::meta
     }
+    bench callNative $benchReps {
+        ::dlr::lib::testLib::strtolTest::callNative
+    }
+    bench callNative-ffiOnly $benchReps {
+        ::test::ffiCall
+    }
+    # batches are timed as a whole.
+    set batch [lrepeat $benchReps [list 1 0.5 ab 1.0]]
+    bench mixedArgs $benchReps {
+        ::testLib::mixedArgs  1  0.5  ab  1.0
+    }
+    bench callBatch-mixedArgs 1 {
+        ::dlr::callBatch  testLib  mixedArgs  $batch
+    }
+    bench callBatch-mixedArgs-4threads 1 {
+        ::dlr::callBatch  testLib  mixedArgs  $batch  -threads 4
+    }
+    bench mulByValue $benchReps {
+        ::testLib::mulByValue  {1 2 3 4}  2
+    }
+    bench mulDict $benchReps {
+        ::testLib::mulDict  {a 1 b 2 c 3 d 4}  2
+    }
+    # an array of benchReps elements, packed in one converter command.
+    set values [lrepeat $benchReps 1.5]
+    bench sumDoubles-array 1 {
+        ::testLib::sumDoubles  $values  $benchReps
+    }
     exit 0
 }
 
@@ -113,6 +222,34 @@ loop attempt 0 3 {
 }
 assert { -999999999 == [::testLib::strtolTest  $::dlr::nullPtrFlag  endP  10]}
 
+# bound call command test.  it must give the same result as the generic callToNative.
+set myNum 4321
+packStrtolArgs  $myNum  10
+# the long return value comes back already unpacked asInt.
+set generic [::dlr::callToNative  ::dlr::lib::testLib::strtolTest::meta]
+set bound   [::dlr::lib::testLib::strtolTest::callNative]
+assert {$generic == $myNum}
+assert {$bound == $generic}
+
+# planned call commands take the place of generated call wrappers, wherever possible.
+assert {[exists -command ::dlr::lib::testLib::strtolTest::call]}
+assert {[info procs ::dlr::lib::testLib::strtolTest::call] eq {}}
+assert {[info procs ::dlr::lib::testLib::mulPtr::call] eq {}}
+# asNative requires a generated call wrapper.
+assert {[info procs ::dlr::lib::testLib::mulPtrNat::call] ne {}}
+# a planned call's string copies live in the scratch arena, only until the call returns.
+assert {[::testLib::strtolTest  [string repeat 0 5000]7  endP  10] == 7}
+lassign [::dlr::native::scratchUsage]  used  capacity
+assert {$used == 0 && $capacity > 5000}
+
+# taggedT was declared along with quadT.  its layout has padding before value.
+set tQal ::dlr::lib::testLib::struct::taggedT::
+assert {[::dlr::get ${tQal}member::value::offset] >= 1}
+assert {[::dlr::get ${tQal}size] >= [::dlr::get ${tQal}member::value::offset] + 8}
+${tQal}pack-byVal-asList  tagged  {7 2.5}
+assert {[${tQal}unpack-byVal-asList $tagged] eq {7 2.5}}
+unset tQal tagged
+
 # mulByValue test
 loop attempt 2 5 {
     lassign [::testLib::mulByValue {10 11 12 13} -$attempt] a b c d
@@ -158,6 +295,195 @@ loop attempt 2 5 {
     assert {$h == $attempt << 4}
 }
 
+# trampoline test.  the same call must give identical results through libffi.
+packStrtolArgs  -98765  10
+assert {[::test::ffiCall] == -98765}
+assert {[::test::ffiCall] == [::dlr::lib::testLib::strtolTest::callNative]}
+
+# mixedArgs test.  integer and double parms interleave.
+assert {[::testLib::mixedArgs  -3  0.5  abcde  2.0] == 2502.0}
+
+# callBatch test.
+set batchIn [lmap i {1 2 3 4 5 6 7} {list $i 0.5 ab 1.0}]
+foreach threads {1 3 20 100000} {
+    set results [::dlr::callBatch  testLib  mixedArgs  $batchIn  -threads $threads]
+    assert {[llength $results] == 7}
+    foreach i {1 2 3 4 5 6 7} r $results {
+        assert {$r == $i + 1205.0}
+    }
+}
+assert {[::dlr::callBatch  testLib  mixedArgs  {}] eq {}}
+# with "out" or "inOut" parms, each result lists the return value and those parms.
+set results [::dlr::callBatch  testLib  dirRotatePtr  {0 1 3}]
+assert {[lmap r $results {lindex $r 1}] eq {1 2 0}}
+# only thread-safe functions can be split across threads.
+assert {[catch {::dlr::callBatch  testLib  dirRotatePtr  {0 1 3}  -threads 2}]}
+# error policies apply to each call in the batch.  msgFn policies aren't supported there.
+assert {[::dlr::callBatch  testLib  checkedErrno  {1 2}] eq {1 2}}
+assert {[catch {::dlr::callBatch  testLib  checkedErrno  {1 -1 2}} msg] && [string match {checkedErrno failed: * (errno *)} $msg]}
+assert {[catch {::dlr::callBatch  testLib  checkedNull  {1}}]}
+
+# callAsync test.  results arrive through the event loop, in any order.
+proc asyncDone {tag  result} {
+    lappend ::asyncResults [list $tag $result]
+}
+set ::asyncResults [list]
+foreach i {1 2 3 4 5} {
+    ::dlr::callAsync  testLib  mixedArgs  [list $i 0.5 ab 1.0]  [list asyncDone $i]
+}
+::dlr::callAsync  testLib  strtolTest  [list 4321 0 10]  [list asyncDone strtol]
+while {[llength $::asyncResults] < 6} {
+    vwait ::asyncResults
+}
+foreach pair $::asyncResults {
+    lassign $pair tag result
+    if {$tag eq {strtol}} {
+        assert {[lindex $result 0] == 4321}
+    } else {
+        assert {$result == $tag + 1205.0}
+    }
+}
+assert {[catch {::dlr::callAsync  testLib  dirRotatePtr  {0}  asyncDone}]}
+
+# callback test.  native code calls back to script.
+proc logCallback {tag  a  b  name  q} {
+    lappend ::callbackLog [list $tag $a $b $name $q]
+    return $($a * 2)
+}
+set ::callbackLog [list]
+::dlr::callback::with  testLib  callbackTestT  {logCallback x}  cb {
+    assert {[::testLib::callbackTest  $cb  5] == 20}
+}
+assert {$::callbackLog eq {{x 5 0.5 first {1 2 3 4}} {x 10 1.5 second {1 2 3 4}}}}
+# an error in the callback is raised by the call that led to it.
+set cb [::dlr::callback::create  testLib  callbackTestT  {error oops}]
+assert {[catch {::testLib::callbackTest  $cb  5} msg] && $msg eq {oops}}
+# in a batch, the callback's error is raised by callBatch itself, not by some later call.
+assert {[catch {::dlr::callBatch  testLib  callbackTest  [list [list $cb 5]]} msg] && $msg eq {oops}}
+assert {[::testLib::strtolTest  77  endP  10] == 77}
+::dlr::callback::release  testLib  callbackTestT  $cb
+# released closures are reused.
+assert {[::dlr::callback::create  testLib  callbackTestT  list] == $cb}
+::dlr::callback::release  testLib  callbackTestT  $cb
+assert {[catch {::dlr::callback::release  testLib  callbackTestT  $cb}]}
+
+# array test.  whole lists are packed and unpacked by one converter.
+assert {[::testLib::sumDoubles  {1.5 2.5 3.0}  3] == 7.0}
+set squares {}
+::testLib::fillSquares  squares  5
+assert {$squares eq {0 1 4 9 16}}
+::dlr::simple::i16::pack-byVal-asList  packed  {1 -2 3}  5
+assert {[string length $packed] == 10}
+assert {[::dlr::simple::i16::unpack-byVal-asList  $packed] eq {1 -2 3 0 0}}
+assert {[::dlr::simple::i16::unpack-byVal-asList  $packed  2] eq {1 -2}}
+assert {[catch {::dlr::simple::int::pack-byVal-asList  packed  {1 x 3}}]}
+# pack-null grows the buffer, keeping the fields packed there earlier.
+set packed {}
+::dlr::simple::i32::pack-byVal-asInt  packed  7
+::dlr::pack-null  packed  8  nextOffset
+assert {[string length $packed] == 8 + $::dlr::simple::ptr::size && $nextOffset == [string length $packed]}
+assert {[::dlr::simple::i32::unpack-byVal-asInt $packed] == 7}
+assert {[::dlr::simple::ptr::unpack-byVal-asInt $packed 8] == 0}
+unset nextOffset
+assert {[catch {::dlr::simple::i16::pack-byVal-asList  packed  {1 2}  $(2 ** 32 + 1)}]}
+
+# struct converter test, at an offset.  with the struct codec, each is one C command.
+set quadT ::dlr::lib::testLib::struct::quadT
+set quadSize [::dlr::get ${quadT}::size]
+unset -nocomplain packed
+${quadT}::pack-byVal-asDict  packed  {a 1 b 2 c 3 d 4}  8  next
+assert {$next == 8 + $quadSize}
+assert {[string length $packed] >= 8 + $quadSize}
+assert {[${quadT}::unpack-byVal-asList  $packed  8] eq {1 2 3 4}}
+assert {[dict get [${quadT}::unpack-byVal-asDict  $packed  8] d] == 4}
+# the codec keeps its own reference to the member names.
+set savedTable [list {*}[::dlr::get ${quadT}::memberTable]]
+set ${quadT}::memberTable {}
+assert {[dict get [${quadT}::unpack-byVal-asDict  $packed  8] d] == 4}
+set ${quadT}::memberTable $savedTable
+assert {[catch {${quadT}::pack-byVal-asList  packed  {1 2}}]}
+
+# struct array test.  all structs are unpacked by one C command.
+set quadsP [::testLib::quadArray  3]
+assert {[::dlr::struct::unpackArray  asList  $quadT  $quadsP  3] eq {{0 0 0 0} {1 10 100 -1} {2 20 200 -2}}}
+assert {[dict get [lindex [::dlr::struct::unpackArray  asDict  $quadT  $quadsP  3] 2] c] == 200}
+set columns [::dlr::struct::unpackArray  asColumns  $quadT  $quadsP  3]
+assert {[dict keys $columns] eq {a b c d}}
+assert {[dict get $columns d] eq {0 -1 -2}}
+# every other struct, by doubling the stride.
+set stride $(2 * $quadSize)
+assert {[::dlr::struct::unpackArray  asList  $quadT  $quadsP  2  $stride] eq {{0 0 0 0} {2 20 200 -2}}}
+# a stride too small for the members is rejected, rather than reading past the array.
+assert {[catch {::dlr::struct::unpackArray  asList  $quadT  $quadsP  3  4}]}
+assert {[catch {::dlr::struct::unpackArray  asList  $quadT  $quadsP  $(2 ** 31)}]}
+::dlr::freeHeap  $quadsP
+
+# pack cursor test.  fields append into one growing buffer.
+set cur [::dlr::packer new]
+assert {[$cur put ::dlr::simple::i32::pack-byVal-asInt  7] == 0}
+assert {[$cur align 8] == 8}
+assert {[$cur put ${quadT}::pack-byVal-asList  {1 2 3 4}] == 8}
+loop i 0 100 {
+    $cur put ::dlr::simple::u8::pack-byVal-asInt  $i
+}
+$cur putBytes abc
+assert {[$cur position] == 8 + $quadSize + 103}
+set record [$cur bytes]
+assert {[string length $record] == 8 + $quadSize + 103}
+assert {[::dlr::simple::i32::unpack-byVal-asInt  $record  0] == 7}
+assert {[${quadT}::unpack-byVal-asList  $record  8] eq {1 2 3 4}}
+assert {[::dlr::simple::u8::unpack-byVal-asInt  $record  $(8 + $quadSize + 99)] == 99}
+assert {[string range $record end-2 end] eq {abc}}
+# the cursor is empty again after finalizing.
+assert {[$cur position] == 0}
+$cur put ::dlr::simple::ascii::pack-byVal-asString  hello
+::dlr::freeHeap  [$cur heap]
+# a failed put leaves the cursor as it was.
+proc failingPacker {packVarName value} {
+    ::dlr::simple::i32::pack-byVal-asInt  $packVarName  $value
+    error {packer failed}
+}
+$cur put ::dlr::simple::i32::pack-byVal-asInt  7
+assert {[catch {$cur put ::dlr::simple::i32::pack-byVal-asInt  notAnInt}]}
+assert {[catch {$cur put failingPacker  8}]}
+assert {[$cur position] == 4}
+assert {[string length [$cur bytes]] == 4}
+rename $cur {}
+# growing a variable keeps the fields packed earlier.
+unset -nocomplain packed
+::dlr::simple::i32::pack-byVal-asInt  packed  5  0  next
+::dlr::simple::i32::pack-byVal-asInt  packed  6  $next
+assert {[::dlr::simple::i32::unpack-byVal-asInt  $packed  0] == 5}
+
+# error policy test.  the return value is checked in C.
+assert {[::testLib::checkedErrno  5] == 5}
+assert {[catch {::testLib::checkedErrno  -1} msg] && [string match {checkedErrno failed: * (errno *)} $msg]}
+assert {[::testLib::checkedNull  1] != 0}
+assert {[catch {::testLib::checkedNull  0} msg] && $msg eq {checkedNull failed: zero isn't allowed (returned 0)}}
+
+# borrowed parm test.  the native function reads the script value's own bytes.
+set doc [string repeat {"a":1,} 100000]
+assert {[::testLib::countChar  $doc  [scan : %c]] == 100000}
+assert {[::testLib::countChar  {}  [scan : %c]] == 0}
+${quadT}::pack-byVal-asList  packed  {1 2 3 4}
+assert {[::testLib::quadSum  $packed] == 10}
+assert {[catch {::dlr::declareCallToNative  cmd  testLib  {void}  cryptAscii  {
+    {inOut  byPtr   ascii   clear   asString    borrow}
+    {in     byVal   int     step    asInt}
+}}]}
+
+# length-bounded string test.  the length comes from the return value, or another parm.
+set buf [string repeat x 16]
+assert {[::testLib::fillText  buf  16] == 7}
+assert {$buf eq "abc\0def"}
+::testLib::makeText  text  len
+assert {$text eq {hello} && $len == 5}
+# bounded scans of the unterminated result.
+assert {[::dlr::simple::ascii::unpack-scriptPtr-asStringMax  [::dlr::addrOf buf]  2] eq {ab}}
+assert {[::dlr::simple::ascii::unpack-scriptPtr-asStringMax  [::dlr::addrOf buf]  100] eq {abc}}
+assert {[::dlr::simple::ascii::unpack-scriptPtr-asStringLen  [::dlr::addrOf buf]  -1] eq {}}
+assert {[::dlr::simple::ascii::unpack-byVal-asString  "ab\0cd"] eq {ab}}
+
 # floatSquare test
 loop attempt 2 5 {
     set stuff $($attempt + 0.1)
@@ -270,6 +596,75 @@ assert {$b == 11 * 7 * 9}
 assert {$c == 12 * 7 * 9}
 assert {$d == 13 * 7 * 9}
 
+# native buffer test.  its content stays at one address through packing and native calls.
+set nb [::dlr::newBuffer  $::dlr::lib::testLib::struct::quadT::size]
+set addr [::dlr::bufferAddr $nb]
+::dlr::lib::testLib::struct::quadT::pack-byVal-asList  nb  {1 2 3 4}
+assert {[::dlr::addrOf nb] == $addr}
+assert {[::testLib::quadSum $nb] == 10}
+::testLib::mulPtrNat  nb  2
+assert {[::dlr::addrOf nb] == $addr}
+assert {[::dlr::lib::testLib::struct::quadT::unpack-byVal-asList  $nb] eq {2 4 6 8}}
+# a slice shares the memory.  a copy doesn't.
+set tail [::dlr::sliceBuffer  $nb  4  4]
+assert {[::dlr::bufferAddr $tail] == $addr + 4}
+assert {[::dlr::simple::i32::unpack-byVal-asInt  $tail] == 4}
+set copy $nb
+append copy {}
+::testLib::mulPtrNat  nb  10
+assert {[::dlr::simple::i32::unpack-byVal-asInt  $tail] == 40}
+assert {[::dlr::simple::i32::unpack-byVal-asInt  $copy  4] == 4}
+# writing through a slice outdates the string rep of its source too.
+assert {[::dlr::simple::i32::unpack-byVal-asInt  [string range $nb 4 7]] == 40}
+::dlr::simple::i32::pack-byVal-asInt  tail  99
+assert {[::dlr::simple::i32::unpack-byVal-asInt  [string range $nb 4 7]] == 99}
+unset nb tail copy
+
+# pointer object test.  pointers keep their integer values, and may be tagged with a target type.
+set chunk [::dlr::allocHeap 16]
+assert {[::dlr::pointerType $chunk] eq {}}
+set typed [::dlr::newPointer  $chunk  ::dlr::lib::testLib::struct::quadT]
+assert {$typed == $chunk}
+assert {[::dlr::pointerType $typed] eq {::dlr::lib::testLib::struct::quadT}}
+assert {[::dlr::native::isNullFlag $::dlr::nullPtrFlag]}
+assert {[::dlr::native::isNullFlag _#_nullPtrFlag_#_]}
+assert { ! [::dlr::native::isNullFlag $chunk]}
+# a plain integer still works as a pointer.
+::dlr::simple::ptr::pack-byVal-asInt  packed  $($chunk + 0)
+assert {[::dlr::simple::ptr::unpack-byVal-asInt $packed] == $chunk}
+::dlr::freeHeap $typed
+unset chunk typed packed
+
+# block pool test.  blocks fit the struct type, and are reused after they're freed.
+set pool [::dlr::pool create  ::dlr::lib::testLib::struct::quadT  4]
+assert {[$pool blockSize] == 64}
+set p [$pool alloc]
+assert {[::dlr::pointerType $p] eq {::dlr::lib::testLib::struct::quadT}}
+assert {$p % 64 == 0}
+set b [::dlr::wrapBuffer  $p  $::dlr::lib::testLib::struct::quadT::size]
+::dlr::lib::testLib::struct::quadT::pack-byVal-asList  b  {1 2 3 4}
+assert {[::dlr::bufferAddr $b] == $p}
+assert {[::testLib::quadSum $b] == 10}
+$pool free $p
+assert {[$pool alloc] == $p}
+loop n 0 5 {
+    $pool alloc
+}
+set stats [$pool stats]
+assert {$stats(inUse) == 6 && $stats(capacity) == 8 && $stats(highWater) == 6}
+assert {$stats(allocs) == 7 && $stats(frees) == 1}
+# a block freed twice, or memory from elsewhere, is refused.
+set q [$pool alloc]
+$pool free $q
+assert {[catch {$pool free $q}]}
+assert {[catch {$pool free $($q + 1)}]}
+set chunk [::dlr::allocHeap 64]
+assert {[catch {$pool free $chunk}]}
+::dlr::freeHeap $chunk
+assert {[dict get [$pool stats] inUse] == 6}
+rename $pool {}
+unset pool p q b stats chunk
+
 # enum test
 assert {$::testLib::directions::toValue(west) == 3}
 assert {$::testLib::directions::toName(3) == {west}}
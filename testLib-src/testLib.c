@@ -29,6 +29,7 @@ along with dlr.  If not, see <https://www.gnu.org/licenses/>.
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <errno.h>
 
 typedef uint8_t u8;
 typedef uint32_t u32;
@@ -55,6 +56,10 @@ quadT mulDict(const quadT st, const int factor) {
     return mulByValue(st, factor);
 }
 
+// a struct with padding between its members.  it's declared along with quadT, so their
+// layouts are detected together.
+typedef struct {u8 tag; double value; } taggedT;
+
 // define another type.
 typedef u32 dataHandleT;
 extern dataHandleT dataHandler(dataHandleT handle);
@@ -79,6 +84,101 @@ float floatSquare(double stuff, long double longStuff) {
     return (float)(stuff * longStuff);
 }
 
+// mixes integer and floating point parms.
+extern double mixedArgs(int i, double d, const char* s, double e);
+double mixedArgs(int i, double d, const char* s, double e) {
+    return i + d * 10.0 + (double)strlen(s) * 100.0 + e * 1000.0;
+}
+
+// calls back to script twice, passing scalars, a string, and a struct.
+typedef int (*callbackTestT)(int a, double b, const char* name, quadT* q);
+extern int callbackTest(callbackTestT cb, int a);
+int callbackTest(callbackTestT cb, int a) {
+    quadT q = {1, 2, 3, 4};
+    int r = cb(a, 0.5, "first", &q);
+    return cb(r, 1.5, "second", &q);
+}
+
+// arrays.
+extern double sumDoubles(const double* values, int n);
+double sumDoubles(const double* values, int n) {
+    double sum = 0.0;
+    for (int i = 0; i < n; i++)
+        sum += values[i];
+    return sum;
+}
+
+extern void fillSquares(int* squares, int n);
+void fillSquares(int* squares, int n) {
+    for (int i = 0; i < n; i++)
+        squares[i] = i * i;
+}
+
+extern quadT* quadArray(int n);
+quadT* quadArray(int n) {
+    quadT* a = malloc(n * sizeof(quadT));
+    for (int i = 0; i < n; i++) {
+        quadT q = {i, i * 10, i * 100, -i};
+        a[i] = q;
+    }
+    return a;
+}
+
+// returns the given pointer.
+extern void* passPtr(void* p);
+void* passPtr(void* p) {
+    return p;
+}
+
+// fail in the ways checked by error policies.
+extern int checkedErrno(int x);
+int checkedErrno(int x) {
+    if (x >= 0) return x;
+    errno = ERANGE;
+    return -1;
+}
+
+static int checkedData = 0;
+extern void* checkedNull(int x);
+void* checkedNull(int x) {
+    return x == 0  ?  NULL  :  &checkedData;
+}
+
+extern const char* checkedMessage(void);
+const char* checkedMessage(void) {
+    return "zero isn't allowed";
+}
+
+// read their input only, for borrowed parms.
+extern int countChar(const char* s, int c);
+int countChar(const char* s, int c) {
+    int n = 0;
+    for ( ; *s; s++)
+        if (*s == c) n++;
+    return n;
+}
+
+extern int quadSum(const quadT* q);
+int quadSum(const quadT* q) {
+    return q->a + q->b + q->c + q->d;
+}
+
+// report the length of the strings they give out, like read().  neither string is terminated.
+extern int fillText(char* buf, int size);
+int fillText(char* buf, int size) {
+    static const char text[7] = {'a', 'b', 'c', 0, 'd', 'e', 'f'};
+    int n = size < 7  ?  size  :  7;
+    memcpy(buf, text, n);
+    return n;
+}
+
+extern void makeText(char** text, int* len);
+void makeText(char** text, int* len) {
+    *text = malloc(5);
+    memcpy(*text, "hello", 5);
+    *len = 5;
+}
+
 extern void floatSquarePtr(double* stuff);
 void floatSquarePtr(double* stuff) {
     *stuff = *stuff * *stuff;